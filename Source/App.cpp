@@ -2,11 +2,20 @@
 
 #include "AppGlobals.h"
 #include "Utils.h"
+#include "GenerationBenchmark.h"
+#include "SubmissionCheck.h"
+#include "GpuTimerCheck.h"
+#include "LutBakerCheck.h"
+#include "Profiler.h"
 
 #define LOWCOST_STARTUP true //set to true to disable post-processing by default
 #define WIREFRAME_STARTUP false
 #define RES_PATH "res/"
 //#define DEBUG_D3D11 //define to recreate device and device context with flag D3D11_CREATE_DEVICE_DEBUG
+//#define RUN_GENERATION_BENCHMARKS //define to run the generation benchmarks on startup (results go to benchmarks/generation.json)
+//#define VERIFY_GPU_TIMER //define to run GpuTimer's query ring against a scripted backend on startup (see GpuTimerCheck)
+//#define VERIFY_LUT_BAKER //define to check the baked colour grading LUT against LutBaker's reference lookup on startup (see LutBakerCheck)
+//#define VERIFY_SUBMISSION //define to replay each frame's terrain submission through a NullRenderBackend and check it against the draw and upload budgets (see SubmissionCheck)
 
 App::App(){
 }
@@ -20,18 +29,31 @@ App::~App(){
 		delete shader;
 	if (depthShader)
 		delete depthShader;
+	if (depthPrepass)
+		delete depthPrepass;
 	if (textureShader)
 		delete textureShader;
 
 	if (colourGrading)
 		delete colourGrading;
-	if (gaussian)
-		delete gaussian;
+	if (bloomChain)
+		delete bloomChain;
 	if (bloom)
 		delete bloom;
 	if (combine)
 		delete combine;
 
+	GLOBALS.ShaderLibrary = nullptr;
+	if (shaderLibrary)
+		delete shaderLibrary;
+
+	GLOBALS.GpuTimer = nullptr;
+	if (gpuTimer)
+		delete gpuTimer;
+	GLOBALS.RenderBackend = nullptr;
+	if (renderBackend)
+		delete renderBackend;
+
 	//release fbx sdk objects (we've been keeping some around for animation purposes)
 #ifdef FBX_SDK
 	FBXScene::Release();
@@ -63,6 +85,21 @@ void App::init(HINSTANCE hinstance, HWND hwnd, int screenWidth, int screenHeight
 	GLOBALS.ScreenWidth = screenWidth;
 	GLOBALS.ScreenHeight = screenHeight;
 	GLOBALS.Hwnd = hwnd;
+	gpuTimer = new GpuTimer(new D3D11QueryBackend(GLOBALS.Device, GLOBALS.DeviceContext));
+	GLOBALS.GpuTimer = gpuTimer;
+	renderBackend = new D3D11RenderBackend(GLOBALS.DeviceContext);
+	GLOBALS.RenderBackend = renderBackend;
+
+	//create all the shaders up front, in parallel; the shaders below (and the terrain's, each time it's rebuilt) then just pick them up
+	shaderLibrary = new ShaderLibrary(GLOBALS.Device);
+	GLOBALS.ShaderLibrary = shaderLibrary;
+	shaderLibrary->preload({
+		PRELOAD_VERTEX(default_vs, TANGENT_LAYOUT), PRELOAD_VERTEX(depth_vs, DEFAULT_LAYOUT), PRELOAD_VERTEX(postprocessing_vs, DEFAULT_LAYOUT),
+		PRELOAD_PIXEL(default_fs), PRELOAD_PIXEL(depth_fs),
+		PRELOAD_PIXEL(terrain_fs), PRELOAD_PIXEL(terrain_fs_1dir), PRELOAD_PIXEL(terrain_fs_1dir_normals), PRELOAD_PIXEL(terrain_fs_1dir_shadows), PRELOAD_PIXEL(terrain_fs_1dir_shadows_normals),
+		PRELOAD_PIXEL(ruinblock_fs), PRELOAD_PIXEL(ruinblock_fs_1dir), PRELOAD_PIXEL(ruinblock_fs_1dir_normals), PRELOAD_PIXEL(ruinblock_fs_1dir_shadows), PRELOAD_PIXEL(ruinblock_fs_1dir_shadows_normals),
+		PRELOAD_PIXEL(postprocessing_fs), PRELOAD_PIXEL(colourgrading_fs), PRELOAD_PIXEL(bloom_fs), PRELOAD_PIXEL(dualfilter_fs), PRELOAD_PIXEL(combine_fs)
+	});
 
 	//materials and textures
 	textureMgr->loadTexture("lut", (WCHAR*)L"" RES_PATH "LUTs/Lut_blue.png");
@@ -94,24 +131,32 @@ void App::init(HINSTANCE hinstance, HWND hwnd, int screenWidth, int screenHeight
 	colourGrading->vignette = 0.7f;
 	colourGrading->chromaticAberrationDistance = 0.022f;
 	bloom = new BloomShader;
-	bloom->horizontal = true;
-	bloom->distance = 200;
 	bloom->threshold = 1.954f;
 	bloom->intensity = 0.564f;
-	gaussian = new GaussianBlurShader;
-	gaussian->horizontal = false;
-	gaussian->distance = 200;
 	combine = new CombinationShader;
 	colourGradingPass.Setup(GLOBALS.Device, GLOBALS.DeviceContext, GLOBALS.ScreenWidth, GLOBALS.ScreenHeight, colourGrading);
-	bloomPass.Setup(GLOBALS.Device, GLOBALS.DeviceContext, GLOBALS.ScreenWidth * 0.7f, GLOBALS.ScreenHeight * 0.7f, bloom);
-	vGaussianPass.Setup(GLOBALS.Device, GLOBALS.DeviceContext, GLOBALS.ScreenWidth * 0.7f, GLOBALS.ScreenHeight * 0.7f, gaussian);
-	depthPass.Setup(GLOBALS.Device, GLOBALS.DeviceContext, GLOBALS.ScreenWidth, GLOBALS.ScreenHeight, textureShader);
-	combinationPass.Setup(GLOBALS.Device, GLOBALS.DeviceContext, GLOBALS.ScreenWidth, GLOBALS.ScreenHeight, combine);
+	bloomPass.Setup(GLOBALS.Device, GLOBALS.DeviceContext, GLOBALS.ScreenWidth, GLOBALS.ScreenHeight, combine);
+	bloomChain = new BloomChain(GLOBALS.Device, GLOBALS.DeviceContext, GLOBALS.ScreenWidth, GLOBALS.ScreenHeight, bloom);
+	bloomChain->distance = 200;
+	depthPrepass = new DepthPrepass(GLOBALS.Device, GLOBALS.ScreenWidth, GLOBALS.ScreenHeight);
 #if LOWCOST_STARTUP
 	disablePostProcessing = true;//bloom & pp is expensive, so i don't necessarily want it by default (especially on my own laptop hehe)
 #endif
 
+#ifdef RUN_GENERATION_BENCHMARKS
+	GenerationBenchmark::runAll();
+#endif
+#ifdef VERIFY_GPU_TIMER
+	GpuTimerCheck::run();
+#endif
+#ifdef VERIFY_LUT_BAKER
+	LutBakerCheck::run();
+#endif
+
 	//initialize meshes
+	terrainGraph = GenerationGraph::Default();
+	GenerationGraph::load(RES_PATH "terrain.graph", terrainGraph);
+	GLOBALS.TerrainGraph = &terrainGraph;
 	terrain = new InfiniteTerrain(textureMgr, terrainSeed);
 
 	//place camera
@@ -130,12 +175,19 @@ bool App::frame(){
 	//update base app
 	if (!BaseApplication::frame())
 		return false;
+	PROFILE_FRAME();
+	PROFILE_SCOPE("Frame");
 	float dt = timer->getTime();
 
 	totalTime += dt;
 
 	//update anything that requires animation
-	terrain->update(camera->getPosition(), renderer->getDevice(), renderer->getDeviceContext(), dt);
+	{
+		PROFILE_SCOPE("Update");
+		XMFLOAT4X4 view;//the camera's forward vector is the view matrix's third column
+		XMStoreFloat4x4(&view, camera->getViewMatrix());
+		terrain->update(camera->getPosition(), XMFLOAT3(view._13, view._23, view._33), renderer->getDevice(), renderer->getDeviceContext(), dt);
+	}
 
 	//render to screen
 	if (!render())
@@ -176,23 +228,31 @@ bool App::render(){
 	worldMatrix = renderer->getWorldMatrix();
 	GLOBALS.ViewMatrix = camera->getViewMatrix();
 
+	gpuTimer->beginFrame();
+	renderBackend->beginFrame();
+
 
 // ** shadow mapping passes ** //
 
 	if (shadows) {
+		PROFILE_SCOPE("Shadow maps");
+		GPU_SCOPE("Shadow maps");
 		terrain->shadowmappingPass(depthShader, renderer, worldMatrix);
 	}
 
 
-// ** depth pass ** //
+// ** depth pre-pass ** //
 
-	if (!wireframeToggle && !disablePostProcessing) {//no need to grab depths if we're not going to render fog
-		depthPass.Begin(renderer, GLOBALS.DeviceContext, XMFLOAT3(0, 0, 0));
+	bool depthPrepassed = !wireframeToggle;//wireframe would only get the edges drawn over the pre-pass' filled triangles; without it, the depth buffer still holds an older frame's depths, so nothing must read it
+	if (depthPrepassed) {
+		PROFILE_SCOPE("Depth pre-pass");
+		GPU_SCOPE("Depth pre-pass");
+		depthPrepass->begin(renderer->getDeviceContext());
 
 		//Render geometry to depth
 		terrain->depthPass(depthShader, renderer, worldMatrix, GLOBALS.ViewMatrix, projectionMatrix, camera->getPosition());
-		
-		depthPass.End(renderer);
+
+		depthPrepass->end(renderer);
 	}
 
 
@@ -209,53 +269,74 @@ bool App::render(){
 	} else //in wireframe mode, we don't want any post processing at all.
 		renderer->beginScene(0.2f, 0.2f, 0.3f, 1);
 
-	// Geometry
-	geometry(NULL, worldMatrix, GLOBALS.ViewMatrix, projectionMatrix, camera->getPosition(), shadows);
+	// Geometry, tested against the pre-pass' depths when it ran and the target allows it
+	{
+		PROFILE_SCOPE("Geometry");
+		GPU_SCOPE("Geometry");
+		bool earlyZ = depthPrepassed && depthPrepass->beginMainPass(renderer->getDeviceContext());
+		geometry(NULL, worldMatrix, GLOBALS.ViewMatrix, projectionMatrix, camera->getPosition(), shadows);
+		if (earlyZ)
+			depthPrepass->endMainPass(renderer);
+#ifdef VERIFY_SUBMISSION
+		SubmissionCheck::run(terrain, lighting, shadows, renderer, worldMatrix, GLOBALS.ViewMatrix, projectionMatrix, camera->getPosition());
+#endif
+	}
 
 
 // ** post processing ** //
 
 	//only do post processing and stuff if not in wireframe mode
 	if (!wireframeToggle && !disablePostProcessing) {
+		PROFILE_SCOPE("Post processing");
+		GPU_SCOPE("Post processing");
 
 		//end whichever is enabled (or none)
 		colourGradingPass.End();
 		bloomPass.End();
 
+		// With both effects on, bloom is taken from the scene before grading and added on in the colour grading pass itself,
+		// which saves writing the graded scene out and reading it back for bloom and for combining
+		bool fused = fusePostProcessing && colourGradingPass.enabled && bloomPass.enabled;
+		if (fused) {
+			PROFILE_SCOPE("Bloom + colour grading");
+			{
+				GPU_SCOPE("Bloom");
+				bloomChain->render(renderer, colourGradingPass.getRenderTexture()->getShaderResourceView(), camera->getOrthoViewMatrix());
+			}
+			GPU_SCOPE("Colour grading + bloom");
+			colourGrading->setColourGrading(renderer->getDeviceContext(), depthPrepassed ? depthPrepass->getShaderResourceView() : nullptr, projectionMatrix, bloomChain->getShaderResourceView());
+			colourGradingPass.Render(camera->getOrthoViewMatrix());
+		}
+
 		// Finish up colour grading if it's enabled
-		if(colourGradingPass.enabled){
+		if(colourGradingPass.enabled && !fused){
+			PROFILE_SCOPE("Colour grading");
+			GPU_SCOPE("Colour grading");
 
 			//Apply tonemapping
 			bloomPass.Begin();
-			colourGrading->setColourGrading(renderer, renderer->getDeviceContext(), camera->getOrthoViewMatrix(), depthPass.getRenderTexture()->getShaderResourceView());
+			colourGrading->setColourGrading(renderer->getDeviceContext(), depthPrepassed ? depthPrepass->getShaderResourceView() : nullptr, projectionMatrix);
 			colourGradingPass.Render(camera->getOrthoViewMatrix());
 			bloomPass.End();
 		}
 
 		//Finish up with bloom if it's enabled
-		if (bloomPass.enabled) {
-
-			//Blur horizontally and only keep brightest pixels
-			vGaussianPass.Begin();
-			bloom->setBlur();
-			bloom->setBloom();
-			bloomPass.Render(camera->getOrthoViewMatrix());
-			vGaussianPass.End();
+		if (bloomPass.enabled && !fused) {
+			PROFILE_SCOPE("Bloom");
+			GPU_SCOPE("Bloom");
 
-			//Blur vertically...
-			combinationPass.Begin();
-			gaussian->setBlur();
-			vGaussianPass.Render(camera->getOrthoViewMatrix());
-			combinationPass.End();
+			//Only keep brightest pixels, and blur them down and back up the chain
+			bloomChain->render(renderer, bloomPass.getRenderTexture()->getShaderResourceView(), camera->getOrthoViewMatrix());
 
 			//And combine results of bloom and what we had before starting bloom (ie colour grading or nothing)
-			combine->setTexture1(bloomPass.getRenderTexture()->getShaderResourceView());
-			combinationPass.Render(camera->getOrthoViewMatrix());
+			GPU_SCOPE("Combine");
+			combine->setTexture1(bloomChain->getShaderResourceView());
+			bloomPass.Render(camera->getOrthoViewMatrix());
 		}
 
 		//Show depth if we need to
-		if (showDepth) {
-			depthPass.Render(camera->getOrthoViewMatrix());
+		if (showDepth && depthPrepassed) {
+			depthPrepass->show(renderer, textureShader, camera->getOrthoViewMatrix());
 		}
 
 	}//!wireframe
@@ -272,10 +353,18 @@ bool App::render(){
 	}
 
 	//Show ui
-	gui();
+	{
+		PROFILE_SCOPE("UI");
+		GPU_SCOPE("UI");
+		gui();
+	}
+	gpuTimer->endFrame();
 
 	//swap buffers
-	renderer->endScene();
+	{
+		PROFILE_SCOPE("Present");
+		renderer->endScene();
+	}
 
 	return true;
 }
@@ -289,9 +378,21 @@ void App::gui()
 
 	// Display FPS
 	ImGui::Text("FPS: %.2f", timer->getFPS());
+	ImGui::SameLine();
+	ImGui::Text("GPU: %.2f ms", gpuTimer->getFrameMillis());
+	const RenderStats& renderStats = renderBackend->getLastFrame();
+	ImGui::Text("Draws: %d, state changes: %d, binds saved: %d, cbuffers: %.1f KB (%d skipped), uploads: %.1f KB", renderStats.draws, renderStats.stateChanges, renderStats.bindsSaved, renderStats.constantBufferBytes / 1024.f, renderStats.constantBufferSkips, renderStats.bufferUploadBytes / 1024.f);
 	int newSeed = terrainSeed;
 	ImGui::DragInt("Seed", &newSeed);
-	if (newSeed != terrainSeed) {
+	bool legacyRandom = GLOBALS.LegacyRandom;
+	ImGui::Checkbox("Legacy RNG (old saves)", &GLOBALS.LegacyRandom);
+	uint32_t graphHash = terrainGraph.getHash();
+	if (ImGui::Button("Reload terrain graph")) {
+		GenerationGraph::load(RES_PATH "terrain.graph", terrainGraph);
+	}
+	ImGui::SameLine();
+	ImGui::Text("(%s)", terrainGraph.hashTag().c_str());
+	if (newSeed != terrainSeed || legacyRandom != GLOBALS.LegacyRandom || graphHash != terrainGraph.getHash()) {
 		terrainSeed = newSeed;
 		//Regenerate all terrains!
 		delete terrain;
@@ -314,6 +415,8 @@ void App::gui()
 		ImGui::Text("Camera pos %f %f %f", camera->getPosition().x, camera->getPosition().y, camera->getPosition().z);
 		ImGui::SliderFloat("Camera speed", &cameraSpeed, 0, 10);
 		ImGui::SliderFloat("Timescale", &timeScale, 0, 1);
+		ImGui::SliderFloat("Generation budget (ms)", &GLOBALS.GenerationBudget, 0.5f, 16);
+		ImGui::Checkbox("Show profiler", &showProfiler);
 	}
 
 	//Lighting params
@@ -324,6 +427,7 @@ void App::gui()
 		ImGui::Checkbox("Show shadowmaps", &showShadowmaps);
 		ImGui::Checkbox("Show out of range shadowmaps", &GLOBALS.ShadowmapSeeErrors);
 		ImGui::SliderFloat("Shadowmap bias", &GLOBALS.ShadowmapBias, 0, 0.002f, "%.4f");
+		ImGui::SliderInt("Shadow filtering", &GLOBALS.ShadowmapKernel, 1, 4, "%d x4 taps");
 	}
 
 	// Colour grading params
@@ -336,14 +440,21 @@ void App::gui()
 	// Bloom params
 	if (ImGui::CollapsingHeader("Bloom")) {
 		ImGui::Checkbox("Apply bloom", &bloomPass.enabled);
+		ImGui::Checkbox("Fuse with colour grading", &fusePostProcessing);
 		ImGui::SliderFloat("Threshold", &bloom->threshold, 0, 3);
 		ImGui::SliderFloat("Intensity", &bloom->intensity, 0, 5);
-		int blurDist = gaussian->distance;
-		ImGui::SliderInt("Blur distance", &blurDist, 1, MAX_NEIGHBOURS);
-		gaussian->distance = blurDist;
-		bloom->distance = blurDist;
+		ImGui::SliderFloat("Blur distance", &bloomChain->distance, 4, 1000, "%.0f", 2);
+		ImGui::Text("Bloom chain levels: %d", bloomChain->getLevelCount());
 	}
 
+	// Gpu pass timings
+	if (ImGui::CollapsingHeader("GPU timings")) {
+		gpuTimer->gui();
+	}
+
+	//Profiler timeline
+	if (showProfiler) Profiler::Instance().gui(&showProfiler);
+
 	// Render UI
 	ImGui::Render();
 	if(showUi) ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
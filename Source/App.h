@@ -7,11 +7,15 @@
 #include "PostProcessingPass.h"
 #include "ColourGradingShader.h"
 #include "DepthShader.h"
-#include "GaussianBlurShader.h"
-#include "BloomShader.h"
+#include "BloomChain.h"
 #include "CombinationShader.h"
 #include "SquareMesh.h"
 #include "InfiniteTerrain.h"
+#include "GpuTimer.h"
+#include "RenderBackend.h"
+#include "GenerationGraph.h"
+#include "DepthPrepass.h"
+#include "ShaderLibrary.h"
 
 class App : public BaseApplication {
 
@@ -44,26 +48,36 @@ private:
 	///Meshes, materials, textures
 	InfiniteTerrain* terrain;
 	int terrainSeed;
-	bool showDepth = false;//when true, overlays the depth map on top of everything
+	GenerationGraph terrainGraph;//passes the heightmaps are generated with, from res/terrain.graph if there is one
+	bool showDepth = false;//when true, overlays the depth buffer on top of everything
 
 	///Post processing shaders and passes
 	PPTextureShader* textureShader;
-	PostProcessingPass depthPass;
+	DepthPrepass* depthPrepass = nullptr;//scene depth, rendered first so the lit pass only shades visible pixels, and read back for fog
 	ColourGradingShader* colourGrading;
 	PostProcessingPass colourGradingPass;
 	BloomShader* bloom;
-	GaussianBlurShader* gaussian;
-	PostProcessingPass bloomPass;
-	PostProcessingPass vGaussianPass;
+	BloomChain* bloomChain = nullptr;
 	CombinationShader* combine;
-	PostProcessingPass combinationPass;
+	PostProcessingPass bloomPass;//scene before bloom, combined with the chain's result when rendered
 	bool showLut = false;//when true, displays the tonemapped LUT used by the colour grading effect
 	bool disablePostProcessing = false;
+	bool fusePostProcessing = true;//bloom gets added on in the colour grading pass rather than combined in a pass of its own
 	float fov = 60.0f;
 	XMMATRIX projectionMatrix;
 
 	///Whether to show ui
 	bool showUi = false;
+	bool showProfiler = false;
+
+	///Gpu pass timings
+	GpuTimer* gpuTimer = nullptr;
+
+	///Submits the draws and counts them
+	RenderBackend* renderBackend = nullptr;
+
+	///Loads the shaders and shares them between everything that uses them
+	ShaderLibrary* shaderLibrary = nullptr;
 
 	///For animating things consistently when needed
 	float timeScale = 1;
@@ -9,6 +9,10 @@ extern class TextureManager;
 extern class D3D;
 extern class ID3D11Device;
 extern class ID3D11DeviceContext;
+extern class GpuTimer;
+extern class RenderBackend;
+extern class ShaderLibrary;
+extern class GenerationGraph;
 
 class AppGlobals {
 
@@ -32,6 +36,9 @@ public:
 	ID3D11Device* Device;
 	ID3D11DeviceContext* DeviceContext;
 	HWND Hwnd;
+	GpuTimer* GpuTimer = nullptr;//times the render passes on the gpu (see GPU_SCOPE)
+	RenderBackend* RenderBackend = nullptr;//what draws, bindings and buffer updates get submitted through
+	ShaderLibrary* ShaderLibrary = nullptr;//where every Shader gets its (shared) shader objects from
 
 	XMMATRIX ViewMatrix;
 	int ScreenWidth;
@@ -45,5 +52,10 @@ public:
 	float DisplacementScale = 1.0f;
 	float ShadowmapBias = 0.0008f;
 	bool ShadowmapSeeErrors = false;
+	int ShadowmapKernel = 1;//shadow filtering kernel size, in groups of 4 taps (1..4); each tap is a hardware 2x2 PCF lookup
+
+	float GenerationBudget = 4.f;//milliseconds of terrain generation work allowed each frame, shared between all the chunks being generated
+	const GenerationGraph* TerrainGraph = nullptr;//passes the heightmaps get generated with; the built-in ones if null
+	bool LegacyRandom = false;//when true, the generators reproduce the old std::default_random_engine sequences (to regenerate worlds saved before the counter-based rng)
 	
 };
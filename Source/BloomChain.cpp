@@ -0,0 +1,82 @@
+#include "BloomChain.h"
+
+#include <algorithm>
+#include <cmath>
+#include "AppGlobals.h"
+#include "RenderBackend.h"
+#include "GpuTimer.h"
+
+
+BloomChain::BloomChain(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int width, int height, BloomShader* brightPass) : width(width), height(height), brightPass(brightPass) {
+	filter = new DualFilterShader;
+	orthoMesh = new OrthoMesh(device, deviceContext, GLOBALS.ScreenWidth, GLOBALS.ScreenHeight);//fills any render target's viewport
+
+	//level i is 2^(i+1) times smaller than the scene
+	for (int i = 0; i < MAX_BLOOM_LEVELS; ++i) {
+		XMINT2 size(width >> (i + 1), height >> (i + 1));
+		if (size.x < 2 || size.y < 2) break;
+		levelSizes[i] = size;
+		levels[i] = new RenderTexture(device, size.x, size.y, SCREEN_NEAR, SCREEN_DEPTH);
+		++availableLevels;
+	}
+}
+
+BloomChain::~BloomChain() {
+	for (int i = 0; i < availableLevels; ++i) {
+		delete levels[i];
+	}
+	if (orthoMesh)
+		delete orthoMesh;
+	if (filter)
+		delete filter;
+}
+
+void BloomChain::render(D3D* renderer, ID3D11ShaderResourceView* scene, XMMATRIX orthoViewMatrix) {
+
+	//the blur radius roughly doubles with each level, so only work out how deep to go when the distance changes
+	if (distance != levelDistance) {
+		levelDistance = distance;
+		levelCount = std::clamp(int(std::round(std::log2(std::max(distance, 1.f)))) - 1, 1, availableLevels);
+	}
+
+	renderer->setZBuffer(false);
+
+	{
+		GPU_SCOPE("Bright pass");
+		brightPass->setBloom(width, height);
+		pass(renderer, brightPass, scene, levels[0], orthoViewMatrix);
+	}
+
+	{
+		GPU_SCOPE("Downsample");
+		for (int i = 1; i < levelCount; ++i) {
+			filter->setFilter(false, i - 1, levelSizes[i - 1].x, levelSizes[i - 1].y);
+			pass(renderer, filter, levels[i - 1]->getShaderResourceView(), levels[i], orthoViewMatrix);
+		}
+	}
+
+	{
+		//each level's downsampled contents have been read by now, so the upsampled ones can go in their place
+		GPU_SCOPE("Upsample");
+		for (int i = levelCount - 2; i >= 0; --i) {
+			filter->setFilter(true, i + 1, levelSizes[i + 1].x, levelSizes[i + 1].y);
+			pass(renderer, filter, levels[i + 1]->getShaderResourceView(), levels[i], orthoViewMatrix);
+		}
+	}
+
+	renderer->setZBuffer(true);
+	renderer->setBackBufferRenderTarget();
+	renderer->resetViewport();
+
+}
+
+void BloomChain::pass(D3D* renderer, PostProcessingShader* shader, ID3D11ShaderResourceView* source, RenderTexture* target, XMMATRIX orthoViewMatrix) {
+	ID3D11DeviceContext* deviceContext = renderer->getDeviceContext();
+	//bind the target first: the source was the last pass' render target, and can't be bound as a texture while it still is
+	target->setRenderTarget(deviceContext);
+	GLOBALS.RenderBackend->invalidateState();//switching render targets unbinds views, and the ortho mesh and texture get bound straight through the context
+	orthoMesh->sendData(deviceContext);
+	shader->setShaderParameters(deviceContext, renderer->getWorldMatrix(), orthoViewMatrix, renderer->getOrthoMatrix(), XMFLOAT3(0, 0, 0));
+	shader->setTextureData(deviceContext, source);
+	GLOBALS.RenderBackend->drawIndexed(shader, orthoMesh->getIndexCount());
+}
\ No newline at end of file
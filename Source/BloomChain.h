@@ -0,0 +1,43 @@
+#pragma once
+
+/** Bloom through a chain of progressively smaller render textures (dual filtering).
+	The bright pass downsamples the scene to half size, each level then gets downsampled into the next one, and the smallest level is upsampled back up the chain into the first one.
+	Every pass reads through a handful of bilinear taps from a texture a quarter (or four times) the size of its target, so the whole chain costs about as much as a couple of passes at half size whatever the blur radius: a wider blur only takes a level more.
+*/
+
+#include "DXF.h"
+#include "BloomShader.h"
+#include "DualFilterShader.h"
+
+#define MAX_BLOOM_LEVELS 8
+
+class BloomChain {
+
+public:
+	BloomChain(ID3D11Device* device, ID3D11DeviceContext* deviceContext, int width, int height, BloomShader* brightPass);//width, height: size of the scene it gets applied to
+	~BloomChain();
+
+	///Blurs the bright parts of scene down and back up the chain; the back buffer is the render target again afterwards
+	void render(D3D* renderer, ID3D11ShaderResourceView* scene, XMMATRIX orthoViewMatrix);
+	///Result of the last render(), at half the size of the scene
+	inline ID3D11ShaderResourceView* getShaderResourceView() { return levels[0]->getShaderResourceView(); }
+
+	///Rough radius of the blur, in pixels of the scene; each level of the chain doubles it
+	float distance = 200.0f;
+	inline int getLevelCount() const { return levelCount; }
+
+private:
+	///Draws source onto the whole of target
+	void pass(D3D* renderer, PostProcessingShader* shader, ID3D11ShaderResourceView* source, RenderTexture* target, XMMATRIX orthoViewMatrix);
+
+	int width, height;
+	BloomShader* brightPass;
+	DualFilterShader* filter;
+	OrthoMesh* orthoMesh;
+	RenderTexture* levels[MAX_BLOOM_LEVELS] = {};
+	XMINT2 levelSizes[MAX_BLOOM_LEVELS];
+	int availableLevels = 0;//levels that are still at least 2 texels across
+	int levelCount = 0;//levels used for the current distance
+	float levelDistance = -1;//distance levelCount was worked out for
+
+};
\ No newline at end of file
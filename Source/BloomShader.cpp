@@ -1,34 +1,33 @@
 #include "BloomShader.h"
 
 #include "AppGlobals.h"
+#include "RenderBackend.h"
 
-BloomShader::BloomShader() : GaussianBlurShader(false) {
+BloomShader::BloomShader() {
 	SETUP_SHADER(postprocessing_vs, bloom_fs);
 }
 
 
 BloomShader::~BloomShader(){
-	bloomBuffer->Release();
+	if (bloomBuffer)
+		delete bloomBuffer;
 }
 
 void BloomShader::initBuffers() {
-	GaussianBlurShader::initBuffers();
+	PostProcessingShader::initBuffers();
 
-	SETUP_SHADER_BUFFER(BloomBufferType, bloomBuffer);
+	bloomBuffer = new CachedConstantBuffer(renderer, sizeof(BloomBufferType));
 }
 
 ///Sends data for bloom params
-void BloomShader::setBloom() {
+void BloomShader::setBloom(int sceneWidth, int sceneHeight) {
 
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	BloomBufferType bloom;
+	bloom.threshold = threshold;
+	bloom.intensity = intensity;
+	bloom.texel = XMFLOAT2(1.f / sceneWidth, 1.f / sceneHeight);
+	bloomBuffer->update(&bloom);
 
-	//Send bloom data
-	BloomBufferType* bPtr;
-	GLOBALS.DeviceContext->Map(bloomBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	bPtr = (BloomBufferType*)mappedResource.pData;
-	bPtr->threshold = threshold;
-	bPtr->intensity = intensity;
-	GLOBALS.DeviceContext->Unmap(bloomBuffer, 0);
-	GLOBALS.DeviceContext->PSSetConstantBuffers(1, 1, &bloomBuffer);
+	GLOBALS.RenderBackend->setConstantBuffer(RenderBackend::PS, 0, bloomBuffer->getBuffer());
 
-}
+}
\ No newline at end of file
@@ -1,19 +1,21 @@
 #pragma once
-#include "GaussianBlurShader.h"
+#include "PostProcessingShader.h"
 
-class BloomShader : public GaussianBlurShader {
+///Bright pass of the bloom chain (see BloomChain)
+class BloomShader : public PostProcessingShader {
 protected:
 	struct BloomBufferType{
 		float threshold;//0..3
 		float intensity;//0..5
-		XMFLOAT2 padding;
+		XMFLOAT2 texel;//size of one texel of the scene, in uv
 	};
 
 public:
 	BloomShader();
 	~BloomShader();
 
-	void setBloom();
+	///Sends data for bloom params, for a scene of the given size (only uploaded when something changed)
+	void setBloom(int sceneWidth, int sceneHeight);
 
 	///Parameters for blooming
 	float threshold = 1.75f;
@@ -23,6 +25,5 @@ protected:
 	void initBuffers() override;
 
 private:
-	ID3D11Buffer* bloomBuffer;
-};
-
+	CachedConstantBuffer* bloomBuffer = nullptr;
+};
\ No newline at end of file
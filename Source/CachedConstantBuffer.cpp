@@ -0,0 +1,35 @@
+#include "CachedConstantBuffer.h"
+
+#include <cstring>
+#include <cstdio>
+#include "AppGlobals.h"
+#include "RenderBackend.h"
+#include "Shader.h"
+
+
+CachedConstantBuffer::CachedConstantBuffer(ID3D11Device* device, size_t bytes) : contents(bytes) {
+	if (!device) return;
+	D3D11_BUFFER_DESC desc = { UINT(bytes), D3D11_USAGE_DYNAMIC, D3D11_BIND_CONSTANT_BUFFER, D3D11_CPU_ACCESS_WRITE, 0, 0 };
+	HRESULT result = device->CreateBuffer(&desc, NULL, &buffer);
+	if (result != S_OK) {
+		printf("Error creating constant buffer (%d bytes): ", int(bytes));
+		Shader::printError(result);
+		buffer = nullptr;
+	}
+}
+
+CachedConstantBuffer::~CachedConstantBuffer() {
+	if (buffer)
+		buffer->Release();
+}
+
+bool CachedConstantBuffer::update(const void* data) {
+	if (uploaded && memcmp(contents.data(), data, contents.size()) == 0) {
+		GLOBALS.RenderBackend->skipConstantBufferUpdate();
+		return false;
+	}
+	memcpy(contents.data(), data, contents.size());
+	uploaded = true;
+	GLOBALS.RenderBackend->updateConstantBuffer(buffer, data, contents.size());
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+/** A dynamic constant buffer that remembers what it last uploaded, so writing the same contents again (eg the camera, once for each chunk) skips the Map/Unmap altogether.
+	Data changing at different rates (per frame, per chunk, per draw) should go in separate buffers, so that one of them changing doesn't re-upload the others.
+*/
+
+#include <d3d11.h>
+#include <vector>
+#include <cstdint>
+
+class CachedConstantBuffer {
+
+public:
+	CachedConstantBuffer(ID3D11Device* device, size_t bytes);//device may be null when nothing is sent to a gpu (see NullRenderBackend)
+	~CachedConstantBuffer();
+	CachedConstantBuffer(const CachedConstantBuffer&) = delete;
+	CachedConstantBuffer& operator=(const CachedConstantBuffer&) = delete;
+
+	///Uploads data (as many bytes as the buffer was created with) unless the buffer already holds exactly that; returns whether it was uploaded
+	bool update(const void* data);
+	///Forces the next update() to upload
+	inline void invalidate() { uploaded = false; }
+
+	inline ID3D11Buffer* getBuffer() const { return buffer; }
+
+private:
+	ID3D11Buffer* buffer = nullptr;
+	std::vector<uint8_t> contents;//what the gpu side currently holds
+	bool uploaded = false;
+
+};
\ No newline at end of file
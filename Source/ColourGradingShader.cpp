@@ -1,26 +1,29 @@
 #include "ColourGradingShader.h"
 
 #include "AppGlobals.h"
+#include <cstring>
+#include <cmath>
 
 
 ColourGradingShader::ColourGradingShader(){
 	SETUP_SHADER(postprocessing_vs, colourgrading_fs);
 
-	orthoMesh = new OrthoMesh(GLOBALS.Device, GLOBALS.DeviceContext, GLOBALS.ScreenWidth, GLOBALS.ScreenHeight);
-	orthoMeshSmall = new OrthoMesh(GLOBALS.Device, GLOBALS.DeviceContext, LUT_WIDTH, LUT_HEIGHT, -GLOBALS.ScreenWidth/2+LUT_WIDTH/2, GLOBALS.ScreenHeight/2-LUT_HEIGHT/2);
-	renderTexture = new RenderTexture(GLOBALS.Device, LUT_WIDTH, LUT_HEIGHT, SCREEN_NEAR, SCREEN_DEPTH);
-	tonemapShader = new TonemappingShader;
+	const int previewWidth = LUT_3D_SIZE * LUT_3D_SIZE;
+	orthoMeshSmall = new OrthoMesh(GLOBALS.Device, GLOBALS.DeviceContext, previewWidth, LUT_3D_SIZE, -GLOBALS.ScreenWidth/2+previewWidth/2, GLOBALS.ScreenHeight/2-LUT_3D_SIZE/2);
 	textureShader = new PPTextureShader;
 }
 
 
 ColourGradingShader::~ColourGradingShader(){
+	if (bakeTask)//(its worker frees it if it's still baking)
+		delete bakeTask;
 	colourGradingBuffer->Release();
 	lutSampler->Release();
-	delete tonemapShader;
+	if (lutView) lutView->Release();
+	if (lutTexture) lutTexture->Release();
+	if (lutPreviewView) lutPreviewView->Release();
+	if (lutPreviewTexture) lutPreviewTexture->Release();
 	delete textureShader;
-	delete renderTexture;
-	delete orthoMesh;
 	delete orthoMeshSmall;
 }
 
@@ -29,9 +32,9 @@ void ColourGradingShader::initBuffers() {
 
 	D3D11_SAMPLER_DESC samplerDesc;
 	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_LINEAR_MIP_POINT;
-	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
 	samplerDesc.MipLODBias = 0.0f;
 	samplerDesc.MaxAnisotropy = 0;
 	samplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
@@ -42,51 +45,160 @@ void ColourGradingShader::initBuffers() {
 	SETUP_SHADER_BUFFER(ColourGradingType, colourGradingBuffer);
 }
 
-void ColourGradingShader::setColourGrading(D3D* renderer, ID3D11DeviceContext* deviceContext, XMMATRIX orthoViewMatrix, ID3D11ShaderResourceView* depthTexture) {
+///Reads an 8 bits per channel texture back from the gpu as rgba floats (which is what the LUT images get loaded as)
+static bool readTexture(ID3D11Device* device, ID3D11DeviceContext* deviceContext, ID3D11ShaderResourceView* view, LutStrip& strip) {
+	ID3D11Resource* resource = nullptr;
+	view->GetResource(&resource);
+	ID3D11Texture2D* texture = nullptr;
+	HRESULT result = resource->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&texture);
+	resource->Release();
+	if (result != S_OK) {
+		printf("Error: LUT is not a 2D texture.\n");
+		return false;
+	}
+
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+	bool bgra = desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM || desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+	bool srgb = desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+	if (!bgra && desc.Format != DXGI_FORMAT_R8G8B8A8_UNORM && desc.Format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB) {
+		printf("Error: LUT texture format %d can't be read back.\n", int(desc.Format));
+		texture->Release();
+		return false;
+	}
+
+	//copy the top mip over to a texture we can map
+	D3D11_TEXTURE2D_DESC stagingDesc = desc;
+	stagingDesc.MipLevels = 1;
+	stagingDesc.ArraySize = 1;
+	stagingDesc.SampleDesc.Count = 1;
+	stagingDesc.SampleDesc.Quality = 0;
+	stagingDesc.Usage = D3D11_USAGE_STAGING;
+	stagingDesc.BindFlags = 0;
+	stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	stagingDesc.MiscFlags = 0;
+	ID3D11Texture2D* staging = nullptr;
+	result = device->CreateTexture2D(&stagingDesc, NULL, &staging);
+	if (result != S_OK) {
+		printf("Error creating LUT staging texture: ");
+		Shader::printError(result);
+		texture->Release();
+		return false;
+	}
+	deviceContext->CopySubresourceRegion(staging, 0, 0, 0, 0, texture, 0, NULL);
+	texture->Release();
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	result = deviceContext->Map(staging, 0, D3D11_MAP_READ, 0, &mapped);
+	if (result != S_OK) {
+		printf("Error reading back LUT texture: ");
+		Shader::printError(result);
+		staging->Release();
+		return false;
+	}
+	strip.width = desc.Width;
+	strip.height = desc.Height;
+	strip.texels.resize(size_t(desc.Width) * desc.Height * 4);
+	for (UINT y = 0; y < desc.Height; ++y) {
+		const uint8_t* row = (const uint8_t*)mapped.pData + y * mapped.RowPitch;
+		for (UINT x = 0; x < desc.Width; ++x) {
+			float* texel = &strip.texels[(y * desc.Width + x) * 4];
+			for (int c = 0; c < 4; ++c) {
+				float v = row[x * 4 + (bgra && c < 3 ? 2 - c : c)] / 255.0f;
+				if (srgb && c < 3)//sampling would have turned it linear
+					v = v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+				texel[c] = v;
+			}
+		}
+	}
+	deviceContext->Unmap(staging, 0);
+	staging->Release();
+	return true;
+}
+
+void ColourGradingShader::setLut(ID3D11ShaderResourceView* view) {
+	if (bakeTask) {//it's reading the old strip
+		delete bakeTask;
+		bakeTask = nullptr;
+	}
+	lutStrip = LutStrip();
+	if (view && readTexture(GLOBALS.Device, GLOBALS.DeviceContext, view, lutStrip) && !lutStrip.isValid())
+		printf("Error: LUT should be a strip of n slices of n*n texels (got %dx%d).\n", lutStrip.width, lutStrip.height);
+	retonemap = true;
+}
+
+void ColourGradingShader::uploadLut() {
+	const UINT size = LUT_3D_SIZE;
+	const UINT texelBytes = 4 * sizeof(uint16_t);
+
+	if (!lutTexture) {
+		D3D11_TEXTURE3D_DESC desc = { size, size, size, 1, DXGI_FORMAT_R16G16B16A16_FLOAT, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0 };
+		HRESULT result = GLOBALS.Device->CreateTexture3D(&desc, NULL, &lutTexture);
+		if (result == S_OK) result = GLOBALS.Device->CreateShaderResourceView(lutTexture, NULL, &lutView);
+		D3D11_TEXTURE2D_DESC previewDesc = { size * size, size, 1, 1, DXGI_FORMAT_R16G16B16A16_FLOAT, { 1, 0 }, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0 };
+		if (result == S_OK) result = GLOBALS.Device->CreateTexture2D(&previewDesc, NULL, &lutPreviewTexture);
+		if (result == S_OK) result = GLOBALS.Device->CreateShaderResourceView(lutPreviewTexture, NULL, &lutPreviewView);
+		if (result != S_OK) {
+			printf("Error creating LUT textures: ");
+			Shader::printError(result);
+			return;
+		}
+	}
+	GLOBALS.DeviceContext->UpdateSubresource(lutTexture, 0, NULL, bakedLut.data(), size * texelBytes, size * size * texelBytes);
+
+	//preview: slices side by side, green going up
+	std::vector<uint16_t> preview(bakedLut.size());
+	for (UINT z = 0; z < size; ++z) {
+		for (UINT y = 0; y < size; ++y) {
+			memcpy(&preview[((size - 1 - y) * size * size + z * size) * 4], &bakedLut[((z * size + y) * size) * 4], size * texelBytes);
+		}
+	}
+	GLOBALS.DeviceContext->UpdateSubresource(lutPreviewTexture, 0, NULL, preview.data(), size * size * texelBytes, 0);
+}
+
+void ColourGradingShader::setColourGrading(ID3D11DeviceContext* deviceContext, ID3D11ShaderResourceView* depthTexture, const XMMATRIX& projectionMatrix, ID3D11ShaderResourceView* bloomTexture) {
 	D3D11_MAPPED_SUBRESOURCE mappedResource;
 
-	// Retonemap LUT if needed
-	if (retonemap && lut != nullptr) {
+	// Pick up the LUT once it's baked, then rebake it if the params changed meanwhile
+	if (bakeTask && bakeTask->Continue()) {
+		delete bakeTask;
+		bakeTask = nullptr;
+		uploadLut();
+	}
+	if (retonemap && !bakeTask && lutStrip.isValid()) {
 		retonemap = false;
-		renderer->setZBuffer(false);
-		//render the lut to rendertexture using tonemapping shader
-		renderTexture->setRenderTarget(deviceContext);
-		renderTexture->clearRenderTarget(deviceContext, 1, 1, 1, 1);
-		orthoMesh->sendData(deviceContext);
-		tonemapShader->setShaderParameters(deviceContext, renderer->getWorldMatrix(), orthoViewMatrix, renderer->getOrthoMatrix(), XMFLOAT3(0,0,0));
-		tonemapShader->setTextureData(deviceContext, lut);
-		//pass params
-		tonemapShader->tonemapping = getTonemapping();
-		tonemapShader->exposure = getExposure();
-		tonemapShader->brightness = getBrightness();
-		tonemapShader->contrast = getContrast();
-		tonemapShader->hue = getHue();
-		tonemapShader->saturation = getSaturation();
-		tonemapShader->value = getValue();
-		tonemapShader->setTonemapping(deviceContext);
-		tonemapShader->render(deviceContext, orthoMesh->getIndexCount());
-		renderer->setBackBufferRenderTarget();
-		renderer->setZBuffer(true);
-		//grab the tonemapped lut
-		tonemappedLut = renderTexture->getShaderResourceView();
+		if (lutView == nullptr) {//first one: bake it right away rather than show frames without grading
+			LutBaker::bake(lutStrip, getTonemappingParams(), LUT_3D_SIZE, bakedLut);
+			uploadLut();
+		}
+		else {
+			bakeTask = new GenerationTask(LutBaker::asyncBake(lutStrip, getTonemappingParams(), LUT_3D_SIZE, bakedLut));
+			bakeTask->Continue();//sends it off to a worker
+		}
 	}
 
 	// Send data to fragment shader
 	ColourGradingType* cgPtr;
 	deviceContext->Map(colourGradingBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
 	cgPtr = (ColourGradingType*)mappedResource.pData;
-	cgPtr->strength = tonemappedLut == nullptr ? 0 : strength;
-	cgPtr->logLutParams = XMFLOAT3(1.0f/LUT_WIDTH, 1.0f/LUT_HEIGHT, LUT_HEIGHT-1.0f);
+	cgPtr->strength = lutView == nullptr ? 0 : strength;
+	cgPtr->lutScaleOffset = XMFLOAT2((LUT_3D_SIZE - 1.0f) / LUT_3D_SIZE, 0.5f / LUT_3D_SIZE);
 	cgPtr->vignette = vignette;
 	cgPtr->chromaticAberrationStrength = chromaticAberrationStrength;
 	cgPtr->chromaticAberrationDistance = chromaticAberrationDistance;
 	cgPtr->fog = fogColour;
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&projection, projectionMatrix);
+	cgPtr->depthParams = XMFLOAT2(projection._33, projection._43);
+	cgPtr->rayScale = XMFLOAT2(1.0f / projection._11, 1.0f / projection._22);
+	cgPtr->oneOverFogDistance = depthTexture ? 1.0f / FAR_PLANE : 0;//no depths to go by (the null view reads as 0), no fog
+	cgPtr->bloom = bloomTexture ? 1.0f : 0.0f;
 	deviceContext->Unmap(colourGradingBuffer, 0);
 	deviceContext->PSSetConstantBuffers(0, 1, &colourGradingBuffer);
 
 	// Send LUT
-	if (tonemappedLut != nullptr) {
-		deviceContext->PSSetShaderResources(1, 1, &tonemappedLut);
+	if (lutView != nullptr) {
+		deviceContext->PSSetShaderResources(1, 1, &lutView);
 		deviceContext->PSSetSamplers(1, 1, &lutSampler);
 	}
 	else {
@@ -95,6 +207,10 @@ void ColourGradingShader::setColourGrading(D3D* renderer, ID3D11DeviceContext* d
 
 	// Send depth texture
 	deviceContext->PSSetShaderResources(2, 1, &depthTexture);
+
+	// Send bloom
+	if (bloomTexture != nullptr)
+		deviceContext->PSSetShaderResources(3, 1, &bloomTexture);
 }
 
 
@@ -135,7 +251,7 @@ void ColourGradingShader::showLut(D3D* renderer, XMMATRIX orthoViewMatrix) {
 	renderer->setZBuffer(false);
 	orthoMeshSmall->sendData(renderer->getDeviceContext());
 	textureShader->setShaderParameters(renderer->getDeviceContext(), renderer->getWorldMatrix(), orthoViewMatrix, renderer->getOrthoMatrix(), XMFLOAT3(0,0,0));
-	textureShader->setTextureData(renderer->getDeviceContext(), tonemappedLut);
+	textureShader->setTextureData(renderer->getDeviceContext(), lutPreviewView);
 	textureShader->render(renderer->getDeviceContext(), orthoMeshSmall->getIndexCount());
 	renderer->setZBuffer(true);
 
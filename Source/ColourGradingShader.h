@@ -1,11 +1,8 @@
 #pragma once
 #include "PostProcessingShader.h"
-#include "TonemappingShader.h"
 #include "PostProcessingPass.h"
 #include "PPTextureShader.h"
-
-#define LUT_WIDTH 256
-#define LUT_HEIGHT 16
+#include "LutBaker.h"
 
 class ColourGradingShader : public PostProcessingShader {
 
@@ -13,11 +10,15 @@ protected:
 	struct ColourGradingType {
 		XMFLOAT3 fog;
 		float strength;//0..1
-		XMFLOAT3 logLutParams;//x: 1/lut_width, y: 1/lut_height, z: lut_height-1
+		XMFLOAT2 lutScaleOffset;//maps 0..1 onto the centres of the 3D LUT's first and last texels
+		float lutPad;
 		float vignette;//0..1
 		float chromaticAberrationStrength;//0..1
 		float chromaticAberrationDistance;//0..1
-		XMFLOAT2 pad;
+		XMFLOAT2 depthParams;//_33 and _43 of the projection matrix, to turn the depth buffer's values back into view space depth
+		XMFLOAT2 rayScale;//1/_11 and 1/_22 of the projection matrix, to get from view space depth to the distance along the view ray
+		float oneOverFogDistance;//fog is full at the far plane
+		float bloom;//1 when a bloom texture is added on top
 	};
 
 public:
@@ -25,7 +26,9 @@ public:
 	~ColourGradingShader();
 
 	///setup the colour grading
-	void setColourGrading(D3D* renderer, ID3D11DeviceContext* deviceContext, XMMATRIX orthoViewMatrix, ID3D11ShaderResourceView* depthTexture);
+	///depthTexture is the scene's depth buffer, as rendered with projectionMatrix; the fog is left out when it's null
+	///bloomTexture, if any, gets added on top of the graded colours in the same pass (see BloomChain)
+	void setColourGrading(ID3D11DeviceContext* deviceContext, ID3D11ShaderResourceView* depthTexture, const XMMATRIX& projectionMatrix, ID3D11ShaderResourceView* bloomTexture = nullptr);
 
 	///debug: show GUI for params
 	void gui();
@@ -33,8 +36,8 @@ public:
 	///debug: show tonemapped LUT output
 	void showLut(D3D* renderer, XMMATRIX orthoViewMatrix);
 
-	///init the lut
-	inline void setLut(ID3D11ShaderResourceView* view) { lut = view; retonemap = true; }
+	///init the lut (a strip, as in res/LUTs); its texels are read back so the tonemapped LUT can be baked on the cpu
+	void setLut(ID3D11ShaderResourceView* view);
 
 	///Parameters
 	float strength = 1;//0..1
@@ -42,7 +45,7 @@ public:
 	float chromaticAberrationStrength = 1;//0..1
 	float chromaticAberrationDistance = 0.05f;//0..1
 	XMFLOAT3 fogColour = XMFLOAT3(0.5f, 0.5f, 0.5f);
-	//setters and getters for tonemapping properties; anytime setter is called, the LUT will be retonemapped on the next frame before rendering
+	//setters and getters for tonemapping properties; anytime setter is called, the LUT gets rebaked on a worker thread, and used from whichever frame it's ready on
 #define SG(name, set, get) inline void set (float param){ name = param; retonemap = true; } inline float get (){ return name; }
 	SG(tonemapping, setTonemapping, getTonemapping)
 	SG(exposure, setExposure, getExposure)
@@ -56,7 +59,7 @@ public:
 protected:
 	void initBuffers() override;
 
-	///Parameters for tonemapping (should be changed via setters; changing one re-runs tonemapping shader on this frame)
+	///Parameters for tonemapping (should be changed via setters; changing one rebakes the LUT)
 	float tonemapping = TONEMAP_NONE;
 	float exposure = 1;//0..2
 	float brightness = 0;//-1..1
@@ -66,17 +69,25 @@ protected:
 	float value = 1;//0..2
 
 private:
+	inline TonemappingParams getTonemappingParams() const { return TonemappingParams{ tonemapping, exposure, brightness, contrast, hue, saturation, value }; }
+	///Sends bakedLut over to the 3D LUT texture (and the preview)
+	void uploadLut();
+
 	ID3D11Buffer* colourGradingBuffer = nullptr;
-	ID3D11ShaderResourceView* lut = nullptr;
-	ID3D11ShaderResourceView* tonemappedLut = nullptr;//result of post-processed lut
 	ID3D11SamplerState* lutSampler = nullptr;
 
-	bool retonemap = false;//set to true each time one of the params changes; redoes tonemapping to LUT on this frame when true
+	bool retonemap = false;//set to true each time one of the params changes; rebakes the LUT when true
+
+	LutStrip lutStrip;//texels of the lut, before tonemapping
+	std::vector<uint16_t> bakedLut;//RGBA16F, LUT_3D_SIZE^3 texels; filled in by bakeTask once it's done
+	GenerationTask* bakeTask = nullptr;
+	ID3D11Texture3D* lutTexture = nullptr;
+	ID3D11ShaderResourceView* lutView = nullptr;//null until the first bake is done
+	ID3D11Texture2D* lutPreviewTexture = nullptr;//the baked LUT laid out as a strip again, for showLut()
+	ID3D11ShaderResourceView* lutPreviewView = nullptr;
 
-	TonemappingShader* tonemapShader;
 	PPTextureShader* textureShader;
-	OrthoMesh* orthoMesh, * orthoMeshSmall;//first one is screen size, second is 256x16 (LUT_WIDTH x LUT_HEIGHT)
-	RenderTexture* renderTexture;
+	OrthoMesh* orthoMeshSmall;//LUT_3D_SIZE^2 x LUT_3D_SIZE, for showLut()
 
 };
 
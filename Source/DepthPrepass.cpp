@@ -0,0 +1,122 @@
+#include "DepthPrepass.h"
+
+#include "AppGlobals.h"
+#include "RenderBackend.h"
+#include "Shader.h"
+#include "PPTextureShader.h"
+
+
+DepthPrepass::DepthPrepass(ID3D11Device* device, int width, int height) : width(width), height(height) {
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = width;
+	textureDesc.Height = height;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+	HRESULT result = device->CreateTexture2D(&textureDesc, NULL, &texture);
+	if (result != S_OK) {
+		printf("Error creating depth prepass texture: ");
+		Shader::printError(result);
+		return;
+	}
+
+	D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc = {};
+	depthStencilViewDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	depthStencilViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+	result = device->CreateDepthStencilView(texture, &depthStencilViewDesc, &depthStencilView);
+	if (result != S_OK) {
+		printf("Error creating depth prepass depth stencil view: ");
+		Shader::printError(result);
+	}
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc = {};
+	shaderResourceViewDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	shaderResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	shaderResourceViewDesc.Texture2D.MipLevels = 1;
+	result = device->CreateShaderResourceView(texture, &shaderResourceViewDesc, &shaderResourceView);
+	if (result != S_OK) {
+		printf("Error creating depth prepass shader resource view: ");
+		Shader::printError(result);
+	}
+
+	D3D11_DEPTH_STENCIL_DESC stateDesc = {};
+	stateDesc.DepthEnable = true;
+	stateDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	stateDesc.DepthFunc = D3D11_COMPARISON_LESS;
+	device->CreateDepthStencilState(&stateDesc, &prepassState);
+	stateDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	stateDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;//the main pass runs the same vertex maths as the prepass (see precise in the vertex shaders), so visible pixels land on exactly the stored depth
+	device->CreateDepthStencilState(&stateDesc, &mainPassState);
+
+	viewport = { 0, 0, float(width), float(height), 0, 1 };
+}
+
+DepthPrepass::~DepthPrepass() {
+	if (mainPassState)
+		mainPassState->Release();
+	if (prepassState)
+		prepassState->Release();
+	if (shaderResourceView)
+		shaderResourceView->Release();
+	if (depthStencilView)
+		depthStencilView->Release();
+	if (texture)
+		texture->Release();
+}
+
+void DepthPrepass::begin(ID3D11DeviceContext* deviceContext) {
+	ID3D11RenderTargetView* noTarget = nullptr;
+	deviceContext->OMSetRenderTargets(1, &noTarget, depthStencilView);
+	deviceContext->RSSetViewports(1, &viewport);
+	deviceContext->ClearDepthStencilView(depthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0);
+	deviceContext->OMSetDepthStencilState(prepassState, 0);
+}
+
+void DepthPrepass::end(D3D* renderer) {
+	renderer->setBackBufferRenderTarget();
+	renderer->resetViewport();
+	renderer->setZBuffer(true);
+}
+
+bool DepthPrepass::beginMainPass(ID3D11DeviceContext* deviceContext) {
+	//grab whatever colour target the pass began with (back buffer or post processing render texture)
+	ID3D11RenderTargetView* renderTarget = nullptr;
+	ID3D11DepthStencilView* ownDepth = nullptr;
+	deviceContext->OMGetRenderTargets(1, &renderTarget, &ownDepth);
+	if (ownDepth)
+		ownDepth->Release();
+	if (!renderTarget) return false;
+
+	ID3D11Resource* resource = nullptr;
+	renderTarget->GetResource(&resource);
+	D3D11_TEXTURE2D_DESC targetDesc = {};
+	((ID3D11Texture2D*)resource)->GetDesc(&targetDesc);
+	resource->Release();
+
+	bool matches = int(targetDesc.Width) == width && int(targetDesc.Height) == height;
+	if (matches) {
+		deviceContext->OMSetRenderTargets(1, &renderTarget, depthStencilView);
+		deviceContext->OMSetDepthStencilState(mainPassState, 0);
+	}
+	renderTarget->Release();
+	return matches;
+}
+
+void DepthPrepass::endMainPass(D3D* renderer) {
+	renderer->setZBuffer(true);
+}
+
+void DepthPrepass::show(D3D* renderer, PPTextureShader* textureShader, XMMATRIX orthoViewMatrix) {
+	GLOBALS.RenderBackend->invalidateState();//the ortho mesh and texture get bound straight through the context
+	renderer->setZBuffer(false);
+	OrthoMesh ortho(GLOBALS.Device, GLOBALS.DeviceContext, width, height);
+	ortho.sendData(GLOBALS.DeviceContext);
+	textureShader->setShaderParameters(GLOBALS.DeviceContext, renderer->getWorldMatrix(), orthoViewMatrix, renderer->getOrthoMatrix(), XMFLOAT3(0, 0, 0));
+	textureShader->setTextureData(GLOBALS.DeviceContext, shaderResourceView);
+	GLOBALS.RenderBackend->drawIndexed(textureShader, ortho.getIndexCount());
+	renderer->setZBuffer(true);
+}
\ No newline at end of file
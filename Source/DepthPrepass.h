@@ -0,0 +1,42 @@
+#pragma once
+
+/** The scene's depth buffer, filled by a depth-only pass over the opaque geometry before anything gets shaded.
+	The main pass then binds it under its colour target and tests against it with LESS_EQUAL and depth writes off, so terrain_fs and ruinblock_fs only run once per visible pixel.
+	The buffer is also readable as a texture, which is what fog reconstructs the distance to each pixel from.
+*/
+
+#include "DXF.h"
+
+class PPTextureShader;
+
+class DepthPrepass {
+
+public:
+	DepthPrepass(ID3D11Device* device, int width, int height);
+	~DepthPrepass();
+
+	///Clears the depth buffer and binds it alone, with no colour target; render the opaque geometry after this
+	void begin(ID3D11DeviceContext* deviceContext);
+	///Goes back to the back buffer and the default depth state
+	void end(D3D* renderer);
+	///Swaps the depth buffer in under whichever colour target is currently bound, with LESS_EQUAL testing and no depth writes.
+	///Returns false, leaving things as they were, if the colour target is a different size than the depth buffer (eg a post processing pass set up at a different size).
+	bool beginMainPass(ID3D11DeviceContext* deviceContext);
+	///Puts the default depth state back (the depth buffer stays bound until the render target changes)
+	void endMainPass(D3D* renderer);
+
+	inline ID3D11ShaderResourceView* getShaderResourceView() { return shaderResourceView; }
+
+	///Debug: shows the (non-linear) contents of the depth buffer over the whole screen
+	void show(D3D* renderer, PPTextureShader* textureShader, XMMATRIX orthoViewMatrix);
+
+private:
+	int width, height;
+	ID3D11Texture2D* texture = nullptr;//R32_TYPELESS so it can be both a depth buffer and a texture
+	ID3D11DepthStencilView* depthStencilView = nullptr;
+	ID3D11ShaderResourceView* shaderResourceView = nullptr;
+	ID3D11DepthStencilState* prepassState = nullptr;//LESS, writes on
+	ID3D11DepthStencilState* mainPassState = nullptr;//LESS_EQUAL, writes off
+	D3D11_VIEWPORT viewport;
+
+};
\ No newline at end of file
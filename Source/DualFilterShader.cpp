@@ -0,0 +1,33 @@
+#include "DualFilterShader.h"
+
+#include "AppGlobals.h"
+#include "RenderBackend.h"
+
+DualFilterShader::DualFilterShader() {
+	SETUP_SHADER(postprocessing_vs, dualfilter_fs);
+}
+
+
+DualFilterShader::~DualFilterShader(){
+	for (std::vector<CachedConstantBuffer*>& buffers : filterBuffers) {
+		for (CachedConstantBuffer* buffer : buffers) {
+			delete buffer;
+		}
+	}
+}
+
+void DualFilterShader::setFilter(bool upsample, int sourceLevel, int sourceWidth, int sourceHeight) {
+	std::vector<CachedConstantBuffer*>& buffers = filterBuffers[upsample ? 1 : 0];
+	while (int(buffers.size()) <= sourceLevel) {
+		buffers.push_back(new CachedConstantBuffer(renderer, sizeof(DualFilterBufferType)));
+	}
+
+	//Send filter data
+	DualFilterBufferType filter;
+	float texels = upsample ? 0.5f : 1.f;
+	filter.offset = XMFLOAT2(texels / sourceWidth, texels / sourceHeight);
+	filter.upsample = upsample ? 1.f : 0.f;
+	filter.padding = 0;
+	buffers[sourceLevel]->update(&filter);
+	GLOBALS.RenderBackend->setConstantBuffer(RenderBackend::PS, 0, buffers[sourceLevel]->getBuffer());
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+#include "PostProcessingShader.h"
+#include <vector>
+
+///Downsampling and upsampling passes of the bloom chain (see BloomChain)
+class DualFilterShader : public PostProcessingShader {
+protected:
+	struct DualFilterBufferType {
+		XMFLOAT2 offset;//in uv: one texel of the source when downsampling, half a texel of the source when upsampling
+		float upsample;//0: downsample; 1: upsample
+		float padding;
+	};
+
+public:
+	DualFilterShader();
+	~DualFilterShader();
+
+	///Sends the filter params, for a source texture of the given size; each level of the chain (sourceLevel) has a buffer of its own in each direction, so they're only uploaded when the chain changes
+	void setFilter(bool upsample, int sourceLevel, int sourceWidth, int sourceHeight);
+
+private:
+	std::vector<CachedConstantBuffer*> filterBuffers[2];//downsampling, upsampling; by source level
+};
\ No newline at end of file
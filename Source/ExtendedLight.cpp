@@ -1,29 +1,22 @@
 #include "ExtendedLight.h"
 
 #include "AppGlobals.h"
-#include "PostProcessingPass.h"
-#include "PPTextureShader.h"
+#include "ShadowMap.h"
 #include "Utils.h"
 
 ExtendedLight::ExtendedLight() {
 }
 
 ExtendedLight::~ExtendedLight() {
-	if (shadowsSetup) {
-		delete texShader;
-		delete depthPass;
-	}
+	if (shadowMapTarget)
+		delete shadowMapTarget;
 }
 
 ///Prepares this light for shadow mapping
 void ExtendedLight::setupShadows() {
-	if (shadowsSetup) {
-		delete texShader;
-		delete depthPass;
-	}
-	texShader = new PPTextureShader;
-	depthPass = new PostProcessingPass;
-	depthPass->Setup(GLOBALS.Device, GLOBALS.DeviceContext, shadowMapRes, shadowMapRes, texShader);
+	if (shadowMapTarget)
+		delete shadowMapTarget;
+	shadowMapTarget = new ShadowMap(GLOBALS.Device, int(shadowMapRes));
 	setShadowmapSize(shadowmapWorldSize);//generate projection or ortho matrix
 	shadowsSetup = true;
 }
@@ -33,7 +26,7 @@ bool ExtendedLight::StartRecordingShadowmap() {
 	if (shouldBypassShadows()) return false;//cannot have shadowmaps for point lights or spotlights yet
 
 	generateViewMatrix();
-	depthPass->Begin(GLOBALS.Renderer, GLOBALS.DeviceContext, XMFLOAT3(0,0,0));
+	shadowMapTarget->begin(GLOBALS.DeviceContext);
 
 	return true;
 }
@@ -41,9 +34,9 @@ bool ExtendedLight::StartRecordingShadowmap() {
 ID3D11ShaderResourceView* ExtendedLight::StopRecordingShadowmap() {
 	if (shouldBypassShadows()) return nullptr;
 
-	depthPass->End();
+	shadowMapTarget->end(GLOBALS.Renderer);
 
-	shadowMap = depthPass->getRenderTexture()->getShaderResourceView();
+	shadowMap = shadowMapTarget->getShaderResourceView();
 
 	return shadowMap;
 }
@@ -56,7 +49,10 @@ void ExtendedLight::updateFov(float fov){
 void ExtendedLight::setShadowmapRes(int res) {
 	shadowMapRes = res;
 	if (shouldBypassShadows()) return;
-	depthPass->setSize(res, res);
+	//a new target entirely, as textures can't be resized
+	delete shadowMapTarget;
+	shadowMapTarget = new ShadowMap(GLOBALS.Device, res);
+	shadowMap = nullptr;
 }
 
 void ExtendedLight::setShadowmapSize(float sz) {
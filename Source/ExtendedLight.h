@@ -11,8 +11,7 @@
 
 #define SHADOWMAP_RES 2048 //default shadowmap res
 
-extern class PPTextureShader;
-extern class PostProcessingPass;
+class ShadowMap;
 
 class ExtendedLight : public Light {
 
@@ -21,8 +20,7 @@ protected:
 	float type = POINT_LIGHT;
 
 	//Shadow mapping:
-	PostProcessingPass* depthPass = nullptr;
-	PPTextureShader* texShader = nullptr;
+	ShadowMap* shadowMapTarget = nullptr;
 	bool shadowsSetup = false;
 	ID3D11ShaderResourceView* shadowMap = nullptr;
 	float shadowmapWorldSize = 50;
@@ -0,0 +1,234 @@
+#include "GenerationBenchmark.h"
+
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <thread>
+#include "AppGlobals.h"
+#include "Heightmap.h"
+#include "PerlinNoise.h"
+#include "TerrainMesh.h"
+#include "RuinsMap.h"
+#include "RuinBlockMesh.h"
+
+#define BENCHMARK_SEED 424242 //offset by the size for each run, and kept away from the default terrain seed, as some of these write their results to the save folder (the heightmap ones clean up after themselves)
+#define BENCHMARK_ITERATIONS 20
+
+
+void GenerationBenchmark::runAll(const std::string& outputFile) {
+	printf("Running generation benchmarks...\n");
+	std::vector<Result> results;
+
+	int sizes[] = { 64, 120, 256 };//120 is the size of the heightmaps of 100x100 chunks
+	for (int size : sizes) {
+		heightmapPasses(results, size);
+		perlinNoise(results, size);
+	}
+	int chunkSizes[] = { 50, 100, 200 };
+	for (int size : chunkSizes) {
+		terrainMesh(results, size);
+	}
+	ruinBlocks(results);
+
+	writeJson(results, outputFile);
+}
+
+template<typename Body>
+GenerationBenchmark::Result GenerationBenchmark::measure(const std::string& name, int size, double itemsPerIteration, const std::string& unit, int iterations, Body body) {
+	Result result = { name, size, itemsPerIteration, unit };
+	for (int i = 0; i < iterations; ++i) {
+		Stopwatch stopwatch;
+		body(stopwatch);
+		result.micros.push_back(stopwatch.elapsed);
+	}
+	print(result);
+	return result;
+}
+
+///Passes the heightmap benchmarks go through, one of each kind; the pointwise ones (nodes 2..4) get fused like they would be in any graph
+static const char* benchmarkGraph =
+	"faulting points=6 range=16\n"
+	"blur amount=1.5\n"
+	"noise scale=0.2 range=0.7\n"
+	"noise scale=0.4 range=0.35\n"
+	"terraces step=0.5 amount=0.5\n"
+	"erosion iterations=10 talus=0.05 amount=0.5\n";
+
+///Runs a generation task to the end, waiting on the workers whenever it's away on one
+static void runToCompletion(GenerationTask task) {
+	while (!task.Continue()) std::this_thread::yield();
+}
+
+void GenerationBenchmark::heightmapPasses(std::vector<Result>& results, int size) {
+	Heightmap heightmap(BENCHMARK_SEED + size, size);
+	heightmap.graph.parse(benchmarkGraph);
+	const std::vector<GenerationNode>& nodes = heightmap.graph.getNodes();
+	CancellationToken token;
+	double cells = double(size) * size;
+
+	results.push_back(measure("heightmap/faulting", size, cells, "cells", BENCHMARK_ITERATIONS, [&](Stopwatch& s) {
+		s.start();
+		runToCompletion(heightmap.asyncVoronoiFaulting(nodes[0].points, nodes[0].range, token));
+		s.stop();
+	}));
+	results.push_back(measure("heightmap/blur", size, cells, "cells", BENCHMARK_ITERATIONS, [&](Stopwatch& s) {
+		s.start();
+		runToCompletion(heightmap.asyncSmoothe(nodes[1].amount, token));
+		s.stop();
+	}));
+	results.push_back(measure("heightmap/pointwise", size, cells, "cells", BENCHMARK_ITERATIONS, [&](Stopwatch& s) {
+		s.start();
+		runToCompletion(heightmap.asyncPointwise(2, 5, token));
+		s.stop();
+	}));
+	results.push_back(measure("heightmap/erosion", size, cells * nodes[5].iterations, "cells", BENCHMARK_ITERATIONS, [&](Stopwatch& s) {
+		s.start();
+		runToCompletion(heightmap.asyncErosion(nodes[5].iterations, nodes[5].talus, nodes[5].amount, token));
+		s.stop();
+	}));
+	results.push_back(measure("heightmap/graph", size, cells, "cells", BENCHMARK_ITERATIONS, [&](Stopwatch& s) {
+		std::remove(heightmap.saveName().c_str());//the graph saves the heightmap once it's done, which is part of what's being timed
+		s.start();
+		runToCompletion(heightmap.asyncGenerate(token));
+		s.stop();
+	}));
+	results.push_back(measure("heightmap/write", size, cells, "cells", BENCHMARK_ITERATIONS, [&](Stopwatch& s) {
+		std::remove(heightmap.saveName().c_str());//write() leaves files that already exist alone
+		s.start();
+		heightmap.write();
+		s.stop();
+	}));
+	results.push_back(measure("heightmap/read", size, cells, "cells", BENCHMARK_ITERATIONS, [&](Stopwatch& s) {
+		s.start();
+		heightmap.read();
+		s.stop();
+	}));
+	std::remove(heightmap.saveName().c_str());
+}
+
+void GenerationBenchmark::perlinNoise(std::vector<Result>& results, int size) {
+	Random random(BENCHMARK_SEED, GLOBALS.LegacyRandom);
+	PerlinNoise noise(random);
+	float sum = 0;//keep the results around so the noise calls can't be optimized out
+
+	results.push_back(measure("perlinNoise/grid", size, double(size) * size, "samples", BENCHMARK_ITERATIONS, [&](Stopwatch& s) {
+		s.start();
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				sum += noise.noise(0.2f * x, 0.2f * y, 0);
+			}
+		}
+		s.stop();
+	}));
+	std::vector<float> row(size, 0.f);
+	results.push_back(measure("perlinNoise/rows", size, double(size) * size, "samples", BENCHMARK_ITERATIONS, [&](Stopwatch& s) {
+		s.start();
+		for (int y = 0; y < size; ++y) {
+			noise.addRow(row.data(), size, 0.2f, 0.2f * y, 1.f);
+		}
+		s.stop();
+		sum += row[0];
+	}));
+	if (sum == INFINITY) printf("%f\n", sum);
+}
+
+void GenerationBenchmark::terrainMesh(std::vector<Result>& results, int size) {
+	RuinBlockLibrary library(4, BENCHMARK_SEED);
+	TerrainMesh mesh(BENCHMARK_SEED + size, 0, 0, size, &library);
+	while (mesh.heightmap->currentOperation) mesh.heightmap->update();//finish generating the heightmap so we work on real data
+	double verts = double(size) * size;
+
+	results.push_back(measure("terrainMesh/realHeights", size, verts, "vertices", BENCHMARK_ITERATIONS, [&](Stopwatch& s) {
+		s.start();
+		mesh.computeRealHeights();
+		s.stop();
+	}));
+	results.push_back(measure("terrainMesh/normals", size, verts, "vertices", BENCHMARK_ITERATIONS, [&](Stopwatch& s) {
+		s.start();
+		mesh.calculateNormals();
+		s.stop();
+	}));
+	std::vector<TerrainMesh::VertexType_Tangent> vertices(size);//one row
+	results.push_back(measure("terrainMesh/vertices", size, verts, "vertices", BENCHMARK_ITERATIONS, [&](Stopwatch& s) {
+		s.start();
+		for (int y = 0; y < size; ++y) {
+			mesh.fillVertexRow(vertices.data(), y);
+		}
+		s.stop();
+	}));
+	results.push_back(measure("terrainMesh/initBuffers", size, verts, "vertices", BENCHMARK_ITERATIONS, [&](Stopwatch& s) {
+		s.start();
+		mesh.initBuffers(GLOBALS.Device);
+		s.stop();
+	}));
+	results.push_back(measure("ruinsMap/generate", size - 1, double(size - 1) * (size - 1), "cells", BENCHMARK_ITERATIONS, [&](Stopwatch& s) {
+		s.start();
+		RuinsMap ruins(BENCHMARK_SEED, size - 1, TerrainField(mesh.cellSlopes), TerrainField(mesh.realHeights, 1), &library);
+		while (ruins.currentOperation) ruins.update(false);
+		s.stop();
+	}));
+}
+
+void GenerationBenchmark::ruinBlocks(std::vector<Result>& results) {
+	int index = 0;
+	results.push_back(measure("ruinBlockMesh/generate", 1, 1, "blocks", BENCHMARK_ITERATIONS * 5, [&](Stopwatch& s) {
+		Random random(BENCHMARK_SEED, GLOBALS.LegacyRandom);
+		random.beginStream(index++);
+		s.start();
+		RuinBlockMesh* block = new RuinBlockMesh(&random);
+		s.stop();
+		delete block;
+	}));
+}
+
+double GenerationBenchmark::percentile(const std::vector<double>& sorted, double p) {
+	if (sorted.empty()) return 0;
+	int index = int(p * (sorted.size() - 1) + 0.5);
+	return sorted[std::min(index, int(sorted.size()) - 1)];
+}
+
+void GenerationBenchmark::print(const Result& result) {
+	std::vector<double> sorted = result.micros;
+	std::sort(sorted.begin(), sorted.end());
+	double median = percentile(sorted, 0.5);
+	printf("%-28s size %4d: median %10.1f us, p90 %10.1f us, %12.0f %s/s\n", result.name.c_str(), result.size, median, percentile(sorted, 0.9), result.itemsPerIteration / (median * 1e-6), result.unit.c_str());
+}
+
+void GenerationBenchmark::writeJson(const std::vector<Result>& results, const std::string& outputFile) {
+	//create directory if needed
+	size_t slash = outputFile.find_last_of('/');
+	if (slash != std::string::npos) {
+		CreateDirectory(outputFile.substr(0, slash).c_str(), NULL);
+	}
+
+	std::ofstream stream(outputFile, std::ios::out | std::ios::trunc);
+	if (!stream.is_open()) {
+		printf("File %s could not be opened for writing.\n", outputFile.c_str());
+		return;
+	}
+
+	stream << "{\n\t\"seed\": " << BENCHMARK_SEED << ",\n\t\"legacyRandom\": " << (GLOBALS.LegacyRandom ? "true" : "false") << ",\n\t\"benchmarks\": [\n";
+	for (int i = 0; i < results.size(); ++i) {
+		const Result& result = results[i];
+		std::vector<double> sorted = result.micros;
+		std::sort(sorted.begin(), sorted.end());
+		double mean = 0;
+		for (double t : sorted) mean += t;
+		mean /= sorted.size();
+		double median = percentile(sorted, 0.5);
+
+		stream << "\t\t{ \"name\": \"" << result.name << "\", \"size\": " << result.size << ", \"iterations\": " << sorted.size()
+			<< ", \"unit\": \"" << result.unit << "\", \"itemsPerIteration\": " << result.itemsPerIteration
+			<< ", \"itemsPerSecond\": " << result.itemsPerIteration / (median * 1e-6)
+			<< ", \"micros\": { \"min\": " << sorted.front() << ", \"mean\": " << mean << ", \"p50\": " << median
+			<< ", \"p90\": " << percentile(sorted, 0.9) << ", \"p99\": " << percentile(sorted, 0.99) << ", \"max\": " << sorted.back() << " } }"
+			<< (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	stream << "\t]\n}\n";
+	stream.close();
+
+	printf("Wrote %d benchmark results to %s\n", results.size(), outputFile.c_str());
+}
+
+#undef BENCHMARK_SEED
+#undef BENCHMARK_ITERATIONS
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+/** Benchmarks for all the procedural generation code (heightmap passes, perlin noise, terrain mesh building, ruins).
+	Each benchmark is run a number of times at a few different sizes, and the results (throughput and percentiles) are printed out and written to a JSON file
+	so that runs can be compared with one another.
+	The heightmap passes are timed through the same coroutines and row kernels the generation uses (handing over to the workers included), one kind of graph pass at a time and then a whole graph.
+	This needs a D3D device (the meshes create their GPU buffers as they generate), so it's run from App::init when RUN_GENERATION_BENCHMARKS is defined.
+*/
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+class GenerationBenchmark {
+
+public:
+	///runs every benchmark and writes the results out to outputFile
+	static void runAll(const std::string& outputFile = "benchmarks/generation.json");
+
+protected:
+	///times only what's in between start() and stop(), so that each iteration can do some setup beforehand
+	struct Stopwatch {
+		inline void start() { begin = std::chrono::high_resolution_clock::now(); }
+		inline void stop() { elapsed += std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - begin).count(); }
+		std::chrono::high_resolution_clock::time_point begin;
+		double elapsed = 0;//microseconds
+	};
+
+	struct Result {
+		std::string name;
+		int size;
+		double itemsPerIteration;
+		std::string unit;//what the items are (cells, vertices...)
+		std::vector<double> micros;//time taken by each iteration
+	};
+
+	///runs body(stopwatch) a few times and records how long each one took
+	template<typename Body>
+	static Result measure(const std::string& name, int size, double itemsPerIteration, const std::string& unit, int iterations, Body body);
+
+	static double percentile(const std::vector<double>& sorted, double p);
+	static void print(const Result& result);
+	static void writeJson(const std::vector<Result>& results, const std::string& outputFile);
+
+	static void heightmapPasses(std::vector<Result>& results, int size);
+	static void perlinNoise(std::vector<Result>& results, int size);
+	static void terrainMesh(std::vector<Result>& results, int size);
+	static void ruinBlocks(std::vector<Result>& results);
+
+};
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "GenerationGraph.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include "FileSystem.h"
+
+#define GRAPH_KERNEL_VERSION 2 //bump whenever a pass's implementation changes its output, so saved heightmaps get regenerated
+
+///The pass types, as written in graph files
+static const char* typeNames[GenerationNode::TYPE_COUNT] = { "faulting", "blur", "noise", "terraces", "erosion" };
+
+///The parameters, as written in graph files; each is either an int or a float member of GenerationNode
+struct Parameter {
+	const char* name;
+	int GenerationNode::* intMember;
+	float GenerationNode::* floatMember;
+};
+static const Parameter parameters[] = {
+	{ "points", &GenerationNode::points, nullptr },
+	{ "range", nullptr, &GenerationNode::range },
+	{ "amount", nullptr, &GenerationNode::amount },
+	{ "scale", nullptr, &GenerationNode::scale },
+	{ "step", nullptr, &GenerationNode::step },
+	{ "iterations", &GenerationNode::iterations, nullptr },
+	{ "talus", nullptr, &GenerationNode::talus },
+};
+
+///Whether the parameters make sense for the node's type; prints out why not
+static bool validate(const GenerationNode& node, int line) {
+	const char* problem = nullptr;
+	switch (node.type) {
+	case GenerationNode::FAULTING: if (node.points < 2) problem = "faulting needs points >= 2"; break;
+	case GenerationNode::BLUR: if (node.amount <= 0) problem = "blur needs amount > 0"; break;
+	case GenerationNode::NOISE: if (node.scale <= 0) problem = "noise needs scale > 0"; break;
+	case GenerationNode::TERRACES: if (node.step <= 0 || node.amount < 0 || node.amount > 1) problem = "terraces needs step > 0 and amount within 0..1"; break;
+	case GenerationNode::EROSION: if (node.iterations < 0 || node.talus < 0 || node.amount < 0 || node.amount > 1) problem = "erosion needs iterations >= 0, talus >= 0 and amount within 0..1"; break;
+	default: break;
+	}
+	if (problem) printf("Generation graph, line %d: %s.\n", line, problem);
+	return problem == nullptr;
+}
+
+
+const GenerationGraph& GenerationGraph::Default() {
+	static GenerationGraph graph;//built on first use
+	if (graph.nodes.empty()) {
+		//fractal voronoi
+		for (float range = 16; ; range *= 0.3f) {
+			GenerationNode node = { GenerationNode::FAULTING };
+			node.points = int(100.f / range);
+			node.range = range;
+			graph.nodes.push_back(node);
+			if (range <= 5) break;
+		}
+
+		//smoothe out the resulting heights
+		GenerationNode blur = { GenerationNode::BLUR };
+		blur.amount = 1.5f;
+		graph.nodes.push_back(blur);
+
+		//a few passes of fractal perlin noise
+		for (float range = 0.7f, scale = 0.25f / 1.25f; ; range *= 0.5f, scale = 0.25f / range) {
+			GenerationNode node = { GenerationNode::NOISE };
+			node.scale = scale;
+			node.range = range;
+			graph.nodes.push_back(node);
+			if (range <= 0.3f) break;
+		}
+
+		graph.computeHash();
+	}
+	return graph;
+}
+
+bool GenerationGraph::load(const std::string& filename, GenerationGraph& graph) {
+	if (!FileSystem::fileExists(filename)) return false;
+	std::ifstream stream(filename);
+	if (!stream.is_open()) {
+		printf("File %s could not be opened for reading.\n", filename.c_str());
+		return false;
+	}
+	std::stringstream text;
+	text << stream.rdbuf();
+
+	GenerationGraph loaded;
+	if (!loaded.parse(text.str())) {
+		printf("Generation graph %s is invalid, keeping the current one.\n", filename.c_str());
+		return false;
+	}
+	graph = loaded;
+	printf("Loaded generation graph %s (%d passes, hash %s)\n", filename.c_str(), int(graph.nodes.size()), graph.hashTag().c_str());
+	return true;
+}
+
+bool GenerationGraph::parse(const std::string& text) {
+	nodes.clear();
+	std::istringstream lines(text);
+	std::string lineText;
+	int line = 0;
+	while (std::getline(lines, lineText)) {
+		++line;
+		size_t comment = lineText.find('#');
+		if (comment != std::string::npos) lineText.erase(comment);
+
+		std::istringstream words(lineText);
+		std::string word;
+		if (!(words >> word)) continue;//empty line
+
+		GenerationNode node = { GenerationNode::TYPE_COUNT };
+		for (int t = 0; t < GenerationNode::TYPE_COUNT; ++t) {
+			if (word == typeNames[t]) node.type = GenerationNode::Type(t);
+		}
+		if (node.type == GenerationNode::TYPE_COUNT) {
+			printf("Generation graph, line %d: unknown pass \"%s\".\n", line, word.c_str());
+			return false;
+		}
+
+		//key=value pairs
+		while (words >> word) {
+			size_t equals = word.find('=');
+			const Parameter* parameter = nullptr;
+			for (const Parameter& p : parameters) {
+				if (equals != std::string::npos && word.compare(0, equals, p.name) == 0 && strlen(p.name) == equals) parameter = &p;
+			}
+			if (!parameter) {
+				printf("Generation graph, line %d: unknown parameter \"%s\".\n", line, word.c_str());
+				return false;
+			}
+			const char* value = word.c_str() + equals + 1;
+			char* end;
+			if (parameter->intMember) node.*(parameter->intMember) = int(strtol(value, &end, 10));
+			else node.*(parameter->floatMember) = strtof(value, &end);
+			if (end == value || *end != '\0') {
+				printf("Generation graph, line %d: invalid value \"%s\".\n", line, word.c_str());
+				return false;
+			}
+		}
+
+		if (!validate(node, line)) return false;
+		nodes.push_back(node);
+	}
+	computeHash();
+	return true;
+}
+
+std::string GenerationGraph::hashTag() const {
+	char tag[9];
+	sprintf_s(tag, "%08x", hash);
+	return tag;
+}
+
+void GenerationGraph::computeHash() {
+	//FNV-1a over everything that affects the output
+	uint32_t h = 2166136261u;
+	auto add = [&h](uint32_t value) {
+		for (int i = 0; i < 4; ++i) {
+			h ^= (value >> (8 * i)) & 0xff;
+			h *= 16777619u;
+		}
+	};
+	auto addFloat = [&add](float value) {
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		add(bits);
+	};
+	add(GRAPH_KERNEL_VERSION);
+	for (const GenerationNode& node : nodes) {
+		add(uint32_t(node.type));
+		add(uint32_t(node.points));
+		addFloat(node.range);
+		addFloat(node.amount);
+		addFloat(node.scale);
+		addFloat(node.step);
+		add(uint32_t(node.iterations));
+		addFloat(node.talus);
+	}
+	hash = h;
+}
+
+#undef GRAPH_KERNEL_VERSION
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+/** Describes how a heightmap gets generated, as a list of passes each applied on top of the result of the previous ones.
+	The built-in graph is what the heightmaps have always looked like; res/terrain.graph overrides it if present, so worlds can be tuned without recompiling.
+	The text format is one pass per line, eg "noise scale=0.2 range=0.7" (# starts a comment), with the pass types and parameters listed in GenerationGraph.cpp.
+	Each graph has a hash, which saved heightmaps are keyed by so that changing the graph never loads heights made by a different one.
+	Consecutive pointwise passes (where each cell only depends on its own height) get fused by Heightmap into a single sweep over the cells.
+*/
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct GenerationNode {
+	enum Type {
+		FAULTING,//voronoi faulting: each cell moves up or down by the amounts of its two closest random points
+		BLUR,//gaussian blur
+		NOISE,//perlin noise
+		TERRACES,//flattens the heights into steps
+		EROSION,//thermal erosion, moving material down the slopes steeper than talus
+		TYPE_COUNT
+	};
+
+	Type type;
+	int points = 0;//faulting: how many points
+	float range = 0;//faulting, noise: height range of the displacement
+	float amount = 0;//blur: standard deviation; terraces: how much the steps are flattened (0..1); erosion: how much of the excess slope moves each iteration
+	float scale = 0;//noise: frequency
+	float step = 0;//terraces: height of each step
+	int iterations = 0;//erosion
+	float talus = 0;//erosion: height difference between neighbours past which material starts moving
+
+	inline bool isPointwise() const { return type == NOISE || type == TERRACES; }
+};
+
+class GenerationGraph {
+
+public:
+	static const GenerationGraph& Default();
+	static bool load(const std::string& filename, GenerationGraph& graph);//returns false (leaving graph as it was) if the file is missing or invalid
+	bool parse(const std::string& text);//returns false on the first invalid line
+
+	inline const std::vector<GenerationNode>& getNodes() const { return nodes; }
+	inline uint32_t getHash() const { return hash; }
+	std::string hashTag() const;//hash as a short string, for file names
+
+private:
+	void computeHash();
+
+	std::vector<GenerationNode> nodes;
+	uint32_t hash = 0;
+
+};
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+/** Shares a single per-frame time budget between all the generation work going on (heightmap and ruins coroutines, terrain buffer rebuilds).
+	InfiniteTerrain starts each frame with beginFrame(), splits it into phases (heightmaps, then buffers and ruins) with beginPhase(), and goes through the chunks by priority within each phase.
+	The coroutines yield at GENERATION_CHECKPOINT(token) once the phase's time is used up, and the non-interruptible work (buffer rebuilds) only starts if there's time left,
+	so the whole of the streaming work stays around the budget however many chunks are generating at once, and the chunks that matter most get it first.
+	Outside of a frame (eg when benchmarking), nothing is budgeted and the coroutines just run to completion.
+*/
+
+#include <chrono>
+#include <cstdint>
+#include "GenerationTask.h"
+
+///Stops a generation coroutine if its token got cancelled, and yields from it once the current phase of the frame budget is used up (work on the worker threads isn't budgeted)
+#define GENERATION_CHECKPOINT(token) { if ((token).isCancelled()) co_return; if (!GenerationWorkers::isWorkerThread() && GenerationScheduler::Instance().shouldYield()) co_yield 0; }
+
+class GenerationScheduler {
+
+public:
+	inline static GenerationScheduler& Instance() {
+		static GenerationScheduler instance;//instanciated on first use
+		return instance;
+	}
+
+	GenerationScheduler(GenerationScheduler const&) = delete;
+	void operator=(GenerationScheduler const&) = delete;
+
+	///Starts budgeting a new frame
+	inline void beginFrame(float budgetMillis) {
+		budgeted = true;
+		frameDeadline = now() + int64_t(budgetMillis * 1000);
+		deadline = frameDeadline;
+	}
+
+	///Stops budgeting, until the next beginFrame()
+	inline void endFrame() { budgeted = false; }
+
+	///Lets the work that follows use up to fraction of what's left of the frame, keeping the rest for whatever comes after it
+	inline void beginPhase(float fraction) {
+		if (!budgeted) return;
+		int64_t current = now();
+		int64_t remaining = frameDeadline > current ? frameDeadline - current : 0;
+		deadline = current + int64_t(remaining * fraction);
+	}
+
+	///Whether there's still time to start some work in the current phase
+	inline bool hasTime() const { return !budgeted || now() < deadline; }
+
+	///Whether the current phase's time is used up
+	inline bool shouldYield() const { return budgeted && now() >= deadline; }
+
+private:
+	inline GenerationScheduler() {}
+
+	///microseconds
+	static inline int64_t now() { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count(); }
+
+	bool budgeted = false;
+	int64_t frameDeadline = 0;
+	int64_t deadline = 0;//end of the current phase
+
+};
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "GenerationTask.h"
+
+#include <algorithm>
+#include "Profiler.h"
+
+#define MAX_GENERATION_WORKERS 4
+
+static thread_local bool workerThread = false;
+static thread_local std::coroutine_handle<> abandonedFrame = nullptr;//see freeOnceSuspended()
+
+
+GenerationWorkers::GenerationWorkers() {
+	//leave a core to the main thread
+	unsigned int hardware = std::thread::hardware_concurrency();
+	unsigned int count = hardware > 1 ? std::min(hardware - 1, unsigned(MAX_GENERATION_WORKERS)) : 1;
+	for (unsigned int i = 0; i < count; ++i) {
+		threads.push_back(std::thread(&GenerationWorkers::run, this));
+	}
+}
+
+GenerationWorkers::~GenerationWorkers() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+void GenerationWorkers::post(std::coroutine_handle<> work) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(work);
+	}
+	wake.notify_one();
+}
+
+bool GenerationWorkers::isWorkerThread() {
+	return workerThread;
+}
+
+void GenerationWorkers::freeOnceSuspended(std::coroutine_handle<> frame) {
+	abandonedFrame = frame;
+}
+
+void GenerationWorkers::run() {
+	workerThread = true;
+	while (true) {
+		std::coroutine_handle<> work;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+			if (queue.empty()) return;//stopping, and nothing left waiting on us
+			work = queue.front();
+			queue.pop_front();
+		}
+		if (!GenerationTask::startOnWorker(work)) continue;//dropped by its owner while queued up, and freed
+		PROFILE_SCOPE("Generation worker");
+		work.resume();//runs until the task heads back to the main thread (or finishes)
+		if (abandonedFrame) {//its owner dropped it while it was running
+			abandonedFrame.destroy();
+			abandonedFrame = nullptr;
+		}
+	}
+}
+
+#undef MAX_GENERATION_WORKERS
\ No newline at end of file
@@ -0,0 +1,216 @@
+#pragma once
+
+/** A piece of async generation (a whole heightmap, the ruins...) running as a coroutine, resumed a little at a time by its owner through Continue().
+	Tasks co_await each other to run one step after another: the child takes over straight away, co_yield goes all the way back to the owner, and once the child is done its parent
+	carries on from there. All of it goes through symmetric transfer, so there's nothing to allocate besides the coroutine frames themselves and the stack doesn't grow however deep the chain goes.
+	An awaited task lives in its parent's frame, so dropping the top-level task at any point frees everything along with it.
+	Owners cancel their work through a CancellationToken: the coroutines check it at each GENERATION_CHECKPOINT(token), and return from there.
+
+	Tasks run on whichever thread calls Continue() (the main thread), and can move some of their work over to the worker threads with co_await GenerationTask::resumeOnWorker(),
+	then come back with co_await GenerationTask::resumeOnMainThread(). While a task is away Continue() does nothing; once it's back, it picks up from there at the next Continue().
+	A task that returns while on a worker hands back to its parent on the main thread. Work done on a worker must not touch anything the main thread might be using meanwhile.
+	Dropping a task that's away on a worker never waits for it: the worker frees it instead of resuming it if it was still queued up, or as soon as it'd hand back otherwise
+	(owners cancel it first, so that's at its next checkpoint). Until then it's still running, so work done on a worker must only touch what's in the frames (copies, buffers
+	handed over...), never the owner itself, which may well be gone by then.
+*/
+
+#include <coroutine>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+///Shared flag telling generation coroutines to stop; all the copies of a token refer to the same flag
+class CancellationToken {
+public:
+	inline CancellationToken() : cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+	inline void cancel() { cancelled->store(true); }
+	inline bool isCancelled() const { return cancelled->load(); }
+private:
+	std::shared_ptr<std::atomic<bool>> cancelled;//atomic as it can be checked from the worker threads
+};
+
+///The threads generation tasks hand their heavy lifting over to
+class GenerationWorkers {
+
+public:
+	inline static GenerationWorkers& Instance() {
+		static GenerationWorkers instance;//instanciated on first use, threads are joined on exit
+		return instance;
+	}
+
+	GenerationWorkers(GenerationWorkers const&) = delete;
+	void operator=(GenerationWorkers const&) = delete;
+	~GenerationWorkers();
+
+	void post(std::coroutine_handle<> work);//resumes work on one of the threads
+	static bool isWorkerThread();
+	static void freeOnceSuspended(std::coroutine_handle<> frame);//worker threads only: frees frame once the work being resumed suspends, ie can't be touched anymore
+
+private:
+	GenerationWorkers();
+	void run();
+
+	std::vector<std::thread> threads;
+	std::deque<std::coroutine_handle<>> queue;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+
+};
+
+class GenerationTask {
+public:
+	struct promise_type;
+	using handle = std::coroutine_handle<promise_type>;
+
+	///Where a chain of tasks is at; the owner only abandons it while it's QUEUED or ON_WORKER, and the worker only hands it back from ON_WORKER, so the two can't both end up with it
+	enum Location { ON_MAIN_THREAD, QUEUED, ON_WORKER, ABANDONED };
+
+	///Hands back to the parent once done, or to whoever resumed us for the top-level task
+	struct FinalAwaiter {
+		inline bool await_ready() noexcept { return false; }
+		inline std::coroutine_handle<> await_suspend(handle h) noexcept {
+			promise_type& promise = h.promise();
+			promise_type& root = *promise.root;
+			if (promise.parent) root.leaf = promise.parent;
+			if (root.location.load(std::memory_order_relaxed) != ON_MAIN_THREAD) {//done on a worker: anything left carries on on the main thread
+				handBack(root);
+				return std::noop_coroutine();
+			}
+			if (promise.parent) return promise.parent;
+			return std::noop_coroutine();
+		}
+		inline void await_resume() noexcept {}
+	};
+
+	struct promise_type {
+		std::coroutine_handle<> parent;//the task awaiting this one, null for the top-level task
+		promise_type* root = this;//the top-level task's promise, which keeps track of where the whole chain is at
+		std::coroutine_handle<> leaf;//top-level task only - the innermost task currently running, which Continue() resumes
+		std::atomic<int> location{ ON_MAIN_THREAD };//top-level task only - where the chain is at
+
+		inline promise_type() {}
+		inline ~promise_type() {}
+		inline auto initial_suspend() { return std::suspend_always{}; }//suspend initially, until the owner or the parent starts us
+		inline auto final_suspend() noexcept { return FinalAwaiter{}; }
+		inline void return_void() {}
+		inline auto yield_value(int v) { return std::suspend_always{}; }//always suspend on yield (otherwise whats the point of yielding); the leaf stays where it is
+		inline GenerationTask get_return_object() { leaf = handle::from_promise(*this); return GenerationTask{ handle::from_promise(*this) }; }
+		inline void unhandled_exception() { printf("An exception occured...\n"); std::exit(100); }
+	};
+
+	///co_await'ing a task runs it to completion as part of the current one
+	struct ChildAwaiter {
+		handle child;
+		inline bool await_ready() noexcept { return !child || child.done(); }
+		inline std::coroutine_handle<> await_suspend(handle parent) noexcept {
+			promise_type& promise = child.promise();
+			promise.parent = parent;
+			promise.root = parent.promise().root;
+			promise.root->leaf = child;
+			return child;//start it right away
+		}
+		inline void await_resume() noexcept {}
+	};
+	inline ChildAwaiter operator co_await() && noexcept { return ChildAwaiter{ coroutineHandle }; }
+
+	struct WorkerAwaiter {
+		inline bool await_ready() noexcept { return GenerationWorkers::isWorkerThread(); }
+		inline void await_suspend(handle h) {
+			promise_type& root = *h.promise().root;
+			root.leaf = h;
+			root.location.store(QUEUED, std::memory_order_release);
+			GenerationWorkers::Instance().post(h);//don't touch the frame past this point, it may already be running
+		}
+		inline void await_resume() noexcept {}
+	};
+	struct MainThreadAwaiter {
+		inline bool await_ready() noexcept { return !GenerationWorkers::isWorkerThread(); }
+		inline void await_suspend(handle h) noexcept {
+			promise_type& root = *h.promise().root;
+			root.leaf = h;
+			handBack(root);//the owner resumes it whenever it next calls Continue()
+		}
+		inline void await_resume() noexcept {}
+	};
+	///Carries on on a worker thread
+	static inline WorkerAwaiter resumeOnWorker() { return WorkerAwaiter{}; }
+	///Carries on on the main thread, at the owner's next Continue()
+	static inline MainThreadAwaiter resumeOnMainThread() { return MainThreadAwaiter{}; }
+
+	/// Continues execution from wherever the task is at (unless it's away on a worker); returns whether it's finished
+	inline bool Continue() {
+		promise_type& root = coroutineHandle.promise();
+		if (!finished && root.location.load(std::memory_order_acquire) == ON_MAIN_THREAD) {
+			if (!coroutineHandle.done()) root.leaf.resume();//(it may have just finished on a worker)
+			finished = root.location.load(std::memory_order_acquire) == ON_MAIN_THREAD && coroutineHandle.done();
+		}
+		return finished;
+	}
+
+	/// Returns whether the task is finished or not
+	inline bool IsFinished() const { return finished; }
+
+	/// Returns whether the task is currently running on a worker, in which case Continue() won't do anything
+	inline bool IsOnWorker() const { return coroutineHandle && coroutineHandle.promise().location.load(std::memory_order_acquire) != ON_MAIN_THREAD; }
+
+	inline ~GenerationTask() { release(); }
+
+	//make task movable but not copyable
+	inline GenerationTask(const GenerationTask&) = delete;
+	inline GenerationTask(GenerationTask&& t) : coroutineHandle(t.coroutineHandle), finished(t.finished) { t.coroutineHandle = nullptr; }
+	inline GenerationTask& operator = (const GenerationTask&) = delete;
+	inline GenerationTask& operator = (GenerationTask&& t) {
+		if (this != &t) {
+			release();
+			coroutineHandle = t.coroutineHandle;
+			finished = t.finished;
+			t.coroutineHandle = nullptr;
+		}
+		return *this;
+	}
+
+private:
+	inline GenerationTask(handle h) : coroutineHandle(h) {}
+
+	friend class GenerationWorkers;
+
+	inline void release() {
+		if (!coroutineHandle) return;
+		std::atomic<int>& location = coroutineHandle.promise().location;
+		int current = location.load(std::memory_order_acquire);
+		while (current != ON_MAIN_THREAD) {//away on a worker: leave it to the worker to free, rather than wait for it
+			if (location.compare_exchange_weak(current, ABANDONED, std::memory_order_acq_rel)) {
+				coroutineHandle = nullptr;
+				return;
+			}
+		}
+		coroutineHandle.destroy();
+		coroutineHandle = nullptr;
+	}
+
+	///Called by the worker once the chain is suspended on its way back to the main thread; frees it instead if the owner dropped it meanwhile
+	static inline void handBack(promise_type& root) {
+		int onWorker = ON_WORKER;
+		if (root.location.compare_exchange_strong(onWorker, ON_MAIN_THREAD, std::memory_order_acq_rel)) return;//last thing we touch, the owner can pick it straight back up
+		GenerationWorkers::freeOnceSuspended(handle::from_promise(root));//(can't free it from in here, the frame's still suspending)
+	}
+
+	///Called by the worker about to resume work; returns false (having freed the whole chain) if the owner dropped it meanwhile
+	static inline bool startOnWorker(std::coroutine_handle<> work) {
+		promise_type& root = *handle::from_address(work.address()).promise().root;
+		int queued = QUEUED;
+		if (root.location.compare_exchange_strong(queued, ON_WORKER, std::memory_order_acq_rel)) return true;
+		handle::from_promise(root).destroy();
+		return false;
+	}
+
+	handle coroutineHandle = nullptr;
+	bool finished = false;
+};
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "GpuTimer.h"
+
+#include <cstring>
+#include "DXF.h"
+#include "Shader.h"
+
+#define GPU_TIMING_SMOOTHING 0.9f //how much of the previous value is kept each time a frame's results come in, so the numbers stay readable
+
+
+GpuTimer::GpuTimer(GpuQueryBackend* backend) : backend(backend) {
+}
+
+GpuTimer::~GpuTimer() {
+	delete backend;
+}
+
+void GpuTimer::beginFrame() {
+	collect();
+
+	int slot = int(frame % FRAMES_IN_FLIGHT);
+	if (slots[slot].pending) {//the gpu is more than FRAMES_IN_FLIGHT frames behind; forget about that frame rather than waiting on it
+		++droppedFrames;
+	}
+	slots[slot].frame = frame;
+	slots[slot].pending = false;
+	slots[slot].passCount = 0;
+
+	backend->beginDisjoint(slot);
+	backend->timestamp(slot, 0);
+	recording = true;
+	depth = 0;
+}
+
+void GpuTimer::endFrame() {
+	if (!recording) return;
+	int slot = int(frame % FRAMES_IN_FLIGHT);
+	//close any pass still open so none of its timestamps are left unwritten
+	for (int pass = 0; pass < slots[slot].passCount; ++pass) {
+		if (!slots[slot].ended[pass]) endPass(pass);
+	}
+	backend->timestamp(slot, 1);
+	backend->endDisjoint(slot);
+	slots[slot].pending = true;
+	recording = false;
+	++frame;
+}
+
+int GpuTimer::beginPass(const char* name) {
+	Slot& slot = slots[frame % FRAMES_IN_FLIGHT];
+	if (!recording || slot.passCount >= MAX_PASSES) return -1;
+	int pass = slot.passCount++;
+	slot.names[pass] = name;
+	slot.depths[pass] = depth++;
+	slot.ended[pass] = false;
+	backend->timestamp(int(frame % FRAMES_IN_FLIGHT), 2 + 2 * pass);
+	return pass;
+}
+
+void GpuTimer::endPass(int pass) {
+	Slot& slot = slots[frame % FRAMES_IN_FLIGHT];
+	if (pass < 0 || !recording || slot.ended[pass]) return;
+	slot.ended[pass] = true;
+	--depth;
+	backend->timestamp(int(frame % FRAMES_IN_FLIGHT), 3 + 2 * pass);
+}
+
+void GpuTimer::collect() {
+	//oldest first; the gpu finishes frames in order, so as soon as one isn't ready the later ones won't be either
+	uint64_t oldest = frame > FRAMES_IN_FLIGHT ? frame - FRAMES_IN_FLIGHT : 0;
+	for (uint64_t f = oldest; f < frame; ++f) {
+		int slot = int(f % FRAMES_IN_FLIGHT);
+		if (!slots[slot].pending || slots[slot].frame != f) continue;
+		if (!collectSlot(slot)) break;
+	}
+}
+
+bool GpuTimer::collectSlot(int slotIndex) {
+	Slot& slot = slots[slotIndex];
+	uint64_t frequency;
+	bool disjoint;
+	if (!backend->readDisjoint(slotIndex, frequency, disjoint)) return false;
+
+	uint64_t frameStart, frameEnd;
+	if (!backend->readTimestamp(slotIndex, 0, frameStart) || !backend->readTimestamp(slotIndex, 1, frameEnd)) return false;
+	std::vector<uint64_t> ticks(2 * slot.passCount);
+	for (int i = 0; i < 2 * slot.passCount; ++i) {
+		if (!backend->readTimestamp(slotIndex, 2 + i, ticks[i])) return false;
+	}
+	slot.pending = false;
+	if (disjoint || frequency == 0) return true;//the gpu clock changed mid-frame, the timestamps are meaningless
+
+	double toMillis = 1000.0 / double(frequency);
+	frameMillis = GPU_TIMING_SMOOTHING * frameMillis + (1 - GPU_TIMING_SMOOTHING) * float(double(frameEnd - frameStart) * toMillis);
+
+	//add up passes that ran more than once in the frame
+	std::vector<float> totals(passes.size(), 0);
+	std::vector<int> counts(passes.size(), 0);
+	int previous = -1;
+	for (int i = 0; i < slot.passCount; ++i) {
+		int index = -1;
+		for (int p = 0; p < passes.size(); ++p) {
+			if (passes[p].depth == slot.depths[i] && strcmp(passes[p].name, slot.names[i]) == 0) {
+				index = p;
+				break;
+			}
+		}
+		if (index < 0) {//first time we see this pass; slot it in right after the one before it so nested passes stay under their parent
+			index = previous + 1;
+			passes.insert(passes.begin() + index, PassTiming{ slot.names[i], slot.depths[i], 0, 0 });
+			totals.insert(totals.begin() + index, 0.f);
+			counts.insert(counts.begin() + index, 0);
+		}
+		totals[index] += float(double(ticks[2 * i + 1] - ticks[2 * i]) * toMillis);
+		counts[index]++;
+		previous = index;
+	}
+	for (int p = int(passes.size()) - 1; p >= 0; --p) {
+		if (counts[p] == 0) {//didn't run this frame (eg switched off); drop it rather than keep showing its last timing
+			passes.erase(passes.begin() + p);
+			continue;
+		}
+		passes[p].millis = GPU_TIMING_SMOOTHING * passes[p].millis + (1 - GPU_TIMING_SMOOTHING) * totals[p];
+		passes[p].count = counts[p];
+	}
+	return true;
+}
+
+void GpuTimer::gui() {
+	for (const PassTiming& pass : passes) {
+		if (pass.count > 1) ImGui::Text("%*s%s: %.3f ms (x%d)", pass.depth * 2, "", pass.name, pass.millis, pass.count);
+		else ImGui::Text("%*s%s: %.3f ms", pass.depth * 2, "", pass.name, pass.millis);
+	}
+	if (droppedFrames) ImGui::Text("%llu frame(s) dropped", droppedFrames);
+}
+
+
+
+D3D11QueryBackend::D3D11QueryBackend(ID3D11Device* device, ID3D11DeviceContext* deviceContext) : deviceContext(deviceContext) {
+	D3D11_QUERY_DESC disjointDesc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+	D3D11_QUERY_DESC timestampDesc = { D3D11_QUERY_TIMESTAMP, 0 };
+	for (int slot = 0; slot < GpuTimer::FRAMES_IN_FLIGHT; ++slot) {
+		HRESULT result = device->CreateQuery(&disjointDesc, &disjointQueries[slot]);
+		if (result != S_OK) {
+			printf("Could not create disjoint query: ");
+			Shader::printError(result);
+		}
+		for (int query = 0; query < GpuTimer::QUERIES_PER_FRAME; ++query) {
+			result = device->CreateQuery(&timestampDesc, &timestampQueries[slot][query]);
+			if (result != S_OK) {
+				printf("Could not create timestamp query: ");
+				Shader::printError(result);
+			}
+		}
+	}
+}
+
+D3D11QueryBackend::~D3D11QueryBackend() {
+	for (int slot = 0; slot < GpuTimer::FRAMES_IN_FLIGHT; ++slot) {
+		if (disjointQueries[slot]) disjointQueries[slot]->Release();
+		for (int query = 0; query < GpuTimer::QUERIES_PER_FRAME; ++query) {
+			if (timestampQueries[slot][query]) timestampQueries[slot][query]->Release();
+		}
+	}
+}
+
+void D3D11QueryBackend::beginDisjoint(int slot) {
+	if (disjointQueries[slot]) deviceContext->Begin(disjointQueries[slot]);
+}
+
+void D3D11QueryBackend::endDisjoint(int slot) {
+	if (disjointQueries[slot]) deviceContext->End(disjointQueries[slot]);
+}
+
+void D3D11QueryBackend::timestamp(int slot, int query) {
+	if (timestampQueries[slot][query]) deviceContext->End(timestampQueries[slot][query]);//timestamps only ever End()
+}
+
+bool D3D11QueryBackend::readDisjoint(int slot, uint64_t& frequency, bool& disjoint) {
+	if (!disjointQueries[slot]) return false;
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT data;
+	if (deviceContext->GetData(disjointQueries[slot], &data, sizeof(data), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) return false;
+	frequency = data.Frequency;
+	disjoint = data.Disjoint != FALSE;
+	return true;
+}
+
+bool D3D11QueryBackend::readTimestamp(int slot, int query, uint64_t& ticks) {
+	if (!timestampQueries[slot][query]) return false;
+	UINT64 data;
+	if (deviceContext->GetData(timestampQueries[slot][query], &data, sizeof(data), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) return false;
+	ticks = data;
+	return true;
+}
+
+#undef GPU_TIMING_SMOOTHING
\ No newline at end of file
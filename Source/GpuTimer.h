@@ -0,0 +1,116 @@
+#pragma once
+
+/** GPU timings for each render pass.
+	Each frame gets a slot in a small ring of timestamp queries (one at each end of the frame and of every pass, plus a disjoint query around the lot).
+	Results are only read back once the gpu is done with them, a few frames later, so nothing ever waits on the gpu; if it falls too far behind, the oldest frame is simply dropped.
+	The queries themselves go through GpuQueryBackend so the ring logic doesn't need a device to run (see GpuTimerCheck, which runs it against a scripted one).
+*/
+
+#include <cstdint>
+#include <vector>
+
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11Query;
+
+#define GPU_CONCAT_INNER(a, b) a##b
+#define GPU_CONCAT(a, b) GPU_CONCAT_INNER(a, b)
+#define GPU_SCOPE(name) GpuScope GPU_CONCAT(gpuScope, __LINE__)(GLOBALS.GpuTimer, name) //name must be a string literal, as only the pointer is kept
+
+///Issues the actual queries. slot is the frame's place in the ring, query the index of the timestamp within that frame.
+class GpuQueryBackend {
+public:
+	virtual ~GpuQueryBackend() {}
+	virtual void beginDisjoint(int slot) = 0;
+	virtual void endDisjoint(int slot) = 0;
+	virtual void timestamp(int slot, int query) = 0;
+	///Both of these return false if the result isn't available yet, and must never block.
+	virtual bool readDisjoint(int slot, uint64_t& frequency, bool& disjoint) = 0;
+	virtual bool readTimestamp(int slot, int query, uint64_t& ticks) = 0;
+};
+
+class GpuTimer {
+
+public:
+	static const int FRAMES_IN_FLIGHT = 4;//how many frames can be waiting on their results at once
+	static const int MAX_PASSES = 128;//per frame; any more than this aren't timed
+	static const int QUERIES_PER_FRAME = 2 + 2 * MAX_PASSES;
+
+	struct PassTiming {
+		const char* name;
+		int depth;
+		int count;//how many times the pass ran in the frame (eg once per chunk)
+		float millis;//total over the frame, smoothed over time
+	};
+
+	GpuTimer(GpuQueryBackend* backend);//takes ownership of the backend
+	~GpuTimer();
+
+	void beginFrame();//collects whatever results are ready, then starts timing a new frame
+	void endFrame();
+
+	int beginPass(const char* name);//returns the pass index to give endPass, or -1 if it isn't being timed
+	void endPass(int pass);
+
+	inline float getFrameMillis() const { return frameMillis; }
+	inline const std::vector<PassTiming>& getPasses() const { return passes; }
+	inline uint64_t getDroppedFrames() const { return droppedFrames; }
+
+	void gui();
+
+protected:
+	void collect();
+	bool collectSlot(int slot);//returns false if the gpu isn't done with that frame yet
+
+	struct Slot {
+		uint64_t frame = 0;
+		bool pending = false;//waiting on results
+		int passCount = 0;
+		const char* names[MAX_PASSES];
+		int depths[MAX_PASSES];
+		bool ended[MAX_PASSES];
+	};
+
+	GpuQueryBackend* backend;
+	Slot slots[FRAMES_IN_FLIGHT];
+	uint64_t frame = 0;//frame currently being recorded
+	bool recording = false;
+	int depth = 0;
+
+	float frameMillis = 0;
+	std::vector<PassTiming> passes;//in the order they were first seen
+	uint64_t droppedFrames = 0;
+
+};
+
+///Times the passes using ID3D11Query timestamps.
+class D3D11QueryBackend : public GpuQueryBackend {
+public:
+	D3D11QueryBackend(ID3D11Device* device, ID3D11DeviceContext* deviceContext);
+	~D3D11QueryBackend();
+
+	void beginDisjoint(int slot) override;
+	void endDisjoint(int slot) override;
+	void timestamp(int slot, int query) override;
+	bool readDisjoint(int slot, uint64_t& frequency, bool& disjoint) override;
+	bool readTimestamp(int slot, int query, uint64_t& ticks) override;
+
+private:
+	ID3D11DeviceContext* deviceContext;
+	ID3D11Query* disjointQueries[GpuTimer::FRAMES_IN_FLIGHT] = {};
+	ID3D11Query* timestampQueries[GpuTimer::FRAMES_IN_FLIGHT][GpuTimer::QUERIES_PER_FRAME] = {};
+};
+
+///Times the passes between its construction and destruction; use through GPU_SCOPE.
+class GpuScope {
+public:
+	inline GpuScope(GpuTimer* timer, const char* name) : timer(timer) {
+		pass = timer ? timer->beginPass(name) : -1;
+	}
+	inline ~GpuScope() {
+		if (timer) timer->endPass(pass);
+	}
+private:
+	GpuTimer* timer;
+	int pass;
+};
\ No newline at end of file
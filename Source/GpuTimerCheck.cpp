@@ -0,0 +1,160 @@
+#include "GpuTimerCheck.h"
+
+#include <cstdio>
+#include <cstring>
+
+void ScriptedQueryBackend::beginDisjoint(int slot) {
+	submittedAt[slot] = 0;
+}
+
+void ScriptedQueryBackend::endDisjoint(int slot) {
+	submittedAt[slot] = ++submitted;
+	disjointSlots[slot] = disjoint;
+}
+
+void ScriptedQueryBackend::timestamp(int slot, int query) {
+	ticks[slot][query] = clock;
+	clock += step;
+}
+
+bool ScriptedQueryBackend::ready(int slot) const {
+	return submittedAt[slot] != 0 && submitted - submittedAt[slot] >= uint64_t(latency);
+}
+
+bool ScriptedQueryBackend::readDisjoint(int slot, uint64_t& frequency, bool& disjoint) {
+	if (!ready(slot)) return false;
+	frequency = FREQUENCY;
+	disjoint = disjointSlots[slot];
+	return true;
+}
+
+bool ScriptedQueryBackend::readTimestamp(int slot, int query, uint64_t& ticks) {
+	if (!ready(slot)) return false;
+	ticks = this->ticks[slot][query];
+	return true;
+}
+
+
+
+///Finds a pass the timer has results for, or null
+static const GpuTimer::PassTiming* findPass(const GpuTimer& timer, const char* name, int depth) {
+	for (const GpuTimer::PassTiming& pass : timer.getPasses()) {
+		if (pass.depth == depth && strcmp(pass.name, name) == 0) return &pass;
+	}
+	return nullptr;
+}
+
+///Prints out what went wrong if condition doesn't hold
+static bool expect(bool condition, const char* what) {
+	if (!condition) printf("GpuTimer check failed: %s.\n", what);
+	return condition;
+}
+
+bool GpuTimerCheck::run() {
+	bool passed = true;
+
+	//results coming in a few frames late, without the gpu falling behind enough for any to be dropped
+	{
+		ScriptedQueryBackend* backend = new ScriptedQueryBackend;
+		GpuTimer timer(backend);
+		backend->latency = GpuTimer::FRAMES_IN_FLIGHT - 1;
+		for (int frame = 0; frame < 3; ++frame) {
+			timer.beginFrame();
+			timer.endPass(timer.beginPass("Late"));
+			timer.endFrame();
+		}
+		passed &= expect(timer.getPasses().empty(), "results read back before they were available");
+		for (int frame = 0; frame < 8; ++frame) {
+			timer.beginFrame();
+			timer.endPass(timer.beginPass("Late"));
+			timer.endFrame();
+		}
+		const GpuTimer::PassTiming* late = findPass(timer, "Late", 0);
+		passed &= expect(late && late->count == 1 && late->millis > 0 && late->millis <= 1.0001f, "late results not picked up once available");
+		passed &= expect(timer.getDroppedFrames() == 0, "frames dropped although the results came in in time");
+	}
+
+	//gpu falling behind: the oldest frames get dropped, and their slots' results never get mixed up with the frames that reuse them
+	{
+		ScriptedQueryBackend* backend = new ScriptedQueryBackend;
+		GpuTimer timer(backend);
+		backend->latency = GpuTimer::FRAMES_IN_FLIGHT + 2;
+		for (int frame = 0; frame < 10; ++frame) {
+			timer.beginFrame();
+			timer.endPass(timer.beginPass("Behind"));
+			timer.endFrame();
+		}
+		passed &= expect(timer.getDroppedFrames() > 0, "no frames dropped although the gpu fell behind");
+		passed &= expect(timer.getPasses().empty(), "results read from a slot that had been reused");
+		backend->latency = 1;
+		for (int frame = 0; frame < 4; ++frame) {
+			timer.beginFrame();
+			timer.endPass(timer.beginPass("Behind"));
+			timer.endFrame();
+		}
+		const GpuTimer::PassTiming* behind = findPass(timer, "Behind", 0);
+		passed &= expect(behind && behind->count == 1 && behind->millis <= 1.0001f, "timings wrong after catching back up");
+	}
+
+	//disjoint frames give no timings at all
+	{
+		ScriptedQueryBackend* backend = new ScriptedQueryBackend;
+		GpuTimer timer(backend);
+		backend->disjoint = true;
+		for (int frame = 0; frame < 6; ++frame) {
+			timer.beginFrame();
+			timer.endPass(timer.beginPass("Disjoint"));
+			timer.endFrame();
+		}
+		passed &= expect(timer.getPasses().empty() && timer.getFrameMillis() == 0, "timings taken from disjoint frames");
+		backend->disjoint = false;
+		for (int frame = 0; frame < 3; ++frame) {
+			timer.beginFrame();
+			timer.endPass(timer.beginPass("Disjoint"));
+			timer.endFrame();
+		}
+		passed &= expect(findPass(timer, "Disjoint", 0) != nullptr && timer.getFrameMillis() > 0, "no timings after the disjoint frames");
+	}
+
+	//the same pass run twice, nested in itself, and ended more than once
+	{
+		ScriptedQueryBackend* backend = new ScriptedQueryBackend;
+		GpuTimer timer(backend);
+		for (int frame = 0; frame < 4; ++frame) {
+			timer.beginFrame();
+			timer.endPass(timer.beginPass("Twice"));
+			timer.endPass(timer.beginPass("Twice"));
+			int outer = timer.beginPass("Nested");
+			timer.endPass(timer.beginPass("Nested"));
+			timer.endPass(outer);
+			timer.endPass(outer);//again, shouldn't unwind anything else
+			timer.beginPass("Unended");//left for endFrame() to close
+			timer.endFrame();
+		}
+		const GpuTimer::PassTiming* twice = findPass(timer, "Twice", 0);
+		passed &= expect(twice && twice->count == 2, "repeated pass not added up");
+		passed &= expect(findPass(timer, "Nested", 0) && findPass(timer, "Nested", 1), "pass nested in itself not kept apart");
+		const GpuTimer::PassTiming* unended = findPass(timer, "Unended", 0);
+		passed &= expect(unended && unended->count == 1, "ending a pass twice threw the nesting off, or an unended pass wasn't closed");
+	}
+
+	//passes that stop running drop out
+	{
+		ScriptedQueryBackend* backend = new ScriptedQueryBackend;
+		GpuTimer timer(backend);
+		for (int frame = 0; frame < 3; ++frame) {
+			timer.beginFrame();
+			timer.endPass(timer.beginPass("Before"));
+			timer.endFrame();
+		}
+		for (int frame = 0; frame < 3; ++frame) {
+			timer.beginFrame();
+			timer.endPass(timer.beginPass("After"));
+			timer.endFrame();
+		}
+		passed &= expect(!findPass(timer, "Before", 0) && findPass(timer, "After", 0), "pass that stopped running still shown");
+	}
+
+	printf("GpuTimer check %s.\n", passed ? "passed" : "failed");
+	return passed;
+}
\ No newline at end of file
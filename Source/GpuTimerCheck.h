@@ -0,0 +1,42 @@
+#pragma once
+
+/** Runs GpuTimer's query ring against ScriptedQueryBackend, which hands out made-up timestamps and only makes them available when told to, so no device is needed.
+	Goes through results coming in late, frames dropped because the gpu fell too far behind, disjoint frames, passes begun and ended more than once or nested in themselves,
+	and passes that stop running. Run from App::init when VERIFY_GPU_TIMER is defined; prints out whatever didn't come out as expected.
+*/
+
+#include <cstdint>
+#include "GpuTimer.h"
+
+///Fake query backend: the clock moves on by step ticks at each timestamp, and a frame's results only come in once latency more frames have been submitted after it
+class ScriptedQueryBackend : public GpuQueryBackend {
+public:
+	static const uint64_t FREQUENCY = 1000000;//ticks per second, so 1000 ticks is a millisecond
+
+	int latency = 1;
+	bool disjoint = false;//whether the frames submitted from now on come out disjoint
+	uint64_t step = 1000;
+
+	void beginDisjoint(int slot) override;
+	void endDisjoint(int slot) override;
+	void timestamp(int slot, int query) override;
+	bool readDisjoint(int slot, uint64_t& frequency, bool& disjoint) override;
+	bool readTimestamp(int slot, int query, uint64_t& ticks) override;
+
+private:
+	bool ready(int slot) const;
+
+	uint64_t clock = 0;
+	uint64_t submitted = 0;//frames submitted so far
+	uint64_t submittedAt[GpuTimer::FRAMES_IN_FLIGHT] = {};//when each slot's frame was, plus one (0 while recording)
+	bool disjointSlots[GpuTimer::FRAMES_IN_FLIGHT] = {};
+	uint64_t ticks[GpuTimer::FRAMES_IN_FLIGHT][GpuTimer::QUERIES_PER_FRAME] = {};
+};
+
+class GpuTimerCheck {
+
+public:
+	///returns whether everything came out as expected
+	static bool run();
+
+};
\ No newline at end of file
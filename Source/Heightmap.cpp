@@ -1,18 +1,19 @@
 #include "Heightmap.h"
 
-#include <chrono>
+#include "AppGlobals.h"
+#include "Profiler.h"
+#include "GenerationScheduler.h"
 
 //#define QUICKGEN //define this to generate a quick, bad heightmap
 #define ASYNC //if defined, the heightmaps will be generated asynchronously
 
-#ifdef TIME_HEIGHTMAP_GENERATION
-#include <chrono>
-#endif
-
 Heightmap::Heightmap(int seed, int size) : seed(seed), size(size) {
 
+	//keep our own copy of the graph, so that reloading it doesn't affect heightmaps already on their way
+	graph = GLOBALS.TerrainGraph ? *GLOBALS.TerrainGraph : GenerationGraph::Default();
+
 	//init random engine using seed; this way however we get to this point, we'll always generate the same sequence of numbers which in turn will result in the exact same data being generated.
-	randomEngine = std::default_random_engine(seed);
+	random = Random(seed, GLOBALS.LegacyRandom);
 
 	//initialize heights to 0
 	heightmap = new float*[size];
@@ -27,6 +28,8 @@ Heightmap::Heightmap(int seed, int size) : seed(seed), size(size) {
 
 Heightmap::~Heightmap() {
 
+	cancel();//(a pass still running on a worker only has its own copies, and frees itself)
+
 	if (heightmap) {
 		for (int y = 0; y < size; ++y) {
 			delete[] heightmap[y];
@@ -36,8 +39,22 @@ Heightmap::~Heightmap() {
 		heightmap = nullptr;
 	}
 
-	if (currentOperation) delete currentOperation;
+}
+
+void Heightmap::cancel() {
+	cancellation.cancel();//anything still holding onto the old token stops at its next checkpoint
+	cancellation = CancellationToken();
+	currentOperation.reset();//frees the coroutine frames, or leaves them to the worker they're queued up for or running on
+}
+
+void Heightmap::suspend() {
+	if (!currentOperation) return;//nothing left to do anyway
+	cancel();
+	suspended = true;
+}
 
+void Heightmap::resume() {
+	if (suspended) generate();
 }
 
 float Heightmap::getHeight(int x, int y) const {
@@ -54,107 +71,43 @@ float Heightmap::getSize() const {
 
 void Heightmap::generate() {
 
+	cancel();//in case we were already at it
+	suspended = false;
 
 	//have we got it saved already? - in which case, no need to re-generate it at all!
-#if !defined( TIME_HEIGHTMAP_GENERATION )
 	if (read()) return;
-#else
-	//run it 1000 times to time it
-	times.clear();
-	for (int i = 0; i < 100; ++i) {
-		std::chrono::high_resolution_clock::time_point before = timingClock.now();
-		read();
-		std::chrono::high_resolution_clock::duration duration = timingClock.now() - before;
-		times.push_back(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
-	}
-	//write it out to file
-	CreateDirectory("TimingResults", LPSECURITY_ATTRIBUTES());
-	std::ofstream stream("TimingResults/loadTimings-" + std::to_string(seed) + ".csv");
-	stream << "Times to generate heightmap,(microseconds)\n";
-	stream << ",,Min:,\"=QUARTILE(A3:A" + std::to_string(times.size() + 3) + ", 0)\",";
-	stream << "First Quartile:,\"=QUARTILE(A3:A" + std::to_string(times.size() + 3) + ", 1)\",";
-	stream << "Median:,\"=QUARTILE(A3:A" + std::to_string(times.size() + 3) + ", 2)\",";
-	stream << "Third Quartile:,\"=QUARTILE(A3:A" + std::to_string(times.size() + 3) + ", 3)\",";
-	stream << "Max:,\"=QUARTILE(A3:A" + std::to_string(times.size() + 3) + ", 4)\"\n";
-	for (int i = 0; i < times.size(); ++i) {
-		stream << std::to_string(times[i]) << "\n";
+
+	//start from flat ground, in case an earlier run got part of the way
+	for (int y = 0; y < size; ++y) {
+		std::fill(heightmap[y], heightmap[y] + size, 0.f);
 	}
-	stream.close();
-	printf("Wrote %d timing results to %s\n", times.size(), std::string("TimingResults/loadTimings-" + std::to_string(seed) + ".csv").c_str());
-	times.clear();
-	if (read()) return;//default behaviour
-#endif
 
 #ifdef ASYNC
-	currentOperation = new HeightEnumerator(asyncVoronoiFaulting(100.f/16.f, 16));
+	currentOperation.reset(new GenerationTask(asyncGenerate(cancellation)));
 #else
-	//fractal voronoi
-	for (float amount = 16; amount > 1; amount *= 0.3f) {
-		voronoiFaulting(100 / amount, amount);
-	}
-
-	smoothe(1.5f);
-
-	//fractal perlin noise
-	for (float amount = 5; amount > 0.3f; amount *= 0.5f) {
-		perlinNoise(0.5f / amount, amount);
-	}
+	//same passes, all in one go
+	GenerationTask task = asyncGenerate(cancellation);
+	while (!task.Continue());
 #endif
 
 }
 
-void Heightmap::update() {
+void Heightmap::update(bool carryOn) {
 	//continue generating heightmap
 	changed = false;
-	if (currentOperation) {//we're currently working on something
+	if (currentOperation && carryOn && !currentOperation->IsOnWorker() && GenerationScheduler::Instance().hasTime()) {//we're currently working on something (that isn't away on a worker), and there's time left this frame to carry on
+		PROFILE_SCOPE("Heightmap slice");
 		changed = true;
-#ifdef TIME_HEIGHTMAP_GENERATION
-		std::chrono::high_resolution_clock::time_point before = timingClock.now();
-#endif
-		if (!currentOperation->IsFinished()) {
-			currentOperation->Continue();//keep going
-		}
-		else {//move on to the next operation
-			HeightEnumerator* next = currentOperation->NextOperation();
-			delete currentOperation;
-			currentOperation = next;
-			if (currentOperation) {
-				currentOperation->Continue();//start this new operation immediately, no need to wait
-			}
+		if (currentOperation->Continue()) {//keep going
+			currentOperation.reset();//all done
 		}
-#ifdef TIME_HEIGHTMAP_GENERATION
-		std::chrono::high_resolution_clock::duration duration = timingClock.now() - before;
-		times.push_back(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());//add the time as microseconds
-#endif
-	}
-	else {//no more operations
-		changed = false;
-#ifdef TIME_HEIGHTMAP_GENERATION //output the results to a file
-		if (times.size() > 10) {
-			CreateDirectory("TimingResults", LPSECURITY_ATTRIBUTES());
-			std::ofstream stream("TimingResults/timings-" + std::to_string(seed) + ".csv");
-			stream << "Times to generate heightmap,(microseconds)\n";
-			stream << ",,Min:,\"=QUARTILE(A3:A" + std::to_string(times.size() + 3) + ", 0)\",";
-			stream << "First Quartile:,\"=QUARTILE(A3:A" + std::to_string(times.size() + 3) + ", 1)\",";
-			stream << "Median:,\"=QUARTILE(A3:A" + std::to_string(times.size() + 3) + ", 2)\",";
-			stream << "Third Quartile:,\"=QUARTILE(A3:A" + std::to_string(times.size() + 3) + ", 3)\",";
-			stream << "Max:,\"=QUARTILE(A3:A" + std::to_string(times.size() + 3) + ", 4)\"\n";
-			for (int i = 0; i < times.size(); ++i) {
-				stream << std::to_string(times[i]) << "\n";
-			}
-			stream.close();
-			printf("Wrote %d timing results to %s\n", times.size(), std::string("TimingResults/timings-" + std::to_string(seed) + ".csv").c_str());
-		}
-		times.clear();
-#endif
 	}
 }
 
 float Heightmap::randomFloat(float max, float min) {
 	if (max < min) std::swap(max, min);//this lets us call it using randomFloat(min, max) instead when using 2 args
 
-	float r = randomInt(10000);//using 10000 means we'll only get up to 4 decimal places but i'd argue thats pretty good already
-	r /= 10000;
+	float r = random.nextUnit(10000);//(legacy mode uses 10000 steps, which means we'll only get up to 4 decimal places but i'd argue thats pretty good already)
 
 	return min + r*(max - min);
 
@@ -163,7 +116,7 @@ float Heightmap::randomFloat(float max, float min) {
 int Heightmap::randomInt(int max, int min) {
 	if (max < min) std::swap(max, min);//this lets us call it using randomInt(min, max) instead when using 2 args
 
-	return min + (randomEngine() % (max - min));
+	return random.nextInt(max, min);
 
 }
 
@@ -171,16 +124,58 @@ float Heightmap::gauss(float distFromCenterSqr, float standardDeviation) {
 	return exp(-distFromCenterSqr / (2 * standardDeviation*standardDeviation));
 }
 
-void Heightmap::voronoiFaulting(int numPoints, float heightRange) {
 
-	XMFLOAT3* points = new XMFLOAT3[numPoints];//z coord will be the amount we fault
+
+
+GenerationTask Heightmap::asyncGenerate(CancellationToken token) {
+
+	pass = 0;//each pass's stream only depends on the seed and where the pass comes in the graph, whatever was generated before
+	const std::vector<GenerationNode>& nodes = graph.getNodes();
+	for (size_t i = 0; i < nodes.size(); ) {
+		const GenerationNode& node = nodes[i];
+		if (node.isPointwise()) {//fuse it with any pointwise passes following it
+			size_t end = i + 1;
+			while (end < nodes.size() && nodes[end].isPointwise()) ++end;
+			co_await asyncPointwise(i, end, token);
+			i = end;
+		}
+		else {
+			switch (node.type) {
+			case GenerationNode::FAULTING: co_await asyncVoronoiFaulting(node.points, node.range, token); break;
+			case GenerationNode::BLUR: co_await asyncSmoothe(node.amount, token); break;
+			case GenerationNode::EROSION: co_await asyncErosion(node.iterations, node.talus, node.amount, token); break;
+			default: break;
+			}
+			++i;
+		}
+		if (token.isCancelled()) co_return;//the passes stop early once cancelled, don't carry on from (or save) a half-done heightmap
+#ifdef QUICKGEN //in quickgen mode, only the very first step counts.
+		co_return;
+#endif
+	}
+
+	//done! save it for later.
+	write();
+}
+
+GenerationTask Heightmap::asyncVoronoiFaulting(int numPoints, float heightRange, CancellationToken token){
+
+	random.beginStream(++pass);
+	std::vector<XMFLOAT3> points;//z coord will be the amount we fault - cant use an array anymore, cos a vector will automatically release its data even if the coroutine never ends
 	for (int i = 0; i < numPoints; ++i) {
-		points[i].x = randomFloat(size);
-		points[i].y = randomFloat(size);
-		points[i].z = randomFloat(-heightRange / 2, heightRange / 2);
+		points.push_back(XMFLOAT3(
+			randomFloat(size),
+			randomFloat(size),
+			randomFloat(-heightRange / 2, heightRange / 2)
+		));
 	}
 
+	//fault a copy of the heights on a worker
+	Rows rows = copyRows();
+	const int size = this->size;//(see Rows)
+	co_await GenerationTask::resumeOnWorker();
 	for (int y = 0; y < size; ++y) {
+		float* row = rows[y].get();
 		for (int x = 0; x < size; ++x) {
 			//find the closest point to (x, y)
 			float minDistanceSqr = INFINITY;
@@ -195,7 +190,7 @@ void Heightmap::voronoiFaulting(int numPoints, float heightRange) {
 				}
 			}
 			//fault using closest point
-			heightmap[y][x] += points[closestPoint].z;
+			row[x] += points[closestPoint].z;
 
 			//find the second closest point
 			minDistanceSqr = INFINITY;
@@ -213,28 +208,26 @@ void Heightmap::voronoiFaulting(int numPoints, float heightRange) {
 				}
 			}
 			//fault using closest point
-			heightmap[y][x] += points[closestPoint].z;
+			row[x] += points[closestPoint].z;
 		}
+		GENERATION_CHECKPOINT(token)
 	}
+	co_await GenerationTask::resumeOnMainThread();
 
-	delete[] points;
+	swapInRows(rows);
 }
 
-void Heightmap::smoothe(float amount) {
-
-	//the original values will be stored in the copy of the heightmap
-	float** heightmapCopy = new float*[size];
-	for (int y = 0; y < size; ++y) {
-		heightmapCopy[y] = new float[size];
-		for (int x = 0; x < size; ++x) {
-			heightmapCopy[y][x] = heightmap[y][x];
-		}
-	}
+GenerationTask Heightmap::asyncSmoothe(float amount, CancellationToken token) {
 
-	int neighbours = (int)(3 * amount) + 1;//can easily prove that at a distance > 3*standardDeviation, gaussian function (a=1,b=0) evaluates to less than exp(-4.5) (=0.01111)
+	int neighbours = (int)(3 * amount);//can easily prove that at a distance > 3*standardDeviation, gaussian function (a=1,b=0) evaluates to less than exp(-4.5) (=0.01111)
 
-	//read the values from heightmapCopy and use them to smoothe out heightmap
+	//average out a copy of the heights into new rows on a worker
+	Rows source = copyRows();
+	Rows rows = allocateRows();
+	const int size = this->size;//(see Rows)
+	co_await GenerationTask::resumeOnWorker();
 	for (int y = 0; y < size; ++y) {
+		float* row = rows[y].get();
 		for (int x = 0; x < size; ++x) {
 
 			float sum = 0;
@@ -246,191 +239,135 @@ void Heightmap::smoothe(float amount) {
 					if (ny >= 0 && ny < size && nx >= 0 && nx < size) {
 						float distSqr = (nx - x)*(nx - x) + (ny - y)*(ny - y);
 						float weight = gauss(distSqr, amount);
-						sum += heightmapCopy[ny][nx] * weight;
+						sum += source[ny][nx] * weight;
 						totalWeight += weight;
 					}
 				}
 			}
 
 			//use the averaged value as the new height
-			if (totalWeight != 0) {
-				heightmap[y][x] = sum / totalWeight;
-			}
-			else heightmap[y][x] = 0;
+			row[x] = totalWeight != 0 ? sum / totalWeight : 0;
 
 		}
+		GENERATION_CHECKPOINT(token)
 	}
+	co_await GenerationTask::resumeOnMainThread();
 
-	//free memory
-	for (int y = 0; y < size; ++y)
-		delete[] heightmapCopy[y];
-	delete[] heightmapCopy;
-}
+	swapInRows(rows);
 
-void Heightmap::perlinNoise(float scale, float heightRange) {
-	PerlinNoise noise(randomEngine());
-	for (int y = 0; y < size; ++y) {
-		for (int x = 0; x < size; ++x) {
-			heightmap[y][x] += noise.noise(scale*x, scale*y, 0) * heightRange - heightRange / 2;
-		}
-	}
 }
 
+GenerationTask Heightmap::asyncPointwise(size_t first, size_t last, CancellationToken token) {
 
-
-
-//some coroutine utility macros
-#define MAX_TIME_IN_COROUTINE 4
-#define INITIAL_CHECKPOINT std::chrono::high_resolution_clock clock; auto time = clock.now();
-#define CHECKPOINT {auto now = clock.now(); int millis = std::chrono::duration_cast<std::chrono::milliseconds>(now - time).count(); if(millis >= MAX_TIME_IN_COROUTINE){ co_yield NULL; time = clock.now(); }}
-
-Heightmap::HeightEnumerator Heightmap::asyncVoronoiFaulting(int numPoints, float heightRange){
-	
-	INITIAL_CHECKPOINT
-
-	std::vector<XMFLOAT3> points;//z coord will be the amount we fault - cant use an array anymore, cos a vector will automatically release its data even if the coroutine never ends
-	for (int i = 0; i < numPoints; ++i) {
-		points.push_back(XMFLOAT3(
-			randomFloat(size),
-			randomFloat(size),
-			randomFloat(-heightRange / 2, heightRange / 2)
-		));
+	//each noise pass gets its own stream, in the order they come in
+	std::vector<GenerationNode> nodes(graph.getNodes().begin() + first, graph.getNodes().begin() + last);
+	std::vector<PerlinNoise> noises;
+	for (const GenerationNode& node : nodes) {
+		if (node.type == GenerationNode::NOISE) {
+			random.beginStream(++pass);
+			noises.push_back(PerlinNoise(random));
+		}
 	}
 
+	//go through all the passes a row at a time, on a worker; each row of the map only gets read once and written once, however many passes there are
+	Rows rows = copyRows();
+	const int size = this->size;//(see Rows)
+	co_await GenerationTask::resumeOnWorker();
 	for (int y = 0; y < size; ++y) {
-		for (int x = 0; x < size; ++x) {
-			//find the closest point to (x, y)
-			float minDistanceSqr = INFINITY;
-			int closestPoint = 0;
-			for (int i = 0; i < numPoints; ++i) {
-				float vectX = float(x) - points[i].x;
-				float vectY = float(y) - points[i].y;
-				float distSqr = vectX*vectX + vectY*vectY;
-				if (distSqr < minDistanceSqr) {//this point is closer than the last one
-					minDistanceSqr = distSqr;
-					closestPoint = i;
-				}
+		float* row = rows[y].get();
+		int noise = 0;
+		for (const GenerationNode& node : nodes) {
+			if (node.type == GenerationNode::NOISE) {
+				noises[noise++].addRow(row, size, node.scale, node.scale*y, node.range);
 			}
-			//fault using closest point
-			heightmap[y][x] += points[closestPoint].z;
-
-			//find the second closest point
-			minDistanceSqr = INFINITY;
-			int previousClosest = closestPoint;
-			closestPoint = 0;
-			for (int i = 0; i < numPoints; ++i) {
-				if (i != previousClosest) {
-					float vectX = float(x) - points[i].x;
-					float vectY = float(y) - points[i].y;
-					float distSqr = vectX*vectX + vectY*vectY;
-					if (distSqr < minDistanceSqr) {//this point is closer than the last one
-						minDistanceSqr = distSqr;
-						closestPoint = i;
-					}
+			else if (node.type == GenerationNode::TERRACES) {
+				for (int x = 0; x < size; ++x) {
+					float level = floor(row[x] / node.step);
+					float fraction = row[x] / node.step - level;
+					float stepped = (level + fraction * fraction * fraction) * node.step;//flat at the bottom of each step, steep towards the top
+					row[x] += (stepped - row[x]) * node.amount;
 				}
 			}
-			//fault using closest point
-			heightmap[y][x] += points[closestPoint].z;
 		}
-		//if(y%6 == 0) co_yield NULL;
-		CHECKPOINT
+		GENERATION_CHECKPOINT(token)
 	}
+	co_await GenerationTask::resumeOnMainThread();
 
-#ifdef QUICKGEN //in quickgen mode, only the very first step counts.
-	co_return NULL;
-#else
-	//prepare the next step voronoi faulting if needed
-	if (heightRange > 5) {
-		heightRange *= 0.3f;
-		co_return new HeightEnumerator(asyncVoronoiFaulting(100.f / heightRange, heightRange));
-	}
-	else {
-		co_return new HeightEnumerator(asyncSmoothe(1.5f));//move on to next step - smoothe out the resulting heights
-	}
-#endif
+	swapInRows(rows);
 }
 
-Heightmap::HeightEnumerator Heightmap::asyncSmoothe(float amount) {
+GenerationTask Heightmap::asyncErosion(int iterations, float talus, float amount, CancellationToken token) {
 
-	INITIAL_CHECKPOINT
-
-	//the original values will be stored in the copy of the heightmap
-	std::vector<std::vector<float>> heightmapCopy;
+	std::vector<float> current(size * size), next(size * size);
 	for (int y = 0; y < size; ++y) {
-		heightmapCopy.push_back(std::vector<float>());
 		for (int x = 0; x < size; ++x) {
-			heightmapCopy[y].push_back(heightmap[y][x]);
+			current[y * size + x] = heightmap[y][x];
 		}
 	}
+	Rows rows = allocateRows();
+	const int size = this->size;//(see Rows)
 
-	int neighbours = (int)(3 * amount);//can easily prove that at a distance > 3*standardDeviation, gaussian function (a=1,b=0) evaluates to less than exp(-4.5) (=0.01111)
-
-	//read the values from heightmapCopy and use them to smoothe out heightmap
-	for (int y = 0; y < size; ++y) {
-		for (int x = 0; x < size; ++x) {
-
-			float sum = 0;
-			float totalWeight = 0;
-
-			//sample neighbouring cells
-			for (int ny = y - neighbours / 2; ny <= y + neighbours / 2; ++ny) {
-				for (int nx = x - neighbours / 2; nx <= x + neighbours / 2; ++nx) {
-					if (ny >= 0 && ny < size && nx >= 0 && nx < size) {
-						float distSqr = (nx - x)*(nx - x) + (ny - y)*(ny - y);
-						float weight = gauss(distSqr, amount);
-						sum += heightmapCopy[ny][nx] * weight;
-						totalWeight += weight;
-					}
+	//each cell gives to its lower neighbours and takes from its higher ones, so whatever leaves a cell ends up in its neighbour
+	co_await GenerationTask::resumeOnWorker();
+	const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	for (int iteration = 0; iteration < iterations; ++iteration) {
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				float height = current[y * size + x];
+				float delta = 0;
+				for (const int* offset : offsets) {
+					int nx = x + offset[0], ny = y + offset[1];
+					if (nx < 0 || nx >= size || ny < 0 || ny >= size) continue;
+					float difference = height - current[ny * size + nx];
+					if (difference > talus) delta -= (difference - talus) * amount * 0.25f;
+					else if (-difference > talus) delta += (-difference - talus) * amount * 0.25f;
 				}
+				next[y * size + x] = height + delta;
 			}
-
-			//use the averaged value as the new height
-			if (totalWeight != 0) {
-				heightmap[y][x] = sum / totalWeight;
-			}
-			else heightmap[y][x] = 0;
-
+			GENERATION_CHECKPOINT(token)
 		}
-		//if(y % 10 == 0) co_yield NULL;
-		CHECKPOINT
+		std::swap(current, next);
 	}
+	for (int y = 0; y < size; ++y) {
+		std::copy(current.begin() + y * size, current.begin() + (y + 1) * size, rows[y].get());
+	}
+	co_await GenerationTask::resumeOnMainThread();
 
-	co_return new HeightEnumerator(asyncPerlinNoise(0.25f/1.25f, 0.7f));//next step - a few passes of fractal perlin noise
-
+	swapInRows(rows);
 }
 
-Heightmap::HeightEnumerator Heightmap::asyncPerlinNoise(float scale, float heightRange) {
-
-	INITIAL_CHECKPOINT
-
-		PerlinNoise noise(randomEngine());
+Heightmap::Rows Heightmap::allocateRows() const {
+	Rows rows(size);
 	for (int y = 0; y < size; ++y) {
-		for (int x = 0; x < size; ++x) {
-			heightmap[y][x] += noise.noise(scale*x, scale*y, 0) * heightRange - heightRange / 2;
-		}
-		//if (y % 20 == 0) co_yield NULL;
-		CHECKPOINT
+		rows[y].reset(new float[size]);
 	}
+	return rows;
+}
 
-	if (heightRange > 0.3f) {//keep going in fractal pattern
-		heightRange *= 0.5f;
-		co_return new HeightEnumerator(asyncPerlinNoise(0.25f / heightRange, heightRange));
+Heightmap::Rows Heightmap::copyRows() const {
+	Rows rows = allocateRows();
+	for (int y = 0; y < size; ++y) {
+		std::copy(heightmap[y], heightmap[y] + size, rows[y].get());
 	}
-	else {
-		//done! save it for later.
-		write();
-		co_return NULL;
+	return rows;
+}
+
+void Heightmap::swapInRows(Rows& rows) {
+	for (int y = 0; y < size; ++y) {
+		float* row = heightmap[y];
+		heightmap[y] = rows[y].release();
+		rows[y].reset(row);//the old row gets freed along with rows
 	}
 }
 
-#undef MAX_TIME_IN_COUROUTINE
-#undef INITIAL_CHECKPOINT
-#undef CHECKPOINT
+std::string Heightmap::saveName() const {
+	return "saved/heightmap-" + random.tag() + graph.hashTag() + "-" + std::to_string(seed);
+}
 
 void Heightmap::write() {
-	if (!FileSystem::fileExists("saved/heightmap-" + std::to_string(seed))) {
+	if (!FileSystem::fileExists(saveName())) {
 
-		FileWriter w("saved/heightmap-" + std::to_string(seed));
+		FileWriter w(saveName());
 		for (int y = 0; y < size; ++y) {
 			for (int x = 0; x < size; ++x) {
 				FileSystem::w_float(w(), heightmap[y][x]);
@@ -441,9 +378,9 @@ void Heightmap::write() {
 }
 
 bool Heightmap::read() {
-	if (FileSystem::fileExists("saved/heightmap-" + std::to_string(seed))) {
+	if (FileSystem::fileExists(saveName())) {
 
-		FileReader r("saved/heightmap-" + std::to_string(seed));
+		FileReader r(saveName());
 		for (int y = 0; y < size; ++y) {
 			for (int x = 0; x < size; ++x) {
 				heightmap[y][x] = FileSystem::r_float(r());
@@ -7,18 +7,15 @@
 #include "DXF.h"
 #include <random>
 #include "PerlinNoise.h"
-#include <experimental/coroutine>
+#include "Random.h"
+#include "GenerationTask.h"
+#include "GenerationGraph.h"
 #include "FileSystem.h"
 #include "FileReader.h"
 #include "FileWriter.h"
 
-//#define TIME_HEIGHTMAP_GENERATION // if defined, will time how long it takes to generate the heightmap and write it to a csv file
-
-#ifdef TIME_HEIGHTMAP_GENERATION
-#include <chrono>
-#endif
-
 class Heightmap {
+	friend class GenerationBenchmark;
 
 public:
 	Heightmap(int seed, int size);
@@ -26,87 +23,54 @@ public:
 
 	float getHeight(int x, int y) const;
 	float getSize() const;
+	inline const float* getRow(int y) const { return heightmap[y]; }//unchecked direct access to a whole row of heights
 
 	void generate();
-	void update();
+	void update(bool carryOn = true);//carryOn = false holds off generating for now
 	inline bool hasChanged() const { return changed; }
+	inline bool isGenerating() const { return currentOperation != nullptr || suspended; }//a suspended heightmap still counts, it isn't done
+	void cancel();//stops generating, freeing whatever the current operation was holding onto (the heightmap stays as it is)
+	void suspend();//cancels any generation in progress, to be started over by resume()
+	void resume();
 
 protected:
 	int seed;
 	int size;
 	bool changed = true;//whether the heightmap was changed over the last call to update()
+	bool suspended = false;//see suspend()
 
 	float** heightmap = nullptr;
 
-	std::default_random_engine randomEngine;
+	Random random;
+	uint32_t pass = 0;//how many random passes have been started, to give each one its own stream
 
 	float randomFloat(float max = 1, float min = 0);
 	int randomInt(int max, int min = 0);
-	float gauss(float distFromCenter, float standardDeviation);
-	void voronoiFaulting(int numPoints, float heightRange);
-	void perlinNoise(float scale, float heightRange);
-	void smoothe(float amount);
-
-	//async generation using coroutines
-	struct HeightEnumerator {
-		struct promise_type {
-			HeightEnumerator* next = NULL;
-			inline promise_type(){}
-			inline ~promise_type(){}
-			inline auto initial_suspend(){ return std::experimental::suspend_always{}; }//suspend initially
-			inline auto final_suspend() { return std::experimental::suspend_always{}; }//suspend once done to be able to use Continue()
-			//inline auto return_void() { return std::experimental::suspend_never{}; }//never suspend on return (will suspend after)
-			inline auto return_value(HeightEnumerator* val) { next = val; return std::experimental::suspend_never{}; }//record the next operation (can be NULL, in which case we're done)
-			inline auto yield_value(int v) { return std::experimental::suspend_always{}; }//always suspend on yield (otherwise whats the point of yielding)
-			inline auto get_return_object() { return HeightEnumerator{ handle::from_promise(*this) }; }
-			inline void unhandled_exception() { printf("An exception occured...\n"); std::exit(100); }
-		};
-		using handle = std::experimental::coroutine_handle<promise_type>;
-
-		/// Continues execution of the current coroutine
-		inline bool Continue() {
-			coroutineHandle.resume();
-			finished = coroutineHandle.done();
-			return finished;
-		}
-
-		/// Returns whether the current coroutine is finished or not
-		inline bool IsFinished() { return finished; }
-
-		/// Returns the next operation that should be executed after this coroutine is over
-		inline HeightEnumerator* NextOperation() { return coroutineHandle.promise().next; }
-
-		inline ~HeightEnumerator() { if (coroutineHandle) coroutineHandle.destroy(); }
-
-		//make enumerator movable but not copyable
-		inline HeightEnumerator(const HeightEnumerator &) = delete;
-		inline HeightEnumerator(HeightEnumerator &&g) : coroutineHandle(g.coroutineHandle) { g.coroutineHandle = nullptr; }
-		inline HeightEnumerator &operator = (const HeightEnumerator &) = delete;
-		inline HeightEnumerator &operator = (HeightEnumerator &&h) {
-			coroutineHandle = h.coroutineHandle;
-			h.coroutineHandle = nullptr;
-			return *this;
-		}
-	private:
-		inline HeightEnumerator(handle h) : coroutineHandle(h) {}
-		handle coroutineHandle = nullptr;
-		bool finished = false;
-	};
-
-	HeightEnumerator asyncVoronoiFaulting(int numPoints, float heightRange);
-	HeightEnumerator asyncSmoothe(float amount);
-	HeightEnumerator asyncPerlinNoise(float scale, float heightRange);
+	static float gauss(float distFromCenter, float standardDeviation);
+
+	GenerationGraph graph;//the passes to generate the heightmap with
+
+	//the async passes write their results into new rows on a worker, which then get swapped into the heightmap on the main thread in one go
+	//the worker only goes by what the pass copied into its frame (rows, size...) as a dropped pass carries on until its next checkpoint, by which time the heightmap may be gone
+	typedef std::vector<std::unique_ptr<float[]>> Rows;
+	Rows allocateRows() const;
+	Rows copyRows() const;//the current heights
+	void swapInRows(Rows& rows);//rows ends up with the old rows, freed along with it
+
+	//async generation using coroutines; asyncGenerate() goes through the graph and awaits each of the passes in turn, which do the heavy lifting on the worker threads
+	GenerationTask asyncGenerate(CancellationToken token);
+	GenerationTask asyncVoronoiFaulting(int numPoints, float heightRange, CancellationToken token);
+	GenerationTask asyncSmoothe(float amount, CancellationToken token);
+	GenerationTask asyncPointwise(size_t first, size_t last, CancellationToken token);//graph nodes first..last-1, all pointwise (noise, terraces)
+	GenerationTask asyncErosion(int iterations, float talus, float amount, CancellationToken token);
 
 	//the operation we're currently applying to generate the heightmap, or nullptr if we're done
-	HeightEnumerator* currentOperation;
+	std::unique_ptr<GenerationTask> currentOperation;
+	CancellationToken cancellation;//handed to the operations above
 
 	//i/o operations
+	std::string saveName() const;//keyed by the graph's hash as well as the seed
 	bool read();
 	void write();
 
-#ifdef TIME_HEIGHTMAP_GENERATION
-	std::chrono::high_resolution_clock timingClock;
-	std::deque<float> times;//the times it takes, one for each frame
-#endif
-
 };
\ No newline at end of file
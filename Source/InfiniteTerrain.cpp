@@ -1,10 +1,21 @@
 #include "InfiniteTerrain.h"
+#include <algorithm>
 #include "LitShader.h"
 #include "AppGlobals.h"
 #include "PPTextureShader.h"
 #include "Utils.h"
+#include "Profiler.h"
+#include "GpuTimer.h"
+#include "GenerationScheduler.h"
+#include "RenderBackend.h"
 
 #define MAXIMUM_CHUNKS_AT_ONCE 20 //beyond this limit, some chunks will be unloaded from RAM
+#define HEIGHTMAP_BUDGET_SHARE 0.75f //share of the frame's generation budget that goes to the heightmaps, the rest being kept for rebuilding buffers and generating ruins
+#define VIEW_CONE_COS 0.5f //chunks whose centre is within this cone (cosine of the half-angle) around where the camera's looking are generated first
+#define OUT_OF_VIEW_PENALTY 3.f //how much further away chunks outside the view cone are treated as being
+#define CANCEL_MARGIN 1 //how many chunks past the edge of the range a chunk has to be before its generation work gets cancelled, so walking back and forth over the edge doesn't keep throwing it away
+#define OUT_OF_RANGE_PRIORITY 1000000.f //added to the priority of chunks just out of range (within CANCEL_MARGIN), so they only get whatever budget the chunks in range leave over
+#define RUIN_BLOCK_LIBRARY_SIZE 25 //how many different ruin block variants to generate (only the ones missing from the cache get generated)
 //#define SMALL_AMOUNT_OF_CHUNKS //define this to only see a small amount of chunks at a time, rather than the full set
 //#define NO_INFINITY //when defined, only one chunk is produced instead of an infinite amount :)
 //#define CHECK_BLOCKS //when defined, also renders the block library underneath the terrain
@@ -16,6 +27,16 @@ InfiniteTerrain::InfiniteTerrain(TextureManager* textureMgr, int seed, int chunk
 	blockShader = new LitShader;
 	blockShader->SETUP_SHADER_TANGENT(default_vs, ruinblock_fs);
 
+	//each chunk is lit by its single directional light, so those draws get variants with the light loop and type checks compiled out
+	shader->SETUP_PERMUTATION(terrain_fs_1dir, 1, DIRECTIONAL_LIGHT, false, false);
+	shader->SETUP_PERMUTATION(terrain_fs_1dir_normals, 1, DIRECTIONAL_LIGHT, false, true);
+	shader->SETUP_PERMUTATION(terrain_fs_1dir_shadows, 1, DIRECTIONAL_LIGHT, true, false);
+	shader->SETUP_PERMUTATION(terrain_fs_1dir_shadows_normals, 1, DIRECTIONAL_LIGHT, true, true);
+	blockShader->SETUP_PERMUTATION(ruinblock_fs_1dir, 1, DIRECTIONAL_LIGHT, false, false);
+	blockShader->SETUP_PERMUTATION(ruinblock_fs_1dir_normals, 1, DIRECTIONAL_LIGHT, false, true);
+	blockShader->SETUP_PERMUTATION(ruinblock_fs_1dir_shadows, 1, DIRECTIONAL_LIGHT, true, false);
+	blockShader->SETUP_PERMUTATION(ruinblock_fs_1dir_shadows_normals, 1, DIRECTIONAL_LIGHT, true, true);
+
 	//load textures
 	causticsTex = textureMgr->getTexture("caustics");
 	rockTex = textureMgr->getTexture("rock");
@@ -32,7 +53,7 @@ InfiniteTerrain::InfiniteTerrain(TextureManager* textureMgr, int seed, int chunk
 	//material->emissive = XMFLOAT3(0.1f, 0.3f, 0.3f);
 
 	//initialize a bunch of pre-generated blocks
-	ruinBlockLibrary = new RuinBlockLibrary(25, seed);
+	ruinBlockLibrary = new RuinBlockLibrary(RUIN_BLOCK_LIBRARY_SIZE, seed);
 
 #ifdef NO_INFINITY
 	chunks.push_back(new TerrainMesh(seed, 0*chunkSize, 0*chunkSize, chunkSize + 1, ruinBlockLibrary));
@@ -52,27 +73,39 @@ InfiniteTerrain::~InfiniteTerrain(){
 	delete material;
 }
 
-void InfiniteTerrain::update(XMFLOAT3 cameraPosition, ID3D11Device* device, ID3D11DeviceContext* deviceContext, float dt){
-#ifndef NO_INFINITY
+///Where the chunk stands in the generation queue: its distance to the camera, pushed back if it's outside of the view
+float InfiniteTerrain::generationPriority(const TerrainMesh* chunk, XMFLOAT3 cameraPosition, XMFLOAT3 cameraForward) const {
+	float dx = chunk->getBaseCoords().x - cameraPosition.x;
+	float dz = chunk->getBaseCoords().y - cameraPosition.z;
+	float distance = sqrt(dx*dx + dz*dz);
+	if (distance < chunkSize) return distance;//close enough that it's always in view one way or another
+
+	float forwardLength = sqrt(cameraForward.x*cameraForward.x + cameraForward.z*cameraForward.z);
+	if (forwardLength <= 0) return distance;//looking straight up or down
+	float cosine = (dx * cameraForward.x + dz * cameraForward.z) / (distance * forwardLength);
+	return cosine >= VIEW_CONE_COS ? distance : distance * OUT_OF_VIEW_PENALTY;
+}
 
-	//at all times, make sure we have all chunks adjacent to cameraPosition
-	std::vector<XMINT2> requiredChunks;
+void InfiniteTerrain::update(XMFLOAT3 cameraPosition, XMFLOAT3 cameraForward, ID3D11Device* device, ID3D11DeviceContext* deviceContext, float dt){
+
+	//the chunks adjacent to cameraPosition: the four closest (the camera being in between their own centers) + their neighbours (if SMALL_AMOUNT_OF_CHUNKS is undefined)
 	int X = floor((float)cameraPosition.x / chunkSize);
 	int Z = floor((float)cameraPosition.z / chunkSize);
-	//the four closest (the camera being in between their own centers) + their neighbours (if SMALL_AMOUNT_OF_CHUNKS is undefined)
-
-#ifdef SMALL_AMOUNT_OF_CHUNKS
-	requiredChunks.push_back(XMINT2(X, Z));
-	requiredChunks.push_back(XMINT2(X+1, Z));
-	requiredChunks.push_back(XMINT2(X+1, Z+1));
-	requiredChunks.push_back(XMINT2(X, Z+1));
-#else //the following will only be displayed if SMALL_AMOUNT_OF_CHUNKS is undefined, otherwise we only keep the closest 4 chunks.
-	for (int xx = -1; xx <= 2; ++xx) {
-		for (int yy = -1; yy <= 2; ++yy) {
+#ifdef SMALL_AMOUNT_OF_CHUNKS //only the closest 4 chunks
+	const int rangeMin = 0, rangeMax = 1;
+#else
+	const int rangeMin = -1, rangeMax = 2;
+#endif
+
+#ifndef NO_INFINITY
+
+	//at all times, make sure we have all of those
+	std::vector<XMINT2> requiredChunks;
+	for (int xx = rangeMin; xx <= rangeMax; ++xx) {
+		for (int yy = rangeMin; yy <= rangeMax; ++yy) {
 			requiredChunks.push_back(XMINT2(X + xx, Z + yy));
 		}
 	}
-#endif
 
 	//delete any chunks we dont need
 	for (auto it = chunks.begin(); it != chunks.end();) {
@@ -108,8 +141,37 @@ void InfiniteTerrain::update(XMFLOAT3 cameraPosition, ID3D11Device* device, ID3D
 	}
 #endif
 
+	//order the chunks for generation: closest and in view first. Chunks just out of range carry on after all the others, and only those further out than CANCEL_MARGIN (but still loaded) cancel their work, starting it over once they're back
+	generationQueue.clear();
+	for (TerrainMesh* terrain : chunks) {
+		float priority = generationPriority(terrain, cameraPosition, cameraForward);
+#ifdef NO_INFINITY
+		terrain->setInRange(true);
+#else
+		int chunkX = terrain->getBaseCoords().x / chunkSize;
+		int chunkZ = terrain->getBaseCoords().y / chunkSize;
+		if (!(chunkX >= X + rangeMin && chunkX <= X + rangeMax && chunkZ >= Z + rangeMin && chunkZ <= Z + rangeMax)) {
+			priority += OUT_OF_RANGE_PRIORITY;
+		}
+		terrain->setInRange(chunkX >= X + rangeMin - CANCEL_MARGIN && chunkX <= X + rangeMax + CANCEL_MARGIN && chunkZ >= Z + rangeMin - CANCEL_MARGIN && chunkZ <= Z + rangeMax + CANCEL_MARGIN);
+#endif
+		generationQueue.push_back(std::make_pair(priority, terrain));
+	}
+	std::sort(generationQueue.begin(), generationQueue.end(), [](const std::pair<float, TerrainMesh*>& a, const std::pair<float, TerrainMesh*>& b) { return a.first < b.first; });
+
+	//all the generation work below shares the one frame budget, each chunk using up as much of it as it needs in turn
+	GenerationScheduler& scheduler = GenerationScheduler::Instance();
+	scheduler.beginFrame(GLOBALS.GenerationBudget);
+
+	//carry on generating the heightmaps
+	scheduler.beginPhase(HEIGHTMAP_BUDGET_SHARE);
+	for (auto& queued : generationQueue) {
+		queued.second->updateHeightmap();
+	}
+
 	//update the terrains we currently have loaded in
 	for (TerrainMesh* terrain : chunks) {
+		PROFILE_SCOPE("Chunk update");
 		const TerrainMesh* leftNeighbour = nullptr;
 		const TerrainMesh* belowNeighbour = nullptr;
 		const TerrainMesh* diagonalNeighbour = nullptr;
@@ -136,32 +198,47 @@ void InfiniteTerrain::update(XMFLOAT3 cameraPosition, ID3D11Device* device, ID3D
 		terrain->updateTerrain(leftNeighbour, belowNeighbour, diagonalNeighbour, topNeighbour, rightNeighbour, device, deviceContext, dt);
 	}
 	//go through those terrains we have again to check whether any of them need to reinit their buffers now
-	for (TerrainMesh* terrain : chunks) {
-		terrain->reinitBuffers(device, dt);
+	scheduler.beginPhase(1);
+	for (auto& queued : generationQueue) {
+		PROFILE_SCOPE("Chunk buffers");
+		queued.second->reinitBuffers(device, dt);
 	}
+	scheduler.endFrame();
 
 }
 
 void InfiniteTerrain::render(bool lighting, bool shadowing, D3D* renderer, XMMATRIX& worldMatrix, XMMATRIX& viewMatrix, XMMATRIX& projectionMatrix, XMFLOAT3 cameraPosition){
-	for (TerrainMesh* chunk : chunks) {
-		//render the terrain mesh
-		chunk->sendData(renderer->getDeviceContext());
-		shader->setShaderParameters(renderer->getDeviceContext(), worldMatrix, viewMatrix, projectionMatrix, cameraPosition);
-		ExtendedLight* lights = chunk->getLight();
-		ID3D11ShaderResourceView** shadowmaps = new ID3D11ShaderResourceView*[1]{ chunk->getShadowmap() };
-		shader->setLightParameters(renderer->getDeviceContext(), cameraPosition, lighting? &lights : NULL, lighting && shadowing ? shadowmaps : NULL, lighting && shadowing, lighting?1:0/*only one light*/);
-		delete[] shadowmaps;
+	GLOBALS.RenderBackend->invalidateState();//render targets may have changed since the last pass
+
+	//all the terrain meshes first, then all the ruins, so each shader and its textures only get bound once
+	{
+		GPU_SCOPE("Terrain");
 		shader->setMaterialParameters(renderer->getDeviceContext(), sandTex, sandNormalsTex, NULL, material);
-		shader->setTexture(chunk->getRuinMapView(renderer->getDevice(), renderer->getDeviceContext()), 16, renderer->getDeviceContext());
 		shader->setTexture(causticsTex, 13, renderer->getDeviceContext());
 		shader->setTexture(rockTex, 14, renderer->getDeviceContext());
 		shader->setTexture(rockNormalsTex, 15, renderer->getDeviceContext());
-		shader->render(renderer->getDeviceContext(), chunk->getIndexCount());
+		shader->setShaderParameters(renderer->getDeviceContext(), worldMatrix, viewMatrix, projectionMatrix, cameraPosition);
+		for (TerrainMesh* chunk : chunks) {
+			chunk->sendData(renderer->getDeviceContext());
+			ExtendedLight* lights = chunk->getLight();
+			ID3D11ShaderResourceView* shadowmap = chunk->getShadowmap();
+			shader->setLightParameters(renderer->getDeviceContext(), cameraPosition, lighting? &lights : NULL, lighting && shadowing ? &shadowmap : NULL, lighting && shadowing, lighting?1:0/*only one light*/, chunk->getLightBuffers());
+			shader->setTexture(chunk->getRuinMapView(renderer->getDevice(), renderer->getDeviceContext()), 16, renderer->getDeviceContext());
+			GLOBALS.RenderBackend->drawIndexed(shader, chunk->getIndexCount());
+		}
+	}
 
-		//render the ruins as well once they're generated
-		if (chunk->getRuins()) {
-			blockShader->setMaterialParameters(renderer->getDeviceContext(), ruinsTex, ruinsNormalsTex, NULL, material);
-			chunk->getRuins()->renderRuins(blockShader, material, renderer, XMMatrixTranslation(chunk->getBaseCoords().x - chunkSize / 2 + 0.5f, 0, chunk->getBaseCoords().y - chunkSize / 2 + 0.5f) * worldMatrix, viewMatrix, projectionMatrix, cameraPosition);
+	//render the ruins as well once they're generated
+	{
+		GPU_SCOPE("Ruins");
+		blockShader->setMaterialParameters(renderer->getDeviceContext(), ruinsTex, ruinsNormalsTex, NULL, material);
+		for (TerrainMesh* chunk : chunks) {
+			if (chunk->getRuins()) {
+				ExtendedLight* lights = chunk->getLight();
+				ID3D11ShaderResourceView* shadowmap = chunk->getShadowmap();
+				blockShader->setLightParameters(renderer->getDeviceContext(), cameraPosition, lighting ? &lights : NULL, lighting && shadowing ? &shadowmap : NULL, lighting && shadowing, lighting ? 1 : 0/*only one light*/, chunk->getLightBuffers());
+				chunk->getRuins()->renderRuins(blockShader, material, renderer, XMMatrixTranslation(chunk->getBaseCoords().x - chunkSize / 2 + 0.5f, 0, chunk->getBaseCoords().y - chunkSize / 2 + 0.5f) * worldMatrix, viewMatrix, projectionMatrix, cameraPosition);
+			}
 		}
 	}
 
@@ -172,19 +249,20 @@ void InfiniteTerrain::render(bool lighting, bool shadowing, D3D* renderer, XMMAT
 		mesh->sendData(renderer->getDeviceContext());
 		blockShader->setShaderParameters(renderer->getDeviceContext(), XMMatrixTranslation(i * 2, 20, 0) * worldMatrix, viewMatrix, projectionMatrix, cameraPosition);
 		blockShader->setMaterialParameters(renderer->getDeviceContext(), ruinsTex, ruinsNormalsTex, NULL, material);
-		blockShader->render(renderer->getDeviceContext(), mesh->getIndexCount());
+		GLOBALS.RenderBackend->drawIndexed(blockShader, mesh->getIndexCount());
 	}
 #endif
 }
 
 void InfiniteTerrain::depthPass(LitShader* depthShader, D3D* renderer, XMMATRIX& worldMatrix, XMMATRIX& viewMatrix, XMMATRIX& projectionMatrix, XMFLOAT3 cameraPosition, const TerrainMesh* specificChunk) {
 	if (depthShader) {
+		GLOBALS.RenderBackend->invalidateState();//render targets may have changed since the last pass
 
 		//a macro cos i dont want to create a real function or to copy paste code :P
 #define DEPTHPASS(chunk) {chunk->sendData(renderer->getDeviceContext());\
 							depthShader->setShaderParameters(renderer->getDeviceContext(), worldMatrix, viewMatrix, projectionMatrix, cameraPosition);\
 							depthShader->setLightParameters(renderer->getDeviceContext(), cameraPosition, NULL, NULL, false, 0);\
-							depthShader->render(renderer->getDeviceContext(), chunk->getIndexCount());\
+							GLOBALS.RenderBackend->drawIndexed(depthShader, chunk->getIndexCount());\
 							\
 							if (chunk->getRuins())\
 								chunk->getRuins()->renderRuins(depthShader, material, renderer, XMMatrixTranslation(chunk->getBaseCoords().x - chunkSize / 2 + 0.5f, 0, chunk->getBaseCoords().y - chunkSize / 2 + 0.5f) * worldMatrix, viewMatrix, projectionMatrix, cameraPosition);}
@@ -204,7 +282,7 @@ void InfiniteTerrain::shadowmappingPass(LitShader* depthShader, D3D* renderer, X
 		if (chunk->hasMeshChanged()) {//no need to recapture shadowmap when the mesh has stayed the exact same
 			ExtendedLight* light = chunk->getLight();
 			if (light->StartRecordingShadowmap()) {
-
+				GPU_SCOPE("Chunk shadow map");
 				XMMATRIX lightViewMatrix = light->getView();
 				XMMATRIX lightProjectionMatrix = light->getProjection();
 
@@ -4,11 +4,13 @@
 #include "DefaultShader.h"
 
 class InfiniteTerrain{
+	friend class SubmissionCheck;
+
 public:
 	InfiniteTerrain(TextureManager* textureMgr, int seed, int chunkSize = 100);
 	~InfiniteTerrain();
 
-	void update(XMFLOAT3 cameraPosition, ID3D11Device* device, ID3D11DeviceContext* deviceContext, float dt);
+	void update(XMFLOAT3 cameraPosition, XMFLOAT3 cameraForward, ID3D11Device* device, ID3D11DeviceContext* deviceContext, float dt);
 	void render(bool lighting, bool shadowing, D3D* renderer, XMMATRIX& worldMatrix, XMMATRIX& viewMatrix, XMMATRIX& projectionMatrix, XMFLOAT3 cameraPosition);
 	void depthPass(LitShader* depthShader, D3D* renderer, XMMATRIX& worldMatrix, XMMATRIX& viewMatrix, XMMATRIX& projectionMatrix, XMFLOAT3 cameraPosition, const TerrainMesh* specificChunk = NULL);
 	void shadowmappingPass(LitShader* depthShader, D3D* renderer, XMMATRIX& worldMatrix);
@@ -26,6 +28,9 @@ protected:
 	int chunkSize;
 
 	std::vector<TerrainMesh*> chunks;
+	std::vector<std::pair<float, TerrainMesh*>> generationQueue;//chunks in the order they get to use the generation budget, rebuilt each frame (lower goes first)
+
+	float generationPriority(const TerrainMesh* chunk, XMFLOAT3 cameraPosition, XMFLOAT3 cameraForward) const;
 
 	LitShader* shader;//for the terrain meshes
 	LitShader* blockShader;//for the ruins
@@ -1,35 +1,49 @@
 #include "LitShader.h"
 
 #include "AppGlobals.h"
+#include "RenderBackend.h"
+
+LitShader::LightBuffers::LightBuffers(ID3D11Device* device) : light(device, sizeof(LightBufferType)), shadowmapMatrices(device, sizeof(ShadowmapMatrixBufferType)) {
+}
 
 LitShader::LitShader() {
 }
 
 LitShader::~LitShader(){
-	cameraBuffer->Release();
-	lightBuffer->Release();
-	materialBuffer->Release();
+	if (cameraBuffer)
+		delete cameraBuffer;
+	if (lightBuffers)
+		delete lightBuffers;
+	if (materialBuffer)
+		delete materialBuffer;
+	if (displacementBuffer)
+		delete displacementBuffer;
+	if (effectsBuffer)
+		delete effectsBuffer;
+	if (shadowSampler)
+		shadowSampler->Release();
+	for (Permutation& permutation : permutations)
+		permutation.pixelShader->Release();
+	if (mainPixelShader)
+		pixelShader = mainPixelShader;//released along with the other stages
 }
 
 void LitShader::initBuffers() {
 
 	//Setup camera buffer
-	SETUP_SHADER_BUFFER(CameraBufferType, cameraBuffer);
+	cameraBuffer = new CachedConstantBuffer(renderer, sizeof(CameraBufferType));
 
-	//Setup light buffer
-	SETUP_SHADER_BUFFER(LightBufferType, lightBuffer);
+	//Setup light and shadowmap matrix buffers
+	lightBuffers = new LightBuffers(renderer);
 
 	//Setup material buffer
-	SETUP_SHADER_BUFFER(MaterialBufferType, materialBuffer);
+	materialBuffer = new CachedConstantBuffer(renderer, sizeof(MaterialBufferType));
 
 	//Setup displacement buffer
-	SETUP_SHADER_BUFFER(DisplacementBufferType, displacementBuffer);
-
-	//Setup shadowmap matrix buffer
-	SETUP_SHADER_BUFFER(ShadowmapMatrixBufferType, shadowmapMatrixBuffer);
+	displacementBuffer = new CachedConstantBuffer(renderer, sizeof(DisplacementBufferType));
 
 	//Setup effects buffer
-	SETUP_SHADER_BUFFER(EffectsBufferType, effectsBuffer);
+	effectsBuffer = new CachedConstantBuffer(renderer, sizeof(EffectsBufferType));
 
 	// Create sampler states
 	D3D11_SAMPLER_DESC samplerDesc;
@@ -46,142 +60,178 @@ void LitShader::initBuffers() {
 
 	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
 	renderer->CreateSamplerState(&samplerDesc, &pointSampler);
+
+	//Shadowmap sampler: SampleCmpLevelZero tests the 4 texels around the uv against the fragment's depth and filters the results
+	samplerDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.ComparisonFunc = D3D11_COMPARISON_GREATER;//lit where the fragment is closer to the light than the shadowmap
+	HRESULT result = renderer->CreateSamplerState(&samplerDesc, &shadowSampler);
+	if (result != S_OK) {
+		printf("Error creating shadowmap comparison sampler: ");
+		printError(result);
+	}
 }
 
 void LitShader::setEffectParameters(ID3D11DeviceContext* deviceContext, float time) {
 
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	
-	EffectsBufferType* effectsPtr;
-	deviceContext->Map(effectsBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	effectsPtr = (EffectsBufferType*)mappedResource.pData;
-	effectsPtr->time = time;
-	deviceContext->Unmap(effectsBuffer, 0);
-	deviceContext->PSSetConstantBuffers(5, 1, &effectsBuffer);
+	RenderBackend* backend = GLOBALS.RenderBackend;
+
+	EffectsBufferType effects = {};
+	effects.time = time;
+	effectsBuffer->update(&effects);
+	backend->setConstantBuffer(RenderBackend::PS, 5, effectsBuffer->getBuffer());
 
 }
 
-void LitShader::setLightParameters(ID3D11DeviceContext* deviceContext, XMFLOAT3 cameraPosition, ExtendedLight** lights, ID3D11ShaderResourceView** shadowmaps, bool sendShadowmaps, int numLights){
+void LitShader::setLightParameters(ID3D11DeviceContext* deviceContext, XMFLOAT3 cameraPosition, ExtendedLight** lights, ID3D11ShaderResourceView** shadowmaps, bool sendShadowmaps, int numLights, LightBuffers* buffers){
 
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	RenderBackend* backend = GLOBALS.RenderBackend;
+	if (!buffers) buffers = lightBuffers;
 
 	// Send camera data to vertex shader
-	CameraBufferType* cameraPtr;
-	deviceContext->Map(cameraBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	cameraPtr = (CameraBufferType*)mappedResource.pData;
-	cameraPtr->cameraPosition = cameraPosition;
-	cameraPtr->farPlane = FAR_PLANE;
-	deviceContext->Unmap(cameraBuffer, 0);
-	if(domainShader)//send to domain shader
-		deviceContext->DSSetConstantBuffers(1, 1, &cameraBuffer);
-	else//send to vertex shader instead
-		deviceContext->VSSetConstantBuffers(1, 1, &cameraBuffer);
+	CameraBufferType camera = {};
+	camera.cameraPosition = cameraPosition;
+	camera.farPlane = FAR_PLANE;
+	cameraBuffer->update(&camera);
+	backend->setConstantBuffer(domainShader ? RenderBackend::DS : RenderBackend::VS, 1, cameraBuffer->getBuffer());//send to domain shader if there is one, vertex shader otherwise
 
 	// Send light data to pixel shader
-	LightBufferType* lightPtr;
-	deviceContext->Map(lightBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	lightPtr = (LightBufferType*)mappedResource.pData;
+	LightBufferType light = {};
 	//ambient is the first light's Ambient component only.
 	if (numLights > 0)
-		lightPtr->ambient = (*lights)[0].getAmbientColour();
+		light.ambient = (*lights)[0].getAmbientColour();
 	else
-		lightPtr->ambient = XMFLOAT4(1, 1, 1, 1);
+		light.ambient = XMFLOAT4(1, 1, 1, 1);
 	//add all the lights:
-	for (int light = 0; light < NUM_LIGHTS; ++light) {
-		if (light < numLights) {
-			lightPtr->diffuse[light] = (*lights)[light].getDiffuseColour();
-			lightPtr->position[light] = XMFLOAT4((*lights)[light].getPosition().x, (*lights)[light].getPosition().y, (*lights)[light].getPosition().z, (*lights)[light].getType());
-			lightPtr->direction[light] = (*lights)[light].getFormattedDirection();
-			lightPtr->attenuation[light] = (*lights)[light].getAttenuation();
-			lightPtr->attenuation[light].w = (*lights)[light].shouldBypassShadows() || !sendShadowmaps ? 0 : 1;//w of attenuation is whether we want shadows from this light
+	for (int l = 0; l < NUM_LIGHTS; ++l) {
+		if (l < numLights) {
+			light.diffuse[l] = (*lights)[l].getDiffuseColour();
+			light.position[l] = XMFLOAT4((*lights)[l].getPosition().x, (*lights)[l].getPosition().y, (*lights)[l].getPosition().z, (*lights)[l].getType());
+			light.direction[l] = (*lights)[l].getFormattedDirection();
+			light.attenuation[l] = (*lights)[l].getAttenuation();
+			light.attenuation[l].w = (*lights)[l].shouldBypassShadows() || !sendShadowmaps ? 0 : 1;//w of attenuation is whether we want shadows from this light
 		}
 		else {
-			lightPtr->position[light] = XMFLOAT4(UNUSED_SHADER_PARAM, UNUSED_SHADER_PARAM, UNUSED_SHADER_PARAM, INACTIVE_LIGHT);//w component is 0 meaning light is inactive.
+			light.position[l] = XMFLOAT4(UNUSED_SHADER_PARAM, UNUSED_SHADER_PARAM, UNUSED_SHADER_PARAM, INACTIVE_LIGHT);//w component is 0 meaning light is inactive.
 		}
 	}
-	lightPtr->oneOverFarPlane = 1.0f / FAR_PLANE;
-	lightPtr->shadowmapBias = GLOBALS.ShadowmapBias;
-	lightPtr->showShadowmapErrors = GLOBALS.ShadowmapSeeErrors ? 1 : 0;
-	lightPtr->oneOverShadowmapSize = numLights > 0 ? 1.0f / lights[0]->getShadowmapRes() : 1;
-	deviceContext->Unmap(lightBuffer, 0);
-	deviceContext->PSSetConstantBuffers(0, 1, &lightBuffer);
+	light.oneOverFarPlane = 1.0f / FAR_PLANE;
+	light.shadowmapBias = GLOBALS.ShadowmapBias;
+	light.showShadowmapErrors = GLOBALS.ShadowmapSeeErrors ? 1 : 0;
+	light.oneOverShadowmapSize = numLights > 0 ? 1.0f / lights[0]->getShadowmapRes() : 1;
+	light.shadowmapTaps = float(4 * GLOBALS.ShadowmapKernel);
+	buffers->light.update(&light);
+	backend->setConstantBuffer(RenderBackend::PS, 0, buffers->light.getBuffer());
+
+	//pick the fragment shader variant for these lights
+	drawLights = numLights;
+	for (int l = 0; l < numLights; ++l) {
+		float type = (*lights)[l].getType();
+		int shadows = light.attenuation[l].w == 1 ? 1 : 0;
+		drawLightType = l == 0 || type == drawLightType ? type : -1;
+		drawShadows = l == 0 || shadows == drawShadows ? shadows : -1;
+	}
+	selectPermutation();
 
 	// Send shadowmap data to vertex or domain shader
-	ShadowmapMatrixBufferType* smbPtr;
-	deviceContext->Map(shadowmapMatrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	smbPtr = (ShadowmapMatrixBufferType*)mappedResource.pData;
-	for (int light = 0; light < NUM_LIGHTS; ++light) {
-		if (light < numLights && !(*lights)[light].shouldBypassShadows()) {//pass this light's matrices
-			smbPtr->shadowmapMode[light] = XMFLOAT4(1, UNUSED_SHADER_PARAM, UNUSED_SHADER_PARAM, UNUSED_SHADER_PARAM);
-			smbPtr->lightView[light] = XMMatrixTranspose((*lights)[light].getView());// transpose matrices to prepare for mul in shaders
-			smbPtr->lightProjection[light] = XMMatrixTranspose((*lights)[light].getProjection());
+	ShadowmapMatrixBufferType shadowmapMatrices = {};
+	for (int l = 0; l < NUM_LIGHTS; ++l) {
+		if (l < numLights && !(*lights)[l].shouldBypassShadows()) {//pass this light's matrices
+			shadowmapMatrices.shadowmapMode[l] = XMFLOAT4(1, UNUSED_SHADER_PARAM, UNUSED_SHADER_PARAM, UNUSED_SHADER_PARAM);
+			shadowmapMatrices.lightView[l] = XMMatrixTranspose((*lights)[l].getView());// transpose matrices to prepare for mul in shaders
+			shadowmapMatrices.lightProjection[l] = XMMatrixTranspose((*lights)[l].getProjection());
 		}
 		else {//ignore this light for shadowmaps
-			smbPtr->shadowmapMode[light] = XMFLOAT4(0, UNUSED_SHADER_PARAM, UNUSED_SHADER_PARAM, UNUSED_SHADER_PARAM);
+			shadowmapMatrices.shadowmapMode[l] = XMFLOAT4(0, UNUSED_SHADER_PARAM, UNUSED_SHADER_PARAM, UNUSED_SHADER_PARAM);
 		}
 	}
-	deviceContext->Unmap(shadowmapMatrixBuffer, 0);
-	if (domainShader)//send to domain
-		deviceContext->DSSetConstantBuffers(3, 1, &shadowmapMatrixBuffer);
-	else//send to vertex
-		deviceContext->VSSetConstantBuffers(3, 1, &shadowmapMatrixBuffer);
+	buffers->shadowmapMatrices.update(&shadowmapMatrices);
+	backend->setConstantBuffer(domainShader ? RenderBackend::DS : RenderBackend::VS, 3, buffers->shadowmapMatrices.getBuffer());
 
 	// Send shadowmaps to fragment
 	if(sendShadowmaps)
-		deviceContext->PSSetShaderResources(2, numLights, shadowmaps);
+		backend->setShaderResources(RenderBackend::PS, 2, numLights, shadowmaps);
 }
 
 void LitShader::setMaterialParameters(ID3D11DeviceContext* deviceContext, ID3D11ShaderResourceView* texture, ID3D11ShaderResourceView* normalMap, ID3D11ShaderResourceView* displacementMap, Material* material) {
 
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	RenderBackend* backend = GLOBALS.RenderBackend;
 
 	// Send material data to pixel shader
 	if (material != nullptr) {//if it's null, just keep the previous one; allows for optimization if we're drawing multiple meshes with the same mat
-		MaterialBufferType* materialPtr;
-		deviceContext->Map(materialBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-		materialPtr = (MaterialBufferType*)mappedResource.pData;
+		MaterialBufferType materialData = {};
 		if (texture)
-			materialPtr->mode = normalMap && GLOBALS.normalMapping ? DIFFUSE_AND_NORMAL_MAP : DIFFUSE_TEXTURE;
+			materialData.mode = normalMap && GLOBALS.normalMapping ? DIFFUSE_AND_NORMAL_MAP : DIFFUSE_TEXTURE;
 		else
-			materialPtr->mode = normalMap && GLOBALS.normalMapping ? NORMAL_MAP : COLOUR;
-		materialPtr->colour = material->colour;
-		materialPtr->specularColour = material->specularColour;
-		materialPtr->specularPower = material->specularPower;
-		materialPtr->emissive = material->emissive;
-		deviceContext->Unmap(materialBuffer, 0);
-		deviceContext->PSSetConstantBuffers(1, 1, &materialBuffer);
+			materialData.mode = normalMap && GLOBALS.normalMapping ? NORMAL_MAP : COLOUR;
+		materialData.colour = material->colour;
+		materialData.specularColour = material->specularColour;
+		materialData.specularPower = material->specularPower;
+		materialData.emissive = material->emissive;
+		materialBuffer->update(&materialData);
+		backend->setConstantBuffer(RenderBackend::PS, 1, materialBuffer->getBuffer());
+
+		drawNormalMapping = normalMap && GLOBALS.normalMapping;
+		selectPermutation();
 	}
 
 	// Set shader texture resources in the pixel shader.
 	if (texture)
-		deviceContext->PSSetShaderResources(0, 1, &texture);
+		backend->setShaderResources(RenderBackend::PS, 0, 1, &texture);
 	if (normalMap)
-		deviceContext->PSSetShaderResources(1, 1, &normalMap);
+		backend->setShaderResources(RenderBackend::PS, 1, 1, &normalMap);
 
 	//Set displacement map resources in domain shader
 	if (domainShader) {
 
 		//send displacement buffer:
-		DisplacementBufferType* dispPtr;
-		deviceContext->Map(displacementBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-		dispPtr = (DisplacementBufferType*)mappedResource.pData;
+		DisplacementBufferType displacement = {};
 		if (displacementMap)
-			dispPtr->mode = DISPLACEMENT;
+			displacement.mode = DISPLACEMENT;
 		else
-			dispPtr->mode = NO_DISPLACEMENT;
-		dispPtr->scale = GLOBALS.DisplacementScale;
-		dispPtr->bias = -GLOBALS.DisplacementScale/2.0f;
-		dispPtr->mapSize = 1024;
-		deviceContext->Unmap(displacementBuffer, 0);
-		deviceContext->DSSetConstantBuffers(2, 1, &displacementBuffer);
+			displacement.mode = NO_DISPLACEMENT;
+		displacement.scale = GLOBALS.DisplacementScale;
+		displacement.bias = -GLOBALS.DisplacementScale/2.0f;
+		displacement.mapSize = 1024;
+		displacementBuffer->update(&displacement);
+		backend->setConstantBuffer(RenderBackend::DS, 2, displacementBuffer->getBuffer());
 
 		if (displacementMap) {
-			deviceContext->DSSetShaderResources(0, 1, &displacementMap);
+			backend->setShaderResources(RenderBackend::DS, 0, 1, &displacementMap);
 		}
 	}
 
 
 	// Set sampler resources in the pixel shader
-	deviceContext->PSSetSamplers(0, 1, &sampleState);
-	deviceContext->PSSetSamplers(1, 1, &pointSampler);
+	backend->setSampler(RenderBackend::PS, 0, sampleState);
+	backend->setSampler(RenderBackend::PS, 1, pointSampler);
+	backend->setSampler(RenderBackend::PS, 2, shadowSampler);
+}
+
+void LitShader::addPermutation(WCHAR* psFilename, int numLights, float lightType, bool shadows, bool normalMapping) {
+	if (!mainPixelShader)
+		mainPixelShader = pixelShader;
+	pixelShader = nullptr;
+	loadPixelShader(psFilename);//loads into pixelShader
+	if (pixelShader)
+		permutations.push_back(Permutation{ numLights, lightType, shadows, normalMapping, pixelShader });
+	pixelShader = mainPixelShader;
+}
+
+void LitShader::selectPermutation() {
+	if (permutations.empty()) return;
+
+	ID3D11PixelShader* selected = mainPixelShader;
+	for (const Permutation& permutation : permutations) {
+		if (permutation.numLights == drawLights && permutation.lightType == drawLightType && int(permutation.shadows) == drawShadows && permutation.normalMapping == drawNormalMapping) {
+			selected = permutation.pixelShader;
+			break;
+		}
+	}
+	if (selected != pixelShader) {
+		pixelShader = selected;
+		GLOBALS.RenderBackend->invalidateShader();//the stages need setting again for the swap to take
+	}
 }
\ No newline at end of file
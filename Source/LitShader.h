@@ -1,5 +1,6 @@
 #pragma once
 #include "Shader.h"
+#include <vector>
 
 ///Base shader for any lit piece of geometry
 
@@ -14,6 +15,11 @@
 #define NO_DISPLACEMENT 0
 #define DISPLACEMENT 1
 
+///use the following after SETUP_SHADER to add a variant of the fragment shader, compiled with some of its permutation options fixed (see the top of terrain_fs), as such:
+///  SETUP_PERMUTATION(terrain_fs_1dir_shadows, 1, DIRECTIONAL_LIGHT, true, false);
+///draws with that many lights, all of that type, all with or without shadows, and with or without normal mapping then use the variant instead
+#define SETUP_PERMUTATION(frag, numLights, lightType, shadows, normalMapping) addPermutation((WCHAR*)L"" SHADER_PATH #frag ".cso", numLights, lightType, shadows, normalMapping)
+
 class LitShader : public Shader{
 
 protected:
@@ -35,6 +41,8 @@ protected:
 		float shadowmapBias;
 		float showShadowmapErrors;
 		float oneOverShadowmapSize;
+		float shadowmapTaps;//4, 8, 12 or 16
+		XMFLOAT3 padding;
 	};
 
 	///passes material information to FS; expected to be written to gpu for each different mesh
@@ -69,27 +77,60 @@ protected:
 	};
 
 public:
+	///Light and shadowmap matrix buffers for one set of lights; anything drawn with its own lights (eg each terrain chunk) should keep one of these, so its lights stay on the gpu between frames instead of being re-uploaded for each draw
+	class LightBuffers {
+		friend class LitShader;
+	public:
+		LightBuffers(ID3D11Device* device);
+	private:
+		CachedConstantBuffer light;				//PS b0
+		CachedConstantBuffer shadowmapMatrices;	//VS b3 or DS b3
+	};
+
 	LitShader();
 	virtual ~LitShader();
 	
-	///should be called only once per frame
-	void setLightParameters(ID3D11DeviceContext* deviceContext, XMFLOAT3 cameraPosition, ExtendedLight** lights, ID3D11ShaderResourceView** shadowmaps, bool sendShadowmaps, int numLights);
+	///uploads only what changed since the last call with the same buffers; when buffers is null, the shader's own are used
+	void setLightParameters(ID3D11DeviceContext* deviceContext, XMFLOAT3 cameraPosition, ExtendedLight** lights, ID3D11ShaderResourceView** shadowmaps, bool sendShadowmaps, int numLights, LightBuffers* buffers = nullptr);
 	///setup material parameters for any shader (colour, texture, etc)
 	void setMaterialParameters(ID3D11DeviceContext* deviceContext, ID3D11ShaderResourceView* texture, ID3D11ShaderResourceView* normalMap, ID3D11ShaderResourceView* displacementMap, Material* material);
 	///setup effects-related input
 	void setEffectParameters(ID3D11DeviceContext* deviceContext, float time);
 
+	/// Don't call this directly! Use SETUP_PERMUTATION instead.
+	void addPermutation(WCHAR* psFilename, int numLights, float lightType, bool shadows, bool normalMapping);
+
 protected:
 	virtual void initBuffers() override;
 
 private:
-	ID3D11Buffer* cameraBuffer;			//VS b1 or DS b1
-	ID3D11Buffer* lightBuffer;			//PS b0
-	ID3D11Buffer* materialBuffer;		//PS b1
-	ID3D11Buffer* displacementBuffer;	//DS b2
-	ID3D11Buffer* shadowmapMatrixBuffer;//VS b3 or DS b3
-	ID3D11Buffer* effectsBuffer;		//PS b5
+	CachedConstantBuffer* cameraBuffer = nullptr;		//VS b1 or DS b1
+	LightBuffers* lightBuffers = nullptr;				//for draws that don't bring their own
+	CachedConstantBuffer* materialBuffer = nullptr;		//PS b1
+	CachedConstantBuffer* displacementBuffer = nullptr;	//DS b2
+	CachedConstantBuffer* effectsBuffer = nullptr;		//PS b5
 
 	ID3D11SamplerState* pointSampler;	//PS s1
+	ID3D11SamplerState* shadowSampler = nullptr;	//PS s2, comparison sampler for the shadowmaps
+
+	///A variant of the fragment shader, and the draws it was compiled for
+	struct Permutation {
+		int numLights;
+		float lightType;
+		bool shadows;
+		bool normalMapping;
+		ID3D11PixelShader* pixelShader;
+	};
+	std::vector<Permutation> permutations;
+	ID3D11PixelShader* mainPixelShader = nullptr;//the one SETUP_SHADER loaded, for draws none of the variants fit
+
+	//what the next draw needs, as set by the last setLightParameters() and setMaterialParameters()
+	int drawLights = -1;
+	float drawLightType = -1;//-1 if the lights aren't all of the same type
+	int drawShadows = -1;//1 if all the lights read their shadowmaps, 0 if none of them do, -1 if only some do
+	bool drawNormalMapping = false;
+
+	///Swaps in the variant that fits the next draw, or the main fragment shader if none does
+	void selectPermutation();
 };
 
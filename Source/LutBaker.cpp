@@ -0,0 +1,394 @@
+#include "LutBaker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <DirectXPackedVector.h>
+#include "Profiler.h"
+
+///Port of tonemapping_fs
+///Using: Zhang D., Zheng B. (2017) GPU-Based Post-Processing Color Grading Algorithms in Real-Time Rendering for Mobile Commerce Service User. In: Pan Z., Cheok A., Muller W., Zhang M. (eds) Transactions on Edutainment XIII. Lecture Notes in Computer Science, vol 10092. Springer, Berlin, Heidelberg
+///Using: https://github.com/ampas/aces-dev
+
+#pragma region Constants
+
+#define EPSILON 1e-10f
+#define PI 3.141592f
+#define HALF_MAX 65504.0f
+#define ROOT_OF_3 1.73205f
+#define CONTRAST_FACTOR 1.01568f
+#define YC_RADIUS_WEIGHT 1.75f
+#define RRT_GLOW_GAIN 0.05f
+#define RRT_GLOW_MID 0.08f
+#define RRT_RED_HUE 0.0f
+#define RRT_RED_WIDTH 135.0f
+#define RRT_RED_PIVOT 0.03f
+#define RRT_RED_SCALE 0.82f
+#define RRT_SAT_FACTOR 0.96f
+#define CINEMA_WHITE 48.0f
+#define CINEMA_BLACK (CINEMA_WHITE / 2400.0f)
+#define DIM_SURROUND_GAMMA 0.9811f
+#define ODT_SAT_FACTOR 0.93f
+
+struct float3 {
+	float x, y, z;
+	inline float3 operator+(const float3& o) const { return { x + o.x, y + o.y, z + o.z }; }
+	inline float3 operator-(const float3& o) const { return { x - o.x, y - o.y, z - o.z }; }
+	inline float3 operator*(float s) const { return { x * s, y * s, z * s }; }
+};
+typedef float float3x3[3][3];
+
+static inline float3 mul(const float3x3& m, const float3& v) {
+	return { m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z, m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z, m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z };
+}
+static inline float dot(const float3& a, const float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+static inline float saturate(float x) { return std::min(std::max(x, 0.0f), 1.0f); }
+static inline float frac(float x) { return x - std::floor(x); }
+
+static const float3 AP1_RGB2Y = { 0.272229f, 0.674082f, 0.0536895f };
+
+static const float3x3 sRGB_2_AP0 = {
+	{ 0.4397010f, 0.3829780f, 0.1773350f },
+	{ 0.0897923f, 0.8134230f, 0.0967616f },
+	{ 0.0175440f, 0.1115440f, 0.8707040f }
+};
+static const float3x3 AP1_2_AP0_MAT = {
+	{ 0.6954522414f, 0.1406786965f, 0.1638690622f },
+	{ 0.0447945634f, 0.8596711185f, 0.0955343182f },
+	{ -0.0055258826f, 0.0040252103f, 1.0015006723f }
+};
+static const float3x3 AP0_2_AP1_MAT = {
+	{ 1.4514393161f, -0.2365107469f, -0.2149285693f },
+	{ -0.0765537734f, 1.1762296998f, -0.0996759264f },
+	{ 0.0083161484f, -0.0060324498f, 0.9977163014f }
+};
+static const float3x3 AP1_2_XYZ_MAT = {
+	{ 0.6624541811f, 0.1340042065f, 0.1561876870f },
+	{ 0.2722287168f, 0.6740817658f, 0.0536895174f },
+	{ -0.0055746495f, 0.0040607335f, 1.0103391003f }
+};
+static const float3x3 XYZ_2_AP1_MAT = {
+	{ 1.6410233797f, -0.3248032942f, -0.2364246952f },
+	{ -0.6636628587f, 1.6153315917f, 0.0167563477f },
+	{ 0.0117218943f, -0.0082844420f, 0.9883948585f }
+};
+static const float3x3 D60_2_D65_CAT = {
+	{ 0.98722400f, -0.00611327f, 0.0159533f },
+	{ -0.00759836f, 1.00186000f, 0.0053302f },
+	{ 0.00307257f, -0.00509595f, 1.0816800f }
+};
+static const float3x3 XYZ_2_REC709_MAT = {
+	{ 3.2409699419f, -1.5373831776f, -0.4986107603f },
+	{ -0.9692436363f, 1.8759675015f, 0.0415550574f },
+	{ 0.0556300797f, -0.2039769589f, 1.0569715142f }
+};
+static const float3x3 M = {//Matrix for segmented spline functions
+	{ 0.5f, -1.0f, 0.5f },
+	{ -1.0f, 1.0f, 0.0f },
+	{ 0.5f, 0.5f, 0.0f }
+};
+
+#pragma endregion Constants
+
+#pragma region Conversion
+
+///Converts colour from RGB to HSV (0..1, 0..1, 0..1)
+static float3 rgb_to_hsv(const float3& input) {
+	//from http://chilliant.blogspot.com/2014/04/rgbhsv-in-hlsl-5.html
+	float p[4], q[4];
+	if (input.z <= input.y) { p[0] = input.y; p[1] = input.z; p[2] = 0.0f; p[3] = -1.0f / 3.0f; }
+	else { p[0] = input.z; p[1] = input.y; p[2] = -1.0f; p[3] = 2.0f / 3.0f; }
+	if (p[0] <= input.x) { q[0] = input.x; q[1] = p[1]; q[2] = p[2]; q[3] = p[0]; }
+	else { q[0] = p[0]; q[1] = p[1]; q[2] = p[3]; q[3] = input.x; }
+	float d = q[0] - std::min(q[3], q[1]);
+	return { std::abs(q[2] + (q[3] - q[1]) / (6.0f * d + EPSILON)), d / (q[0] + EPSILON), q[0] };
+}
+
+///Converts colour from HSV to RGB (0..1, 0..1, 0..1)
+static float3 hsv_to_rgb(const float3& input) {
+	//from Unity's shaders source
+	float px = std::abs(frac(input.x + 1.0f) * 6.0f - 3.0f);
+	float py = std::abs(frac(input.x + 2.0f / 3.0f) * 6.0f - 3.0f);
+	float pz = std::abs(frac(input.x + 1.0f / 3.0f) * 6.0f - 3.0f);
+	float3 p = { saturate(px - 1.0f), saturate(py - 1.0f), saturate(pz - 1.0f) };
+	float3 one = { 1, 1, 1 };
+	return (one + (p - one) * input.y) * input.z;
+}
+
+///Gets saturation 0..1 from RGB colour
+static float rgb_to_sat(const float3& input) {
+	float mi = std::min(input.x, std::min(input.y, input.z));
+	float ma = std::max(input.x, std::max(input.y, input.z));
+	return (std::max(ma, EPSILON) - std::max(mi, EPSILON)) / std::max(ma, 1e-2f);
+}
+
+///Gets hue 0..360 from RGB colour
+static float rgb_to_hue(const float3& input) {
+	if (input.x == input.y && input.y == input.z)
+		return 0.0f;
+	float hue = (180.0f / PI) * std::atan2(ROOT_OF_3 * (input.y - input.z), 2.0f * input.x - input.y - input.z);
+	if (hue < 0.0f) hue += 360.0f;
+	return hue;
+}
+
+///Converts colour from RGB to normalized luminance proxy (Y + K * Chroma)
+static float rgb_to_yc(const float3& input) {
+	float chroma = std::sqrt(std::max(input.z * (input.z - input.y) + input.y * (input.y - input.x) + input.x * (input.x - input.z), 0.0f));
+	return (input.z + input.y + input.x + YC_RADIUS_WEIGHT * chroma) / 3.0f;
+}
+
+///Converts colour from dark surrounding to dim surrounding
+static float3 darkSurround_to_dimSurround(const float3& linearCV) {
+	float3 xyz = mul(AP1_2_XYZ_MAT, linearCV);
+
+	//XYZ to xyY
+	float divisor = std::max(xyz.x + xyz.y + xyz.z, 1e-4f);
+	float3 xyy = { xyz.x / divisor, xyz.y / divisor, xyz.y };
+	xyy.z = std::min(std::max(xyy.z, 0.0f), HALF_MAX);
+	xyy.z = std::pow(xyy.z, DIM_SURROUND_GAMMA);
+
+	//and back
+	float m = xyy.z / std::max(xyy.y, 1e-4f);
+	xyz = { xyy.x * m, xyy.z, (1.0f - xyy.x - xyy.y) * m };
+
+	return mul(XYZ_2_AP1_MAT, xyz);
+}
+
+#pragma endregion Conversion
+
+#pragma region MathFunctions
+
+///Sigmoid function in 0..1 spanning -2..2
+static float sigmoidShaper(float input) {
+	float t = std::max(1.0f - std::abs(input / 2.0f), 0.0f);
+	float sign = input > 0 ? 1.0f : input < 0 ? -1.0f : 0.0f;
+	return (1.0f + sign * (1.0f - t * t)) / 2.0f;
+}
+
+///B-spline through the knots in log-log space, with linear extensions past either end
+static float segmentedSpline(float x, float xMin, const float* coefsLow, const float* coefsHigh, int knots, float minX, float minY, float midX, float maxX, float maxY, float slopeLow, float slopeHigh) {
+	// Check for negatives or zero before taking the log
+	float logx = std::log10(x <= 0.0f ? xMin : x);
+	float logy;
+
+	if (logx <= std::log10(minX)) {
+		logy = logx * slopeLow + (std::log10(minY) - slopeLow * std::log10(minX));
+	}
+	else if (logx < std::log10(midX) || logx < std::log10(maxX)) {
+		bool low = logx < std::log10(midX);
+		float from = low ? minX : midX, to = low ? midX : maxX;
+		const float* coefs = low ? coefsLow : coefsHigh;
+		float knotCoord = (knots - 1) * (logx - std::log10(from)) / (std::log10(to) - std::log10(from));
+		int j = int(knotCoord);
+		float t = knotCoord - j;
+
+		float3 cf = { coefs[j], coefs[j + 1], coefs[j + 2] };
+		float3 monomials = { t * t, t, 1.0f };
+		logy = dot(monomials, mul(M, cf));
+	}
+	else {
+		logy = logx * slopeHigh + (std::log10(maxY) - slopeHigh * std::log10(maxX));
+	}
+
+	return std::pow(10.0f, logy);
+}
+
+///Segmented spline functions, from Unity's shaders source
+static float segmentedSplineC5Fwd(float x) {
+	static const float coefsLow[6] = { -4.0000000000f, -4.0000000000f, -3.1573765773f, -0.4852499958f, 1.8477324706f, 1.8477324706f };
+	static const float coefsHigh[6] = { -0.7185482425f, 2.0810307172f, 3.6681241237f, 4.0000000000f, 4.0000000000f, 4.0000000000f };
+	return segmentedSpline(x, 0.00006103515f, coefsLow, coefsHigh, 4, 0.18f * std::exp2(-15.0f), 0.0001f, 0.18f, 0.18f * std::exp2(18.0f), 10000.0f, 0.0f, 0.0f);
+}
+static float segmentedSplineC9Fwd(float x) {
+	static const float coefsLow[10] = { -1.6989700043f, -1.6989700043f, -1.4779000000f, -1.2291000000f, -0.8648000000f, -0.4480000000f, 0.0051800000f, 0.4511080334f, 0.9113744414f, 0.9113744414f };
+	static const float coefsHigh[10] = { 0.5154386965f, 0.8470437783f, 1.1358000000f, 1.3802000000f, 1.5197000000f, 1.5985000000f, 1.6467000000f, 1.6746091357f, 1.6878733390f, 1.6878733390f };
+	static const float minX = segmentedSplineC5Fwd(0.18f * std::exp2(-6.5f));
+	static const float midX = segmentedSplineC5Fwd(0.18f);
+	static const float maxX = segmentedSplineC5Fwd(0.18f * std::exp2(6.5f));
+	return segmentedSpline(x, 1e-4f, coefsLow, coefsHigh, 8, minX, 0.02f, midX, maxX, 48.0f, 0.0f, 0.04f);
+}
+
+static float glowFwd(float yc, float glowGain, float glowMid) {
+	if (yc <= 2.0f / 3.0f * glowMid)
+		return glowGain;
+	else if (yc >= 2.0f * glowMid)
+		return 0.0f;
+	else
+		return glowGain * (glowMid / yc - 1.0f / 2.0f);
+}
+
+///Centers hue -180..180
+static float centerHue(float hue, float centerH) {
+	float hueCentered = hue - centerH;
+	if (hueCentered < -180.0f) hueCentered += 360.0f;
+	else if (hueCentered > 180.0f) hueCentered -= 360.0f;
+	return hueCentered;
+}
+
+#pragma endregion MathFunctions
+
+
+///Converts OCES colour for use in desktop monitors (dim surround)
+static float3 ODT_RGBmonitor_100nits_dim(const float3& oces) {
+	// OCES to RGB rendering space, then the tonescale independently in each channel
+	float3 rgbPre = mul(AP0_2_AP1_MAT, oces);
+	float3 rgbPost = { segmentedSplineC9Fwd(rgbPre.x), segmentedSplineC9Fwd(rgbPre.y), segmentedSplineC9Fwd(rgbPre.z) };
+
+	// Scale luminance to linear code value
+	float3 linearCV = (rgbPost - float3{ CINEMA_BLACK, CINEMA_BLACK, CINEMA_BLACK }) * (1.0f / (CINEMA_WHITE - CINEMA_BLACK));
+
+	// Apply gamma adjustment to compensate for dim surround
+	linearCV = darkSurround_to_dimSurround(linearCV);
+
+	// Apply desaturation to compensate for luminance difference
+	float y = dot(linearCV, AP1_RGB2Y);
+	linearCV = float3{ y, y, y } + (linearCV - float3{ y, y, y }) * ODT_SAT_FACTOR;
+
+	// Rendering space RGB to XYZ, white point from ACES to the observer's, then to display primaries
+	float3 XYZ = mul(D60_2_D65_CAT, mul(AP1_2_XYZ_MAT, linearCV));
+	linearCV = mul(XYZ_2_REC709_MAT, XYZ);
+
+	// Handle out-of-gamut values
+	return { saturate(linearCV.x), saturate(linearCV.y), saturate(linearCV.z) };
+}
+
+///Reference Rendering Transform (ACES)
+static float3 rrt(float3 aces) {
+
+	///Glow
+	float sat = rgb_to_sat(aces);
+	float yc = rgb_to_yc(aces);
+	float s = sigmoidShaper((sat - 0.4f) / 0.2f);
+	aces = aces * (1.0f + glowFwd(yc, RRT_GLOW_GAIN * s, RRT_GLOW_MID));
+
+	///Red modifier
+	float hue = rgb_to_hue(aces);
+	float centeredHue = centerHue(hue, RRT_RED_HUE);
+	float t = saturate(1.0f - std::abs(2.0f * centeredHue / RRT_RED_WIDTH));
+	float hueWeight = t * t * (3.0f - 2.0f * t);//smoothstep
+	hueWeight *= hueWeight;
+
+	aces.x += hueWeight * sat * (RRT_RED_PIVOT - aces.x) * (1.0f - RRT_RED_SCALE);
+
+	///ACES to RGB space
+	auto clampHalf = [](float3 c) { return float3{ std::min(std::max(c.x, 0.0f), HALF_MAX), std::min(std::max(c.y, 0.0f), HALF_MAX), std::min(std::max(c.z, 0.0f), HALF_MAX) }; };
+	float3 rgb = clampHalf(mul(AP0_2_AP1_MAT, clampHalf(aces)));
+
+	///Global desaturation
+	float y = dot(rgb, AP1_RGB2Y);
+	rgb = float3{ y, y, y } + (rgb - float3{ y, y, y }) * RRT_SAT_FACTOR;
+
+	///Tonescale
+	rgb = { segmentedSplineC5Fwd(rgb.x), segmentedSplineC5Fwd(rgb.y), segmentedSplineC5Fwd(rgb.z) };
+
+	///Convert to OCES
+	return mul(AP1_2_AP0_MAT, rgb);
+}
+
+
+void LutBaker::tonemap(const float colour[3], const TonemappingParams& params, float out[3]) {
+	float3 color = float3{ colour[0], colour[1], colour[2] } * params.exposure;
+
+	//Filmic colours (ACES)
+	if (params.tonemapping == TONEMAP_ACES) {
+		color = ODT_RGBmonitor_100nits_dim(rrt(mul(sRGB_2_AP0, color)));
+	}
+
+	//Brightness
+	color = color + float3{ params.brightness, params.brightness, params.brightness };
+
+	//Hue, saturation and value
+	float3 hsv = rgb_to_hsv(color);
+	hsv.x += params.hue;
+	if (hsv.x >= 1.0f) hsv.x -= 1.0f;
+	hsv.y *= params.saturation;
+	hsv.z *= params.value;
+	color = hsv_to_rgb(hsv);
+
+	//Contrast (from https://www.dfstudios.co.uk/articles/programming/image-programming-algorithms/image-processing-algorithms-part-5-contrast-adjustment/)
+	float factor = (CONTRAST_FACTOR * (params.contrast + 1.0f)) / (1.0f * (CONTRAST_FACTOR - params.contrast));
+	out[0] = saturate(factor * (color.x - 0.5f) + 0.5f);
+	out[1] = saturate(factor * (color.y - 0.5f) + 0.5f);
+	out[2] = saturate(factor * (color.z - 0.5f) + 0.5f);
+}
+
+
+LutStrip LutBaker::tonemapStrip(const LutStrip& strip, const TonemappingParams& params) {
+	LutStrip tonemapped = strip;
+	for (size_t i = 0; i < strip.texels.size(); i += 4) {
+		tonemap(&strip.texels[i], params, &tonemapped.texels[i]);
+		tonemapped.texels[i + 3] = 1.0f;
+	}
+	return tonemapped;
+}
+
+void LutBaker::sampleStrip(const LutStrip& strip, const float colour[3], float out[3]) {
+	int last = strip.getSlices() - 1;
+	float x = saturate(colour[0]) * last;
+	float y = (1.0f - saturate(colour[1])) * last;//green goes up from the bottom row
+	float z = saturate(colour[2]) * last;
+	int x0 = std::min(int(x), last - 1), y0 = std::min(int(y), last - 1), z0 = std::min(int(z), last - 1);
+	float fx = x - x0, fy = y - y0, fz = z - z0;
+
+	//bilinear within two neighbouring slices, then between them
+	for (int c = 0; c < 3; ++c) out[c] = 0;
+	for (int dz = 0; dz < 2; ++dz) {
+		for (int dy = 0; dy < 2; ++dy) {
+			for (int dx = 0; dx < 2; ++dx) {
+				float weight = (dx ? fx : 1 - fx) * (dy ? fy : 1 - fy) * (dz ? fz : 1 - fz);
+				const float* texel = &strip.texels[((y0 + dy) * strip.width + (z0 + dz) * strip.getSlices() + x0 + dx) * 4];
+				for (int c = 0; c < 3; ++c) out[c] += texel[c] * weight;
+			}
+		}
+	}
+}
+
+void LutBaker::lookup(const LutStrip& strip, const TonemappingParams& params, const float colour[3], float out[3]) {
+	sampleStrip(tonemapStrip(strip, params), colour, out);
+}
+
+void LutBaker::bake(const LutStrip& strip, const TonemappingParams& params, int size, std::vector<uint16_t>& out) {
+	PROFILE_SCOPE("Bake LUT");
+
+	//tonemap the strip's own texels, same as the gpu used to, so the 3D LUT goes through exactly the same points
+	LutStrip tonemapped = tonemapStrip(strip, params);
+
+	out.resize(size_t(size) * size * size * 4);
+	float step = 1.0f / (size - 1);
+	uint16_t* texel = out.data();
+	for (int b = 0; b < size; ++b) {
+		for (int g = 0; g < size; ++g) {
+			for (int r = 0; r < size; ++r) {
+				float colour[3] = { r * step, g * step, b * step }, graded[3];
+				sampleStrip(tonemapped, colour, graded);
+				for (int c = 0; c < 3; ++c) *texel++ = DirectX::PackedVector::XMConvertFloatToHalf(graded[c]);
+				*texel++ = DirectX::PackedVector::XMConvertFloatToHalf(1.0f);
+			}
+		}
+	}
+}
+
+GenerationTask LutBaker::asyncBake(LutStrip strip, TonemappingParams params, int size, std::vector<uint16_t>& out) {
+	std::vector<uint16_t> baked;//out only gets touched back on the main thread, in case the task's dropped while it's baking
+	co_await GenerationTask::resumeOnWorker();
+	bake(strip, params, size, baked);
+	co_await GenerationTask::resumeOnMainThread();
+	out.swap(baked);
+}
+
+#undef EPSILON
+#undef PI
+#undef HALF_MAX
+#undef ROOT_OF_3
+#undef CONTRAST_FACTOR
+#undef YC_RADIUS_WEIGHT
+#undef RRT_GLOW_GAIN
+#undef RRT_GLOW_MID
+#undef RRT_RED_HUE
+#undef RRT_RED_WIDTH
+#undef RRT_RED_PIVOT
+#undef RRT_RED_SCALE
+#undef RRT_SAT_FACTOR
+#undef CINEMA_WHITE
+#undef CINEMA_BLACK
+#undef DIM_SURROUND_GAMMA
+#undef ODT_SAT_FACTOR
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+/** Bakes the colour grading LUT on the cpu: the LUT strip (eg res/LUTs/Lut_blue.png, 16 slices of 16x16 side by side) goes through the tonemapping operator, then gets resampled into a 3D LUT
+	that colourgrading_fs reads with a single trilinear sample.
+	Nothing in here touches the gpu, so the result for any colour can be checked against lookup(), which tonemaps and interpolates the strip the slow way.
+	The tonemapping is the ACES RRT + ODT (100 nits monitor, dim surround), followed by brightness, hue, saturation, value and contrast.
+*/
+
+#include <vector>
+#include <cstdint>
+#include "GenerationTask.h"
+
+#define TONEMAP_NONE 0
+#define TONEMAP_ACES 1
+#define TONEMAP_NEUTRAL 2
+
+#define LUT_3D_SIZE 32
+
+struct TonemappingParams {
+	float tonemapping = TONEMAP_NONE;//0, 1, 2
+	float exposure = 1;//0..2
+	float brightness = 0;//-1..1
+	float contrast = 0;//-1..1
+	float hue = 0;//0..1
+	float saturation = 1;//0..1
+	float value = 1;//0..2
+};
+
+///A LUT strip as rgba floats, rows from top to bottom; a strip n texels high is made of n slices of n*n texels, blue going up from slice to slice and green from the bottom row to the top one
+struct LutStrip {
+	std::vector<float> texels;
+	int width = 0, height = 0;
+	inline int getSlices() const { return height; }
+	inline bool isValid() const { return height > 1 && width == height * height && texels.size() == size_t(width * height * 4); }
+};
+
+class LutBaker {
+
+public:
+	///Bakes strip through the tonemapping into a size^3 LUT, as RGBA16F texels (red along x, green along y, blue along z)
+	static void bake(const LutStrip& strip, const TonemappingParams& params, int size, std::vector<uint16_t>& out);
+	///Same as bake(), on a worker thread; strip is copied, and out only gets filled in once the task's finished
+	static GenerationTask asyncBake(LutStrip strip, TonemappingParams params, int size, std::vector<uint16_t>& out);
+
+	///Reference: what the LUT holds for a gamma space colour, tonemapping the strip's texels then interpolating them
+	static void lookup(const LutStrip& strip, const TonemappingParams& params, const float colour[3], float out[3]);
+	///What the tonemapping does to one colour
+	static void tonemap(const float colour[3], const TonemappingParams& params, float out[3]);
+
+private:
+	static LutStrip tonemapStrip(const LutStrip& strip, const TonemappingParams& params);
+	static void sampleStrip(const LutStrip& strip, const float colour[3], float out[3]);
+
+};
\ No newline at end of file
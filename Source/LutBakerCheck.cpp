@@ -0,0 +1,93 @@
+#include "LutBakerCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <DirectXPackedVector.h>
+
+#define STRIP_SLICES 4 //lookup() tonemaps the whole strip for every colour, so a small one keeps the check quick (it still gets resampled up to LUT_3D_SIZE)
+#define HALF_EPSILON (1.0f / 1024) //precision of a half float (10 bits of mantissa), relative to values above 1
+
+
+///A strip that maps every colour to itself
+static LutStrip identityStrip(int slices) {
+	LutStrip strip;
+	strip.width = slices * slices;
+	strip.height = slices;
+	strip.texels.resize(size_t(strip.width) * strip.height * 4);
+	float step = 1.0f / (slices - 1);
+	for (int y = 0; y < strip.height; ++y) {
+		for (int x = 0; x < strip.width; ++x) {
+			float* texel = &strip.texels[(size_t(y) * strip.width + x) * 4];
+			texel[0] = (x % slices) * step;
+			texel[1] = (slices - 1 - y) * step;//green goes up from the bottom row
+			texel[2] = (x / slices) * step;
+			texel[3] = 1;
+		}
+	}
+	return strip;
+}
+
+bool LutBakerCheck::check(const char* name, const LutStrip& strip, const TonemappingParams& params) {
+	const int size = LUT_3D_SIZE;
+	std::vector<uint16_t> baked;
+	LutBaker::bake(strip, params, size, baked);
+	if (baked.size() != size_t(size) * size * size * 4) {
+		printf("LutBaker check failed (%s): baked %d texels instead of %d.\n", name, int(baked.size() / 4), size * size * size);
+		return false;
+	}
+
+	//every lattice point against the reference, the same colour bake() went through
+	float step = 1.0f / (size - 1);
+	for (int b = 0; b < size; ++b) {
+		for (int g = 0; g < size; ++g) {
+			for (int r = 0; r < size; ++r) {
+				float colour[3] = { r * step, g * step, b * step }, reference[4];
+				LutBaker::lookup(strip, params, colour, reference);
+				reference[3] = 1;
+				const uint16_t* texel = &baked[(size_t(b * size + g) * size + r) * 4];
+				for (int c = 0; c < 4; ++c) {
+					float value = DirectX::PackedVector::XMConvertHalfToFloat(texel[c]);
+					if (std::fabs(value - reference[c]) > HALF_EPSILON * std::max(1.0f, std::fabs(reference[c]))) {
+						printf("LutBaker check failed (%s): texel (%d, %d, %d) channel %d is %f, should be %f.\n", name, r, g, b, c, value, reference[c]);
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	//the worker bakes exactly the same
+	std::vector<uint16_t> asyncBaked;
+	GenerationTask task = LutBaker::asyncBake(strip, params, size, asyncBaked);
+	while (!task.Continue()) std::this_thread::yield();
+	if (asyncBaked != baked) {
+		printf("LutBaker check failed (%s): asyncBake() doesn't match bake().\n", name);
+		return false;
+	}
+	return true;
+}
+
+bool LutBakerCheck::run() {
+	LutStrip strip = identityStrip(STRIP_SLICES);
+
+	TonemappingParams neutral;
+	neutral.tonemapping = TONEMAP_NEUTRAL;
+
+	TonemappingParams aces;//as set up in App::init
+	aces.tonemapping = TONEMAP_ACES;
+	aces.exposure = 1.441f;
+	aces.brightness = 0.159f;
+	aces.contrast = 0.169f;
+	aces.saturation = 0.718f;
+
+	bool passed = check("neutral", strip, neutral);
+	passed = check("ACES", strip, aces) && passed;
+
+	printf("LutBaker check %s.\n", passed ? "passed" : "failed");
+	return passed;
+}
+
+#undef STRIP_SLICES
+#undef HALF_EPSILON
\ No newline at end of file
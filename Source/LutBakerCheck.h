@@ -0,0 +1,19 @@
+#pragma once
+
+/** Checks the LUT LutBaker::bake() puts together against LutBaker::lookup(), the slow reference: every point of the lattice has to come out within what a half float can hold,
+	for the neutral tonemapping and the ACES one (with the grading App::init sets up), baking a small identity strip up to LUT_3D_SIZE. The same bake through asyncBake() has to match it exactly.
+	Run from App::init when VERIFY_LUT_BAKER is defined; prints out the first texel that's off for each set of params.
+*/
+
+#include "LutBaker.h"
+
+class LutBakerCheck {
+
+public:
+	///returns whether every baked texel matched the reference
+	static bool run();
+
+private:
+	static bool check(const char* name, const LutStrip& strip, const TonemappingParams& params);
+
+};
\ No newline at end of file
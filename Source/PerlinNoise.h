@@ -9,15 +9,18 @@ The PerlinNoise(unsigned int seed) function, not present in original implementat
 
 */
 
-#include <vector>
+#include <array>
+#include <algorithm>
 #include <numeric>
+#include <cstdint>
 #include <random>
+#include "Random.h"
 
 class PerlinNoise {
 public:
 
 	inline PerlinNoise() {
-		p = { 151,160,137,91,90,15,
+		static const uint8_t permutation[256] = { 151,160,137,91,90,15,
 			131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
 			190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
 			88,237,149,56,87,174,20,125,136,171,168, 68,175,74,165,71,134,139,48,27,166,
@@ -30,18 +33,31 @@ public:
 			251,34,242,193,238,210,144,12,191,179,162,241, 81,51,145,235,249,14,239,107,
 			49,192,214, 31,181,199,106,157,184, 84,204,176,115,121,50,45,127, 4,150,254,
 			138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180 };
-		//duplicate it
-		//for (int i = 0; i < 256; ++i) p.push_back(p[i]);
-		p.insert(p.end(), p.begin(), p.end());//<- better, from https://github.com/sol-prog/Perlin_Noise/blob/master/PerlinNoise.cpp
+		std::copy(permutation, permutation + 256, p.begin());
+		duplicate();
 	}
 
 	//Not present in original implementation. version with random permutation vector, from https://github.com/sol-prog/Perlin_Noise/blob/master/PerlinNoise.cpp
 	inline PerlinNoise(int seed) {
-		p.resize(256);
-		std::iota(p.begin(), p.end(), 0);//fill with values from 0 to 255
+		std::iota(p.begin(), p.begin() + 256, 0);//fill with values from 0 to 255
 		std::default_random_engine engine((unsigned int)seed);
-		std::shuffle(p.begin(), p.end(), engine);//shuffle it randomly
-		p.insert(p.end(), p.begin(), p.end());
+		std::shuffle(p.begin(), p.begin() + 256, engine);//shuffle it randomly
+		duplicate();
+	}
+
+	//Permutation vector shuffled using our own rng. In legacy mode this is the exact same as PerlinNoise(random()).
+	inline PerlinNoise(Random& random) {
+		std::iota(p.begin(), p.begin() + 256, 0);
+		if (random.isLegacy()) {
+			std::default_random_engine engine((unsigned int)random());
+			std::shuffle(p.begin(), p.begin() + 256, engine);
+		} else {
+			//plain Fisher-Yates, as std::shuffle's algorithm is up to the standard library
+			for (int i = 255; i > 0; --i) {
+				std::swap(p[i], p[random.nextInt(i + 1)]);
+			}
+		}
+		duplicate();
 	}
 
 	inline float noise(float x, float y, float z) {
@@ -59,8 +75,32 @@ public:
 		return lerp(w, lerp(v, lerp(u, grad(p[AA], x, y, z), grad(p[BA], x-1, y, z)), lerp(u, grad(p[AB], x, y-1, z), grad(p[BB], x-1, y-1, z))), lerp(v, lerp(u, grad(p[AA + 1], x, y, z - 1),	grad(p[BA + 1], x - 1, y, z - 1)), lerp(u, grad(p[AB + 1], x, y - 1, z - 1), grad(p[BB + 1], x - 1, y - 1, z - 1))));
 	}
 
+	///Adds noise(scale * x, y, 0) * range - range / 2 to each of row[0..count-1], with the exact same results but only working out what depends on y once,
+	///and skipping the z half of the noise altogether (at z = 0 it's weighted by fade(0) = 0)
+	inline void addRow(float* row, int count, float scale, float y, float range) {
+		int Y = (int)y & 255;
+		y -= (int)y;
+		float v = fade(y);
+		float half = range / 2;
+		for (int i = 0; i < count; ++i) {
+			float x = scale * i;
+			int X = (int)x & 255;
+			x -= (int)x;
+			float u = fade(x);
+			int A = p[X] + Y;
+			int B = p[X + 1] + Y;
+			float n = lerp(v, lerp(u, grad(p[p[A]], x, y), grad(p[p[B]], x - 1, y)), lerp(u, grad(p[p[A + 1]], x, y - 1), grad(p[p[B + 1]], x - 1, y - 1)));
+			row[i] += n * range - half;
+		}
+	}
+
 private:
 
+	///Second half of the table is the same as the first, so that p[X + 1] etc never need wrapping
+	inline void duplicate() {
+		std::copy(p.begin(), p.begin() + 256, p.begin() + 256);
+	}
+
 	inline float fade(float t) {
 		return t * t * t * (t * (t * 6 - 15) + 10);
 	}
@@ -77,6 +117,14 @@ private:
 
 	}
 
-	std::vector<int> p;//permutation vector
+	///grad() at z = 0
+	inline float grad(int hash, float x, float y) {
+		int h = hash & 15;
+		float u = h < 8 ? x : y,
+			v = h < 4 ? y : h == 12 || h == 14 ? x : 0;
+		return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
+	}
+
+	std::array<uint8_t, 512> p;//permutation table, small enough to stay in cache
 
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "PostProcessingPass.h"
 
 #include "AppGlobals.h"
+#include "RenderBackend.h"
 
 PostProcessingPass::~PostProcessingPass() {
 	if (renderTexture)
@@ -48,11 +49,12 @@ void PostProcessingPass::Render(D3D* renderer, ID3D11DeviceContext* deviceContex
 	if (!enabled) {
 		return;
 	}
+	GLOBALS.RenderBackend->invalidateState();//the ortho mesh and texture get bound straight through the context
 	renderer->setZBuffer(false);
 	orthoMesh->sendData(deviceContext);
 	shader->setShaderParameters(deviceContext, renderer->getWorldMatrix(), orthoViewMatrix, renderer->getOrthoMatrix(), XMFLOAT3(0,0,0));
 	shader->setTextureData(deviceContext, renderTexture->getShaderResourceView());
-	shader->render(deviceContext, orthoMesh->getIndexCount());
+	GLOBALS.RenderBackend->drawIndexed(shader, orthoMesh->getIndexCount());
 	renderer->setZBuffer(true);
 }
 
@@ -11,10 +11,9 @@ PostProcessingShader::~PostProcessingShader(){
 
 void PostProcessingShader::initBuffers() {
 
-	// Post-processing effects' sampler should clamp instead of wrap.
+	// Post-processing effects' sampler should clamp instead of wrap, and be plain bilinear (the bloom chain's taps rely on it to average neighbouring texels).
 	D3D11_SAMPLER_DESC samplerDesc;
-	samplerDesc.Filter = D3D11_FILTER_ANISOTROPIC;
-	samplerDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
+	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
 	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
 	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
 	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
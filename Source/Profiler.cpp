@@ -0,0 +1,145 @@
+#include "Profiler.h"
+
+#include <fstream>
+#include <algorithm>
+#include "DXF.h"
+
+#define TIMELINE_ROW_HEIGHT 18.f
+#define TIMELINE_MAX_DEPTH 8 //deeper scopes than this are not drawn
+
+
+Profiler::ThreadBuffer* Profiler::registerThread() {
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	ThreadBuffer* buffer = new ThreadBuffer;
+	buffer->index = threads.size();
+	threads.push_back(buffer);
+	return buffer;
+}
+
+bool Profiler::readEvent(const ThreadBuffer& thread, uint32_t index, Event& out) {
+	out = thread.events[index % RING_SIZE];
+	std::atomic_thread_fence(std::memory_order_acquire);//read the count after the event
+	return thread.written.load(std::memory_order_relaxed) - index < RING_SIZE;//the slot only gets reused for event index+RING_SIZE, once index+RING_SIZE events have been published
+}
+
+void Profiler::newFrame() {
+	frameStarts[frameCount % FRAMES_KEPT] = now();
+	++frameCount;
+	if (!paused) shownFrame = frameCount - 1;
+}
+
+///Quick and dirty colour for each event name, so that the same scope always gets the same colour
+static inline ImU32 colourFor(const char* name) {
+	uint32_t hash = 2166136261u;
+	for (const char* c = name; *c; ++c) {
+		hash ^= uint8_t(*c);
+		hash *= 16777619u;
+	}
+	return IM_COL32(80 + hash % 150, 80 + (hash >> 8) % 150, 80 + (hash >> 16) % 150, 255);
+}
+
+void Profiler::gui(bool* open) {
+	if (!ImGui::Begin("Profiler", open)) {
+		ImGui::End();
+		return;
+	}
+
+	ImGui::Checkbox("Pause", &paused);
+	ImGui::SameLine();
+	ImGui::SliderInt("Frames", &framesShown, 1, 8);
+	ImGui::SameLine();
+	if (ImGui::Button("Export Chrome trace")) {
+		exportChromeTrace("profiles/trace.json");
+	}
+
+	//the time range to show: the last full frames before shownFrame
+	if (shownFrame < uint32_t(framesShown) || frameCount - shownFrame >= FRAMES_KEPT - 8) {
+		if (frameCount - shownFrame >= FRAMES_KEPT - 8) paused = false;//the frames we were looking at are gone
+		ImGui::End();
+		return;
+	}
+	int64_t rangeStart = frameStarts[(shownFrame - framesShown) % FRAMES_KEPT];
+	int64_t rangeEnd = frameStarts[shownFrame % FRAMES_KEPT];
+	float rangeMillis = float(rangeEnd - rangeStart) / 1000.f;
+	ImGui::Text("%.2f ms over %d frame(s)", rangeMillis, framesShown);
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	float width = ImGui::GetContentRegionAvailWidth();
+
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	for (ThreadBuffer* thread : threads) {
+		ImGui::Text("Thread %d", thread->index);
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		int deepest = 0;
+
+		//go through the events from the latest one back; they're written in the order they end, so we can stop as soon as one ended before the range
+		uint32_t written = thread->written.load(std::memory_order_acquire);
+		uint32_t oldest = written > RING_SIZE - READ_MARGIN ? written - (RING_SIZE - READ_MARGIN) : 0;
+		for (uint32_t i = written; i > oldest; --i) {
+			Event event;
+			if (!readEvent(*thread, i - 1, event)) break;//caught up with by the thread, anything older is gone too
+			if (event.end < rangeStart) break;
+			if (event.start > rangeEnd || event.depth >= TIMELINE_MAX_DEPTH) continue;
+			deepest = std::max(deepest, event.depth + 1);
+
+			float x0 = origin.x + width * float(std::max(event.start, rangeStart) - rangeStart) / float(rangeEnd - rangeStart);
+			float x1 = origin.x + width * float(std::min(event.end, rangeEnd) - rangeStart) / float(rangeEnd - rangeStart);
+			x1 = std::max(x1, x0 + 1);//always at least a pixel wide
+			float y0 = origin.y + event.depth * TIMELINE_ROW_HEIGHT;
+			ImVec2 min(x0, y0), max(x1, y0 + TIMELINE_ROW_HEIGHT - 1);
+
+			drawList->AddRectFilled(min, max, colourFor(event.name));
+			if (x1 - x0 > ImGui::CalcTextSize(event.name).x + 4) {
+				drawList->AddText(ImVec2(x0 + 2, y0 + 2), IM_COL32_BLACK, event.name);
+			}
+			if (ImGui::IsMouseHoveringRect(min, max)) {
+				ImGui::SetTooltip("%s: %.3f ms", event.name, float(event.end - event.start) / 1000.f);
+			}
+		}
+
+		ImGui::Dummy(ImVec2(width, std::max(deepest, 1) * TIMELINE_ROW_HEIGHT));
+	}
+
+	ImGui::End();
+}
+
+bool Profiler::exportChromeTrace(const std::string& filename) {
+	//create directory if needed
+	size_t slash = filename.find_last_of('/');
+	if (slash != std::string::npos) {
+		CreateDirectory(filename.substr(0, slash).c_str(), NULL);
+	}
+
+	std::ofstream stream(filename, std::ios::out | std::ios::trunc);
+	if (!stream.is_open()) {
+		printf("File %s could not be opened for writing.\n", filename.c_str());
+		return false;
+	}
+
+	//see the "Trace Event Format" doc for the format; complete ("X") events are all we need
+	stream << "{\"traceEvents\":[\n";
+	bool first = true;
+	int count = 0;
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	for (ThreadBuffer* thread : threads) {
+		stream << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->index << ",\"args\":{\"name\":\"Thread " << thread->index << "\"}}";
+		first = false;
+
+		uint32_t written = thread->written.load(std::memory_order_acquire);
+		uint32_t oldest = written > RING_SIZE - READ_MARGIN ? written - (RING_SIZE - READ_MARGIN) : 0;
+		for (uint32_t i = oldest; i < written; ++i) {
+			Event event;
+			if (!readEvent(*thread, i, event)) continue;//overwritten while we were writing the others out
+			stream << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->index << ",\"ts\":" << event.start << ",\"dur\":" << (event.end - event.start) << "}";
+			++count;
+		}
+	}
+	stream << "\n]}\n";
+	stream.close();
+
+	printf("Wrote %d profiling events to %s\n", count, filename.c_str());
+	return true;
+}
+
+#undef TIMELINE_ROW_HEIGHT
+#undef TIMELINE_MAX_DEPTH
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+/** Lightweight CPU profiler.
+	PROFILE_SCOPE("name") records how long the enclosing scope took into a ring buffer owned by the calling thread (no locks, the owning thread is the only writer).
+	The last few frames can be looked at as a timeline in the ui, and whatever is still in the buffers can be exported as a Chrome trace (open it in chrome://tracing).
+	Comment out ENABLE_PROFILER to compile all the scopes out entirely.
+*/
+
+#define ENABLE_PROFILER
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name) //name must be a string literal, as only the pointer is kept
+#define PROFILE_FRAME() Profiler::Instance().newFrame()
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FRAME()
+#endif
+
+class Profiler {
+
+public:
+	struct Event {
+		const char* name;
+		int64_t start;//microseconds since the profiler was created
+		int64_t end;
+		int depth;//how many scopes this one is nested in
+	};
+
+	static const uint32_t RING_SIZE = 16384;//how many events are kept per thread
+	static const uint32_t READ_MARGIN = 1024;//oldest events left alone when reading the buffers, as their owning threads are about to overwrite them
+	static const uint32_t FRAMES_KEPT = 64;
+
+	struct ThreadBuffer {
+		Event events[RING_SIZE];
+		std::atomic<uint32_t> written{ 0 };//total amount of events ever written (the event at index written-1 is the latest one)
+		int depth = 0;//current nesting depth, only ever touched by the owning thread
+		int index = 0;//order in which the thread was first seen
+	};
+
+	inline static Profiler& Instance() {
+		static Profiler instance;//instanciated on first use
+		return instance;
+	}
+
+	Profiler(Profiler const&) = delete;
+	void operator=(Profiler const&) = delete;
+
+	inline int64_t now() const { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - origin).count(); }
+
+	///returns the calling thread's buffer, creating it the first time around
+	inline ThreadBuffer* threadBuffer() {
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (!buffer) buffer = registerThread();
+		return buffer;
+	}
+
+	void newFrame();//call at the start of each frame, from the main thread
+	void gui(bool* open);//shows the timeline window
+	bool exportChromeTrace(const std::string& filename);
+
+private:
+	inline Profiler() : origin(std::chrono::high_resolution_clock::now()) {}
+
+	ThreadBuffer* registerThread();
+	///Copies the index-th event the thread wrote; returns false if the thread has started overwriting it since, in which case out may be torn
+	static bool readEvent(const ThreadBuffer& thread, uint32_t index, Event& out);
+
+	std::chrono::high_resolution_clock::time_point origin;
+
+	std::mutex threadsMutex;//only taken when a thread registers itself, or when going through all the threads
+	std::vector<ThreadBuffer*> threads;//never freed, they live as long as the app does
+
+	int64_t frameStarts[FRAMES_KEPT] = {};
+	uint32_t frameCount = 0;
+
+	//ui state
+	bool paused = false;
+	int framesShown = 1;
+	uint32_t shownFrame = 0;//the last frame shown in the timeline (frozen when paused)
+
+};
+
+///Records the time between its construction and destruction; use through PROFILE_SCOPE.
+class ProfileScope {
+public:
+	inline ProfileScope(const char* name) : name(name), buffer(Profiler::Instance().threadBuffer()) {
+		depth = buffer->depth++;
+		start = Profiler::Instance().now();
+	}
+
+	inline ~ProfileScope() {
+		int64_t end = Profiler::Instance().now();
+		uint32_t written = buffer->written.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);//whoever sees any of the writes below also sees the last count published, so they can tell the slot is being overwritten (see Profiler::readEvent)
+		Profiler::Event& event = buffer->events[written % Profiler::RING_SIZE];
+		event.name = name;
+		event.start = start;
+		event.end = end;
+		event.depth = depth;
+		--buffer->depth;
+		buffer->written.store(written + 1, std::memory_order_release);//publish it
+	}
+
+private:
+	const char* name;
+	Profiler::ThreadBuffer* buffer;
+	int64_t start;
+	int depth;
+};
\ No newline at end of file
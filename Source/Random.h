@@ -0,0 +1,89 @@
+#pragma once
+
+/**
+
+Small counter-based random number generator used by all the procedural generators.
+
+Each value is SplitMix64's mixing function applied to (key + counter * golden ratio), so the sequences only depend on the seed and
+never on the compiler or standard library (unlike std::default_random_engine, which is minstd_rand0 on MSVC and something else on libstdc++).
+beginStream() re-keys the generator for an independent stream (a chunk, a generation pass...), and at() gives any value of the current stream
+without having to step through the ones before it, so different cells/passes can be evaluated independently.
+
+Legacy mode wraps std::default_random_engine and reproduces the exact sequences the generators used before this, so worlds saved back then can be regenerated.
+
+*/
+
+#include <random>
+#include <cstdint>
+#include <string>
+
+class Random {
+public:
+
+	inline Random(int seed = 0, bool legacy = false) : legacy(legacy), legacyEngine((unsigned int)seed) {
+		baseKey = key = mix(uint64_t(uint32_t(seed)));
+	}
+
+	///Switches to the stream identified by id; it only depends on the seed and id, not on whichever streams came before. No-op in legacy mode, where everything comes out of the one engine.
+	inline void beginStream(uint64_t id) {
+		if (legacy) return;
+		key = mix(baseKey ^ mix(id + GOLDEN_GAMMA));
+		counter = 0;
+	}
+
+	///Raw 32 bit value
+	inline uint32_t operator() () {
+		if (legacy) return uint32_t(legacyEngine());
+		return uint32_t(at(counter++) >> 32);
+	}
+
+	///The index-th 64 bit value of the current stream, without advancing it (not available in legacy mode)
+	inline uint64_t at(uint64_t index) const {
+		return mix(key + (index + 1) * GOLDEN_GAMMA);
+	}
+
+	///Integer within min..max-1. Unbiased, except in legacy mode which keeps the old modulo.
+	inline int nextInt(int max, int min = 0) {
+		uint32_t range = uint32_t(max - min);
+		if (legacy) return min + int((*this)() % range);
+		//Lemire's multiply-shift with rejection
+		uint64_t m = uint64_t((*this)()) * range;
+		uint32_t low = uint32_t(m);
+		if (low < range) {
+			uint32_t threshold = uint32_t(0u - range) % range;
+			while (low < threshold) {
+				m = uint64_t((*this)()) * range;
+				low = uint32_t(m);
+			}
+		}
+		return min + int(m >> 32);
+	}
+
+	///Float within 0..1 (excluded). Legacy mode only ever had legacyResolution different values, so keep that there.
+	inline float nextUnit(int legacyResolution) {
+		if (legacy) return float((*this)() % legacyResolution) / legacyResolution;
+		return float((*this)() >> 8) * (1.f / 16777216.f);//24 bits, ie as many as a float can hold
+	}
+
+	inline bool isLegacy() const { return legacy; }
+
+	///Short tag to tell apart files saved using either mode
+	inline std::string tag() const { return legacy ? "" : "c-"; }
+
+private:
+	static const uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ull;
+
+	///SplitMix64 finalizer
+	static inline uint64_t mix(uint64_t z) {
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	bool legacy;
+	uint64_t baseKey;//derived from the seed only
+	uint64_t key;//current stream's
+	uint64_t counter = 0;
+	std::default_random_engine legacyEngine;
+
+};
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include "RenderBackend.h"
+
+#include <cstring>
+#include "DXF.h"
+#include "Shader.h"
+
+//stands in for anything that might currently be bound, including null
+static const void* const UNKNOWN_STATE = reinterpret_cast<const void*>(~uintptr_t(0));
+
+
+void RenderBackend::invalidateState() {
+	for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+		for (const void*& slot : bound.constantBuffers[stage]) slot = UNKNOWN_STATE;
+		for (const void*& slot : bound.shaderResources[stage]) slot = UNKNOWN_STATE;
+		for (const void*& slot : bound.samplers[stage]) slot = UNKNOWN_STATE;
+	}
+	bound.vertexBuffer = UNKNOWN_STATE;
+	bound.indexBuffer = UNKNOWN_STATE;
+	bound.stride = 0;
+	bound.topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	bound.shader = UNKNOWN_STATE;
+}
+
+void RenderBackend::invalidateShader() {
+	bound.shader = UNKNOWN_STATE;
+}
+
+bool RenderBackend::alreadyBound(const void*& slot, const void* object) {
+	if (slot == object) {
+		++stats.bindsSaved;
+		return true;
+	}
+	slot = object;
+	++stats.stateChanges;
+	return false;
+}
+
+void RenderBackend::setConstantBuffer(Stage stage, int slot, ID3D11Buffer* buffer) {
+	if (slot < CACHED_CONSTANT_BUFFERS) {
+		if (alreadyBound(bound.constantBuffers[stage][slot], buffer)) return;
+	}
+	else ++stats.stateChanges;
+	doSetConstantBuffer(stage, slot, buffer);
+}
+
+void RenderBackend::setShaderResources(Stage stage, int slot, int count, ID3D11ShaderResourceView* const* views) {
+	if (slot + count <= CACHED_SHADER_RESOURCES) {
+		bool same = true;
+		for (int i = 0; i < count; ++i) {
+			same = same && bound.shaderResources[stage][slot + i] == views[i];
+		}
+		if (same) {
+			++stats.bindsSaved;
+			return;
+		}
+		for (int i = 0; i < count; ++i) {
+			bound.shaderResources[stage][slot + i] = views[i];
+		}
+	}
+	else if (slot < CACHED_SHADER_RESOURCES) {//partly cached; forget about those slots rather than track them
+		for (int i = slot; i < CACHED_SHADER_RESOURCES; ++i) {
+			bound.shaderResources[stage][i] = UNKNOWN_STATE;
+		}
+	}
+	++stats.stateChanges;
+	doSetShaderResources(stage, slot, count, views);
+}
+
+void RenderBackend::setSampler(Stage stage, int slot, ID3D11SamplerState* sampler) {
+	if (slot < CACHED_SAMPLERS) {
+		if (alreadyBound(bound.samplers[stage][slot], sampler)) return;
+	}
+	else ++stats.stateChanges;
+	doSetSampler(stage, slot, sampler);
+}
+
+void RenderBackend::setGeometry(ID3D11Buffer* vertexBuffer, unsigned int stride, ID3D11Buffer* indexBuffer, D3D_PRIMITIVE_TOPOLOGY topology) {
+	if (bound.vertexBuffer == vertexBuffer && bound.indexBuffer == indexBuffer && bound.stride == stride && bound.topology == topology) {
+		++stats.bindsSaved;
+		return;
+	}
+	bound.vertexBuffer = vertexBuffer;
+	bound.indexBuffer = indexBuffer;
+	bound.stride = stride;
+	bound.topology = topology;
+	++stats.stateChanges;
+	doSetGeometry(vertexBuffer, stride, indexBuffer, topology);
+}
+
+void RenderBackend::drawIndexed(BaseShader* shader, int indexCount) {
+	++stats.draws;
+	stats.indices += indexCount;
+	bool shaderBound = alreadyBound(bound.shader, shader);
+	doDrawIndexed(shader, indexCount, shaderBound);
+}
+
+
+
+D3D11RenderBackend::D3D11RenderBackend(ID3D11DeviceContext* deviceContext) : deviceContext(deviceContext) {
+}
+
+void D3D11RenderBackend::doUpdateConstantBuffer(ID3D11Buffer* buffer, const void* data, size_t bytes) {
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	HRESULT result = deviceContext->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	if (result != S_OK) {
+		printf("Could not map constant buffer: ");
+		Shader::printError(result);
+		return;
+	}
+	memcpy(mapped.pData, data, bytes);
+	deviceContext->Unmap(buffer, 0);
+}
+
+void* D3D11RenderBackend::doMapDiscard(ID3D11Buffer* buffer, size_t bytes) {
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	HRESULT result = deviceContext->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	if (result != S_OK) {
+		printf("Could not map buffer: ");
+		Shader::printError(result);
+		return nullptr;
+	}
+	return mapped.pData;
+}
+
+void D3D11RenderBackend::doUnmap(ID3D11Buffer* buffer) {
+	deviceContext->Unmap(buffer, 0);
+}
+
+void D3D11RenderBackend::doSetConstantBuffer(Stage stage, int slot, ID3D11Buffer* buffer) {
+	switch (stage) {
+	case VS: deviceContext->VSSetConstantBuffers(slot, 1, &buffer); break;
+	case HS: deviceContext->HSSetConstantBuffers(slot, 1, &buffer); break;
+	case DS: deviceContext->DSSetConstantBuffers(slot, 1, &buffer); break;
+	case GS: deviceContext->GSSetConstantBuffers(slot, 1, &buffer); break;
+	case PS: deviceContext->PSSetConstantBuffers(slot, 1, &buffer); break;
+	default: break;
+	}
+}
+
+void D3D11RenderBackend::doSetShaderResources(Stage stage, int slot, int count, ID3D11ShaderResourceView* const* views) {
+	switch (stage) {
+	case VS: deviceContext->VSSetShaderResources(slot, count, views); break;
+	case HS: deviceContext->HSSetShaderResources(slot, count, views); break;
+	case DS: deviceContext->DSSetShaderResources(slot, count, views); break;
+	case GS: deviceContext->GSSetShaderResources(slot, count, views); break;
+	case PS: deviceContext->PSSetShaderResources(slot, count, views); break;
+	default: break;
+	}
+}
+
+void D3D11RenderBackend::doSetSampler(Stage stage, int slot, ID3D11SamplerState* sampler) {
+	switch (stage) {
+	case VS: deviceContext->VSSetSamplers(slot, 1, &sampler); break;
+	case HS: deviceContext->HSSetSamplers(slot, 1, &sampler); break;
+	case DS: deviceContext->DSSetSamplers(slot, 1, &sampler); break;
+	case GS: deviceContext->GSSetSamplers(slot, 1, &sampler); break;
+	case PS: deviceContext->PSSetSamplers(slot, 1, &sampler); break;
+	default: break;
+	}
+}
+
+void D3D11RenderBackend::doSetGeometry(ID3D11Buffer* vertexBuffer, unsigned int stride, ID3D11Buffer* indexBuffer, D3D_PRIMITIVE_TOPOLOGY topology) {
+	unsigned int offset = 0;
+	deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	deviceContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	deviceContext->IASetPrimitiveTopology(topology);
+}
+
+void D3D11RenderBackend::doDrawIndexed(BaseShader* shader, int indexCount, bool shaderBound) {
+	if (shaderBound)
+		deviceContext->DrawIndexed(indexCount, 0, 0);
+	else
+		shader->render(deviceContext, indexCount);//sets the shader stages and layout, then draws
+}
+
+
+
+void NullRenderBackend::onBeginFrame() {
+	commands.clear();
+}
+
+void NullRenderBackend::doUpdateConstantBuffer(ID3D11Buffer* buffer, const void* data, size_t bytes) {
+	commands.push_back(Command{ UPDATE_CONSTANT_BUFFER, VS, 0, bytes, buffer });
+}
+
+void* NullRenderBackend::doMapDiscard(ID3D11Buffer* buffer, size_t bytes) {
+	commands.push_back(Command{ UPLOAD_BUFFER, VS, 0, bytes, buffer });
+	if (scratch.size() < bytes) scratch.resize(bytes);
+	return scratch.data();
+}
+
+void NullRenderBackend::doUnmap(ID3D11Buffer* buffer) {
+}
+
+void NullRenderBackend::doSetConstantBuffer(Stage stage, int slot, ID3D11Buffer* buffer) {
+	commands.push_back(Command{ SET_CONSTANT_BUFFER, stage, slot, 1, buffer });
+}
+
+void NullRenderBackend::doSetShaderResources(Stage stage, int slot, int count, ID3D11ShaderResourceView* const* views) {
+	commands.push_back(Command{ SET_SHADER_RESOURCES, stage, slot, size_t(count), count > 0 ? views[0] : nullptr });
+}
+
+void NullRenderBackend::doSetSampler(Stage stage, int slot, ID3D11SamplerState* sampler) {
+	commands.push_back(Command{ SET_SAMPLER, stage, slot, 1, sampler });
+}
+
+void NullRenderBackend::doSetGeometry(ID3D11Buffer* vertexBuffer, unsigned int stride, ID3D11Buffer* indexBuffer, D3D_PRIMITIVE_TOPOLOGY topology) {
+	commands.push_back(Command{ SET_GEOMETRY, VS, 0, stride, vertexBuffer });
+}
+
+void NullRenderBackend::doDrawIndexed(BaseShader* shader, int indexCount, bool shaderBound) {
+	commands.push_back(Command{ DRAW_INDEXED, VS, 0, size_t(indexCount), shader });
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+#pragma once
+
+/** Thin layer between the draw submission code (terrain, ruins, lit shaders, post processing) and the device context.
+	Everything that gets submitted is counted on the way (draws, state changes, constant buffer and buffer upload bytes), so the per-frame cost of the submission logic can be looked at and budgeted.
+	D3D11RenderBackend sends everything on to the device context; NullRenderBackend sends nothing anywhere and only keeps a log of the commands, so submission can be exercised without a gpu (see SubmissionCheck).
+	Resource creation still goes straight through the device, as it isn't part of the per-frame work.
+	The backend also remembers what it has bound (shaders, constant buffers, shader resources, samplers and geometry) and leaves out binding the same thing again.
+	Anything binding state straight through the device context, or switching render targets (which unbinds their shader resource views), must call invalidateState() before submitting through the backend again.
+*/
+
+#include <d3d11.h>
+#include <vector>
+#include <cstdint>
+
+class BaseShader;
+
+struct RenderStats {
+	int draws = 0;
+	int indices = 0;
+	int stateChanges = 0;//shaders, constant buffers, shader resources, samplers and geometry bound
+	int bindsSaved = 0;//binds left out as the same thing was already bound
+	int constantBufferUpdates = 0;
+	size_t constantBufferBytes = 0;
+	int constantBufferSkips = 0;//updates left out as the buffer already held the same contents (see CachedConstantBuffer)
+	int bufferUploads = 0;//vertex data etc written through mapDiscard()
+	size_t bufferUploadBytes = 0;
+};
+
+class RenderBackend {
+
+public:
+	enum Stage { VS, HS, DS, GS, PS, STAGE_COUNT };
+
+	RenderBackend() { invalidateState(); }
+	virtual ~RenderBackend() {}
+
+	///Starts counting a new frame
+	inline void beginFrame() { lastFrame = stats; stats = RenderStats(); invalidateState(); onBeginFrame(); }
+	///Forgets what's bound, so the next binds all go through
+	void invalidateState();
+	///Forgets which shader is bound, so the next draw sets its stages again (eg after it swapped one of them for a variant)
+	void invalidateShader();
+	///Totals for the last full frame
+	inline const RenderStats& getLastFrame() const { return lastFrame; }
+
+	inline void updateConstantBuffer(ID3D11Buffer* buffer, const void* data, size_t bytes) {
+		++stats.constantBufferUpdates;
+		stats.constantBufferBytes += bytes;
+		doUpdateConstantBuffer(buffer, data, bytes);
+	}
+	inline void skipConstantBufferUpdate() { ++stats.constantBufferSkips; }
+	///Maps a dynamic buffer for bytes worth of writing, discarding its previous contents; returns null on failure. Always unmap() it afterwards.
+	inline void* mapDiscard(ID3D11Buffer* buffer, size_t bytes) {
+		++stats.bufferUploads;
+		stats.bufferUploadBytes += bytes;
+		return doMapDiscard(buffer, bytes);
+	}
+	inline void unmap(ID3D11Buffer* buffer) { doUnmap(buffer); }
+
+	void setConstantBuffer(Stage stage, int slot, ID3D11Buffer* buffer);
+	void setShaderResources(Stage stage, int slot, int count, ID3D11ShaderResourceView* const* views);
+	void setSampler(Stage stage, int slot, ID3D11SamplerState* sampler);
+	void setGeometry(ID3D11Buffer* vertexBuffer, unsigned int stride, ID3D11Buffer* indexBuffer, D3D_PRIMITIVE_TOPOLOGY topology);
+	///Binds the shader's stages (unless they already are) and draws indexCount indices of the current geometry
+	void drawIndexed(BaseShader* shader, int indexCount);
+
+protected:
+	virtual void onBeginFrame() {}
+	virtual void doUpdateConstantBuffer(ID3D11Buffer* buffer, const void* data, size_t bytes) = 0;
+	virtual void* doMapDiscard(ID3D11Buffer* buffer, size_t bytes) = 0;
+	virtual void doUnmap(ID3D11Buffer* buffer) = 0;
+	virtual void doSetConstantBuffer(Stage stage, int slot, ID3D11Buffer* buffer) = 0;
+	virtual void doSetShaderResources(Stage stage, int slot, int count, ID3D11ShaderResourceView* const* views) = 0;
+	virtual void doSetSampler(Stage stage, int slot, ID3D11SamplerState* sampler) = 0;
+	virtual void doSetGeometry(ID3D11Buffer* vertexBuffer, unsigned int stride, ID3D11Buffer* indexBuffer, D3D_PRIMITIVE_TOPOLOGY topology) = 0;
+	virtual void doDrawIndexed(BaseShader* shader, int indexCount, bool shaderBound) = 0;//shaderBound: the shader's stages are still bound from the previous draw
+
+	RenderStats stats;//frame being recorded
+	RenderStats lastFrame;
+
+private:
+	///What's bound as far as the backend knows; slots past these are always bound
+	static const int CACHED_CONSTANT_BUFFERS = 8;
+	static const int CACHED_SHADER_RESOURCES = 32;
+	static const int CACHED_SAMPLERS = 8;
+	struct BoundState {
+		const void* constantBuffers[STAGE_COUNT][CACHED_CONSTANT_BUFFERS];
+		const void* shaderResources[STAGE_COUNT][CACHED_SHADER_RESOURCES];
+		const void* samplers[STAGE_COUNT][CACHED_SAMPLERS];
+		const void* vertexBuffer;
+		const void* indexBuffer;
+		unsigned int stride;
+		D3D_PRIMITIVE_TOPOLOGY topology;
+		const void* shader;
+	} bound;
+
+	///Whether the slot already holds object; otherwise records that it will
+	bool alreadyBound(const void*& slot, const void* object);
+
+};
+
+///Submits everything to the immediate context.
+class D3D11RenderBackend : public RenderBackend {
+public:
+	D3D11RenderBackend(ID3D11DeviceContext* deviceContext);
+
+protected:
+	void doUpdateConstantBuffer(ID3D11Buffer* buffer, const void* data, size_t bytes) override;
+	void* doMapDiscard(ID3D11Buffer* buffer, size_t bytes) override;
+	void doUnmap(ID3D11Buffer* buffer) override;
+	void doSetConstantBuffer(Stage stage, int slot, ID3D11Buffer* buffer) override;
+	void doSetShaderResources(Stage stage, int slot, int count, ID3D11ShaderResourceView* const* views) override;
+	void doSetSampler(Stage stage, int slot, ID3D11SamplerState* sampler) override;
+	void doSetGeometry(ID3D11Buffer* vertexBuffer, unsigned int stride, ID3D11Buffer* indexBuffer, D3D_PRIMITIVE_TOPOLOGY topology) override;
+	void doDrawIndexed(BaseShader* shader, int indexCount, bool shaderBound) override;
+
+private:
+	ID3D11DeviceContext* deviceContext;
+};
+
+///Submits nothing; keeps a log of this frame's commands instead.
+class NullRenderBackend : public RenderBackend {
+public:
+	enum CommandType { UPDATE_CONSTANT_BUFFER, UPLOAD_BUFFER, SET_CONSTANT_BUFFER, SET_SHADER_RESOURCES, SET_SAMPLER, SET_GEOMETRY, DRAW_INDEXED };
+	struct Command {
+		CommandType type;
+		Stage stage;
+		int slot;
+		size_t count;//bytes for updates and uploads, views for shader resources, indices for draws
+		const void* object;//the buffer, sampler, shader... involved (only meant for telling them apart)
+	};
+
+	inline const std::vector<Command>& getCommands() const { return commands; }
+
+protected:
+	void onBeginFrame() override;
+	void doUpdateConstantBuffer(ID3D11Buffer* buffer, const void* data, size_t bytes) override;
+	void* doMapDiscard(ID3D11Buffer* buffer, size_t bytes) override;
+	void doUnmap(ID3D11Buffer* buffer) override;
+	void doSetConstantBuffer(Stage stage, int slot, ID3D11Buffer* buffer) override;
+	void doSetShaderResources(Stage stage, int slot, int count, ID3D11ShaderResourceView* const* views) override;
+	void doSetSampler(Stage stage, int slot, ID3D11SamplerState* sampler) override;
+	void doSetGeometry(ID3D11Buffer* vertexBuffer, unsigned int stride, ID3D11Buffer* indexBuffer, D3D_PRIMITIVE_TOPOLOGY topology) override;
+	void doDrawIndexed(BaseShader* shader, int indexCount, bool shaderBound) override;
+
+private:
+	std::vector<Command> commands;
+	std::vector<uint8_t> scratch;//what mapDiscard() hands out, so the data can still be written
+};
\ No newline at end of file
@@ -1,10 +1,11 @@
 #include "RuinBlockMesh.h"
 
 #include "AppGlobals.h"
+#include "RenderBackend.h"
 #include "Utils.h"
 
 
-RuinBlockMesh::RuinBlockMesh(std::default_random_engine* randomEngine) : randomEngine(randomEngine){
+RuinBlockMesh::RuinBlockMesh(Random* random, const RuinBlockParameters& parameters) : random(random), parameters(parameters) {
 	initBuffers(GLOBALS.Device);
 }
 
@@ -28,8 +29,7 @@ void RuinBlockMesh::split12(std::vector<VertexType_Tangent>* vertices, std::vect
 }
 
 float RuinBlockMesh::rnd(float min, float max) {
-	float rand = float((*randomEngine)() % 1000) / 1000.0f;
-	return min + (max - min) * rand;
+	return min + (max - min) * random->nextUnit(1000);
 }
 
 
@@ -432,11 +432,11 @@ void RuinBlockMesh::combine(std::vector<VertexType_Tangent>* destination, std::v
 
 void RuinBlockMesh::initBuffers(ID3D11Device * device){
 
-	if (rnd(0, 1) < 0.75f) {
+	if (rnd(0, 1) < parameters.slabChance) {
 		//Stone cube/slab.
 
 		addCube(&vertices, &indices, XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1), true);
-		XMFLOAT3 scale = XMFLOAT3(1.4f, rnd(1, 3), 1.4f);
+		XMFLOAT3 scale = XMFLOAT3(parameters.slabWidth, rnd(parameters.slabMinHeight, parameters.slabMaxHeight), parameters.slabWidth);
 		scaleVerts(&vertices, scale);
 		split12(&vertices, &indices, XMFLOAT3(scale.x*0.5f - 0.05f, scale.y*0.5f - 0.05f, scale.z*0.5f - 0.05f));//cut up the edges
 		translateVerts(&vertices, XMFLOAT3(0, scale.y*0.5f - 0.1f, 0));
@@ -445,7 +445,7 @@ void RuinBlockMesh::initBuffers(ID3D11Device * device){
 		XMFLOAT3 planePt, planeNorm;
 		getRandomSplittingPlane(&vertices, planePt, planeNorm);
 		splitMesh(&vertices, &indices, planePt, planeNorm);
-		if (rnd(0, 1) < 0.5f && vertices.size() > 0) {
+		if (rnd(0, 1) < parameters.slabSecondCutChance && vertices.size() > 0) {
 			getRandomSplittingPlane(&vertices, planePt, planeNorm);
 			splitMesh(&vertices, &indices, planePt, planeNorm);
 		}
@@ -468,11 +468,11 @@ void RuinBlockMesh::initBuffers(ID3D11Device * device){
 		getBoundingBox(&cube2, aabbMin.x, aabbMax.x, aabbMin.y, aabbMax.y, aabbMin.z, aabbMax.z, false);
 
 		//the actual column cylinder
-		addCylinder(&vertices, &indices, XMFLOAT3(0, 1.95f, 0), XMFLOAT3(0.7f, 4.f, 0.7f), 20);
+		addCylinder(&vertices, &indices, XMFLOAT3(0, 1.95f, 0), XMFLOAT3(0.7f, 4.f, 0.7f), parameters.columnResolution);
 		getBoundingBox(&vertices, aabbMin.x, aabbMax.x, aabbMin.y, aabbMax.y, aabbMin.z, aabbMax.z, false);
 
 		//split the 3 meshes once along a random plane
-		if (rnd(0, 1) < 0.75f) {
+		if (rnd(0, 1) < parameters.columnCutChance) {
 			XMFLOAT3 planePt, planeNorm;
 			getRandomSplittingPlane(planePt, planeNorm, aabbMin, aabbMax);
 			splitMesh(&cube1, &cube1Indices, planePt, planeNorm);
@@ -504,16 +504,7 @@ void RuinBlockMesh::initBuffers(ID3D11Device * device){
 }
 
 void RuinBlockMesh::sendData(ID3D11DeviceContext * deviceContext, D3D_PRIMITIVE_TOPOLOGY top){
-	unsigned int stride;
-	unsigned int offset;
-
-	// Set vertex buffer stride and offset.
-	stride = sizeof(VertexType_Tangent);
-	offset = 0;
-
-	deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	deviceContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
-	deviceContext->IASetPrimitiveTopology(top);
+	GLOBALS.RenderBackend->setGeometry(vertexBuffer, sizeof(VertexType_Tangent), indexBuffer, top);
 }
 
 // I/O functions
@@ -588,4 +579,74 @@ RuinBlockMesh::RuinBlockMesh(int TEST) {
 	indices.push_back(0);
 	indices.push_back(1);
 	indices.push_back(2);
+}
+
+
+// Ruin block library
+
+RuinBlockLibrary::RuinBlockLibrary(int amount, int seed, const RuinBlockParameters& parameters) : seed(seed), parameters(parameters) {
+	bool legacy = GLOBALS.LegacyRandom;
+	key = cacheKey(seed, legacy, parameters);
+
+	//in legacy mode all the blocks come out of one engine, in order, so we need to regenerate everything up to the last block that's missing
+	int lastMissing = -1;
+	if (legacy) {
+		for (int i = 0; i < amount; ++i) {
+			if (!FileSystem::fileExists(blockFilename(i))) lastMissing = i;
+		}
+	}
+	Random legacyRandom(seed, true);
+
+	for (int i = 0; i < amount; ++i) {
+		std::string filename = blockFilename(i);
+		if (legacy ? i > lastMissing : FileSystem::fileExists(filename)) {
+			//read from disk instead of generating.
+			FileReader r(filename);
+			meshes.push_back(new RuinBlockMesh(r));
+		} else {
+			//generate from scratch; each block gets its own stream so that any one of them can be regenerated on its own and still end up the same given the same seed
+			Random random(seed);
+			random.beginStream(i);
+			meshes.push_back(new RuinBlockMesh(legacy ? &legacyRandom : &random, parameters));
+			FileWriter w(filename);
+			meshes[i]->write(w);//write the block out to disk to speed up next time we use the same seed
+		}
+	}
+}
+
+RuinBlockLibrary::~RuinBlockLibrary() {//free up everything
+	for (auto it = meshes.begin(); it != meshes.end();) {
+		delete (*it);
+		it = meshes.erase(it);
+	}
+}
+
+std::string RuinBlockLibrary::blockFilename(int index) {
+	char keyString[9];
+	sprintf_s(keyString, "%08x", key);
+	return "saved/blocks-" + std::string(keyString) + "-" + std::to_string(index);
+}
+
+uint32_t RuinBlockLibrary::cacheKey(int seed, bool legacyRandom, const RuinBlockParameters& parameters) {
+	//FNV-1a over everything that affects what a block looks like
+	uint32_t hash = 2166136261u;
+	auto mix = [&hash](const void* data, size_t size) {
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= bytes[i];
+			hash *= 16777619u;
+		}
+	};
+	int version = RUIN_BLOCK_GENERATOR_VERSION;
+	mix(&version, sizeof(version));
+	mix(&seed, sizeof(seed));
+	mix(&legacyRandom, sizeof(legacyRandom));
+	mix(&parameters.slabChance, sizeof(float));
+	mix(&parameters.slabWidth, sizeof(float));
+	mix(&parameters.slabMinHeight, sizeof(float));
+	mix(&parameters.slabMaxHeight, sizeof(float));
+	mix(&parameters.slabSecondCutChance, sizeof(float));
+	mix(&parameters.columnCutChance, sizeof(float));
+	mix(&parameters.columnResolution, sizeof(int));
+	return hash;
 }
\ No newline at end of file
@@ -3,11 +3,24 @@
 #include "DXF.h"
 #include "LitShader.h"
 #include <vector>
-#include <random>
+#include "Random.h"
 #include "FileSystem.h"
 #include "FileReader.h"
 #include "FileWriter.h"
 
+#define RUIN_BLOCK_GENERATOR_VERSION 2 //bump whenever RuinBlockMesh::initBuffers changes the shapes it produces, so that stale cached blocks are ignored
+
+//the tunables used when generating ruin blocks; all of these are part of the block cache key
+struct RuinBlockParameters {
+	float slabChance = 0.75f;//chance of a block being a slab rather than a column
+	float slabWidth = 1.4f;
+	float slabMinHeight = 1.f;
+	float slabMaxHeight = 3.f;
+	float slabSecondCutChance = 0.5f;//chance of cutting a slab along a second random plane
+	float columnCutChance = 0.75f;
+	int columnResolution = 20;
+};
+
 class RuinBlockMesh : public BaseMesh {
 
 	///Vertex struct for geometry with position, texture, normals and tangents
@@ -19,7 +32,7 @@ class RuinBlockMesh : public BaseMesh {
 	};
 
 public:
-	RuinBlockMesh(std::default_random_engine* randomEngine);
+	RuinBlockMesh(Random* random, const RuinBlockParameters& parameters = RuinBlockParameters());
 	~RuinBlockMesh();
 
 	void sendData(ID3D11DeviceContext* deviceContext, D3D_PRIMITIVE_TOPOLOGY top = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST) override;
@@ -64,7 +77,8 @@ protected:
 
 	float rnd(float min, float max);
 
-	std::default_random_engine* randomEngine;
+	Random* random;
+	RuinBlockParameters parameters;
 
 	//vertex and index buffers
 	std::vector<VertexType_Tangent> vertices;
@@ -72,36 +86,13 @@ protected:
 };
 
 //a helper class allowing to generate a few block meshes once, then grab then out from the library when needed
+// Each block is cached on disk on its own, under a key made of the seed, rng mode, generator version and parameters,
+// so growing the library only generates the blocks that aren't on disk yet.
 class RuinBlockLibrary {
 
 public:
-	inline RuinBlockLibrary(int amount, int seed) : seed(seed) {//generate a certain amount of meshes
-		if (FileSystem::fileExists("saved/blocks-" + std::to_string(seed))) {
-			//read from disk instead of generating.
-			FileReader r("saved/blocks-" + std::to_string(seed));
-			int totalSize = r()->size();
-			while (r--) {
-				meshes.push_back(new RuinBlockMesh(r));
-			}
-		} else {
-
-			//generate from scratch
-			FileWriter w("saved/blocks-" + std::to_string(seed));
-			std::default_random_engine randomEngine(seed);//use one random engine for all those meshes so that they're all different but end up the same when given the same initial seed
-			for (int i = 0; i < amount; ++i) {
-				meshes.push_back(new RuinBlockMesh(&randomEngine));
-				meshes[i]->write(w);//write the blocks library out to disk to speed up next time we use the same seed
-			}
-
-		}
-	}
-
-	inline ~RuinBlockLibrary() {//free up everything
-		for (auto it = meshes.begin(); it != meshes.end();) {
-			delete (*it);
-			it = meshes.erase(it);
-		}
-	}
+	RuinBlockLibrary(int amount, int seed, const RuinBlockParameters& parameters = RuinBlockParameters());//generate (or load) a certain amount of meshes
+	~RuinBlockLibrary();
 
 	inline RuinBlockMesh* grab(int index) {//given any random index, returns a mesh (even if the index is way beyond the amount we have, as we use a mod)
 		return meshes[index % meshes.size()];
@@ -110,7 +101,12 @@ public:
 	inline int size() { return meshes.size(); }
 
 protected:
+	std::string blockFilename(int index);
+	static uint32_t cacheKey(int seed, bool legacyRandom, const RuinBlockParameters& parameters);
+
 	std::vector<RuinBlockMesh*> meshes;
 	int seed;
+	RuinBlockParameters parameters;
+	uint32_t key;
 
 };
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "RuinsBlock.h"
 
+#include "AppGlobals.h"
+#include "RenderBackend.h"
+
 RuinsBlock::RuinsBlock(XMFLOAT3 position, XMFLOAT3 rotation, RuinBlockMesh* mesh) : position(position), rotation(rotation), mesh(mesh) {
 
 }
@@ -10,6 +13,6 @@ void RuinsBlock::render(LitShader* shader, Material* material, D3D* renderer, XM
 	mesh->sendData(renderer->getDeviceContext());							// unfortunately we need to perform yaw rotation last so cant use the handy XMMatrixRotationRollPitchYaw :'(
 	shader->setShaderParameters(renderer->getDeviceContext(), XMMatrixRotationY(rotation.y) * XMMatrixRotationX(rotation.x) * XMMatrixRotationZ(rotation.z) * XMMatrixTranslation(position.x, position.y, position.z) * worldMatrix, viewMatrix, projectionMatrix, cameraPosition);
 	//shader->setMaterialParameters(renderer->getDeviceContext(), sandTex, sandNormalsTex, NULL, material);
-	shader->render(renderer->getDeviceContext(), mesh->getIndexCount());
+	GLOBALS.RenderBackend->drawIndexed(shader, mesh->getIndexCount());
 
 }
\ No newline at end of file
@@ -9,6 +9,7 @@ public:
 
 	inline void setPosition(XMFLOAT3 pos) { position = pos; }
 	inline void setRotation(XMFLOAT3 rot) { rotation = rot; }
+	inline const RuinBlockMesh* getMesh() const { return mesh; }
 
 	void render(LitShader* shader, Material* material, D3D* renderer, XMMATRIX& worldMatrix, XMMATRIX& viewMatrix, XMMATRIX& projectionMatrix, XMFLOAT3 cameraPosition);
 
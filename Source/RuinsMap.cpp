@@ -1,10 +1,14 @@
 #include "RuinsMap.h"
 
+#include <algorithm>
+#include <functional>
 #include "Shader.h"
-#include <chrono>
+#include "AppGlobals.h"
+#include "Profiler.h"
+#include "GenerationScheduler.h"
 
-RuinsMap::RuinsMap(int seed, int size, std::function<float(int, int)> slopeFunction, std::function<float(int, int)> heightFunction, RuinBlockLibrary* blockLibrary) : 
-			seed(seed), size(size), slopeFunction(slopeFunction), heightFunction(heightFunction), blockLibrary(blockLibrary) {
+RuinsMap::RuinsMap(int seed, int size, TerrainField cellSlopes, TerrainField heights, RuinBlockLibrary* blockLibrary) : 
+			seed(seed), size(size), cellSlopes(cellSlopes), heights(heights), blockLibrary(blockLibrary) {
 	
 	generate();
 }
@@ -14,7 +18,7 @@ RuinsMap::~RuinsMap() {
 }
 
 void RuinsMap::placeKernel(int baseX, int baseY) {
-	int kernelSize = randomEngine() % 8 + 3;//room size, within 3..10
+	int kernelSize = random.nextInt(11, 3);//room size, within 3..10
 
 	//place the kernel as a mask
 	for (int y = 0; y < kernelSize; ++y) {
@@ -33,7 +37,7 @@ void RuinsMap::generate() {
 
 	release();//start over in case we need to
 
-	randomEngine = std::default_random_engine(seed + 1);//always use a slightly different seed than whoever called us to get different values (but always the same with the same seed)
+	random = Random(seed + 1, GLOBALS.LegacyRandom);//always use a slightly different seed than whoever called us to get different values (but always the same with the same seed)
 	map = new bool*[size];
 	for (int y = 0; y < size; ++y) {
 		map[y] = new bool[size];
@@ -42,26 +46,25 @@ void RuinsMap::generate() {
 		}
 	}
 
-	currentOperation = new RuinsEnumerator(asyncGeneration());//start the async generation
+	currentOperation.reset(new GenerationTask(asyncGeneration(cancellation)));//start the async generation
 
 	hasChanged = true;
 }
 
-bool RuinsMap::update(bool redo) {
+bool RuinsMap::update(bool redo, bool carryOn) {
 
 	if (redo) {//start over..
 		generate();
 	}
 
-	if (currentOperation) {//we're currently working on something
+	if (currentOperation && (!carryOn || !GenerationScheduler::Instance().hasTime())) {//not now, carry on next time
+		hasChanged = false;
+	}
+	else if (currentOperation) {//we're currently working on something
+		PROFILE_SCOPE("Ruins slice");
 		hasChanged = true;
-		if (!currentOperation->IsFinished()) {
-			currentOperation->Continue();//keep going
-		}
-		else {//move on to the next operation
-			RuinsEnumerator* next = currentOperation->NextOperation();
-			delete currentOperation;
-			currentOperation = next;//note that in this case we're supporting moving on to the next but since in practice we don't use this, no need to bloat the code up with the kind of things we do in Heightmap::update() :)
+		if (currentOperation->Continue()) {//keep going
+			currentOperation.reset();//all done
 		}
 	}
 	else {//no more operations
@@ -141,6 +144,11 @@ void RuinsMap::renderRuins(LitShader* shader, Material* material, D3D* renderer,
 }
 
 void RuinsMap::release(){
+	//stop generating first; this frees the coroutine frame along with it
+	cancellation.cancel();
+	cancellation = CancellationToken();
+	currentOperation.reset();
+
 	if (map) {
 		for (int y = 0; y < size; ++y) {
 			delete[] map[y];
@@ -156,78 +164,76 @@ void RuinsMap::release(){
 
 	if (debugView) {
 		debugView->Release();
-		debugView->Release();
+		debugView = NULL;
 	}
 
 	//release all the blocks
-	for (auto it = blocks.begin(); it != blocks.end();) {
-		delete (*it);
-		it = blocks.erase(it);
+	for (RuinsBlock* block : blocks) {
+		delete block;
 	}
-
-	if (currentOperation) delete currentOperation;
-	currentOperation = NULL;
+	blocks.clear();
 }
 
 
 
-//coroutine utility macros
-#define MAX_TIME_IN_COROUTINE 4
-#define INITIAL_CHECKPOINT std::chrono::high_resolution_clock clock; auto time = clock.now();
-#define CHECKPOINT {auto now = clock.now(); int millis = std::chrono::duration_cast<std::chrono::milliseconds>(now - time).count(); if(millis >= MAX_TIME_IN_COROUTINE){ co_yield NULL; time = clock.now(); }}
-
-RuinsMap::RuinsEnumerator RuinsMap::asyncGeneration() {
-
-	INITIAL_CHECKPOINT
+GenerationTask RuinsMap::asyncGeneration(CancellationToken token) {
 
 	//random blind agent-based generation
-	XMINT2 rob(randomEngine() % size, randomEngine() % size);
-	uint8_t dir = randomEngine() % 4;//0 left - 1 up - 2 right - 3 down
+	random.beginStream(0);
+	XMINT2 rob;
+	if (random.isLegacy()) {//which of these got drawn first used to be up to the compiler, and MSVC evaluates constructor arguments right to left
+		rob.y = random.nextInt(size);
+		rob.x = random.nextInt(size);
+	} else {
+		rob.x = random.nextInt(size);
+		rob.y = random.nextInt(size);
+	}
+	uint8_t dir = random.nextInt(4);//0 left - 1 up - 2 right - 3 down
 	int covered = 0;
 	while (covered < size * size * 0.2f) {//keep walking until a good portion (~20%) is covered
 		++covered;
 		//place a wall
 		map[rob.y][rob.x] = true;
 		//potentially place a premade room kernel
-		if (randomEngine() % 30 == 0) {
+		if (random.nextInt(30) == 0) {
 			placeKernel(rob.x, rob.y);
 		}
-		dir = randomEngine() % 20 == 0 ? randomEngine() % 4 : dir;//each step, 1 in 20 chances of changing direction
+		dir = random.nextInt(20) == 0 ? random.nextInt(4) : dir;//each step, 1 in 20 chances of changing direction
 																  //step forward
 		rob.x += dir == 0 ? -1 : dir == 2 ? +1 : 0;
 		rob.y += dir == 1 ? +1 : dir == 3 ? -1 : 0;
 		//check that we haven't stepped outside the bounds, and if so go back in and change direction
 		if (rob.x < 0 || rob.x >= size) {
 			rob.x = rob.x < 0 ? 0 : size - 1;
-			dir = randomEngine() % 2 == 0 ? 1 : 3;//go up or down now
+			dir = random.nextInt(2) == 0 ? 1 : 3;//go up or down now
 		}
 		if (rob.y < 0 || rob.y >= size) {
 			rob.y = rob.y < 0 ? 0 : size - 1;
-			dir = randomEngine() % 2 == 0 ? 0 : 2;//go left or right now
+			dir = random.nextInt(2) == 0 ? 0 : 2;//go left or right now
 		}
 
-		CHECKPOINT
+		GENERATION_CHECKPOINT(token)
 	}
 
 	//clean out the slopes
 	for (int y = 0; y < size; ++y) {
 		for (int x = 0; x < size; ++x) {
-			float slope = slopeFunction(x, y) + slopeFunction(x + 1, y) + slopeFunction(x + 1, y + 1) + slopeFunction(x, y + 1);
-			if (map[y][x] && slope > 0.15f) {//too big a slope here. clean out any ruins from here.
+			if (map[y][x] && cellSlopes(x, y) > 0.15f) {//too big a slope here. clean out any ruins from here.
 				map[y][x] = false;
 			}
 		}
-		CHECKPOINT
+		GENERATION_CHECKPOINT(token)
 	}
 
 	//generate the blocks' meshes we need
+	random.beginStream(1);
 	for (int y = 0; y < size; ++y) {
 		for (int x = 0; x < size; ++x) {
 			if (map[y][x]) {//compute position and rotation of the block:
-				float heightTopLeft = heightFunction(x, y + 1);
-				float heightTopRight = heightFunction(x + 1, y + 1);
-				float heightBottomLeft = heightFunction(x, y);
-				float heightBottomRight = heightFunction(x + 1, y);
+				float heightTopLeft = heights(x, y + 1);
+				float heightTopRight = heights(x + 1, y + 1);
+				float heightBottomLeft = heights(x, y);
+				float heightBottomRight = heights(x + 1, y);
 				float height = (heightTopLeft + heightBottomLeft + heightBottomRight + heightTopRight) * 0.25f;//the height of the block is just the avg
 																											   //compute pitch and roll from the adjacent heights:
 				float heightLeft = (heightTopLeft + heightBottomLeft) * 0.5f;
@@ -238,16 +244,14 @@ RuinsMap::RuinsEnumerator RuinsMap::asyncGeneration() {
 				float heightBottom = (heightBottomLeft + heightBottomRight) * 0.5f;
 				float forwardVector = heightTop - heightBottom;//a vector from the back part to the front part of the underlying terrain right underneath the block. again, only y component, as X=1.
 				float pitch = -atan2(forwardVector, 1);
-				float yaw = float(randomEngine() % 1000) / 1000.0f * 2 * 3.1415f;//random yaw between 0..360
-				blocks.push_back(new RuinsBlock(XMFLOAT3(x, height, y), XMFLOAT3(pitch, yaw, roll), blockLibrary->grab(randomEngine())));//push back one of the pre-generated meshes, with the given position and rotation
+				float yaw = random.nextUnit(1000) * 2 * 3.1415f;//random yaw between 0..360
+				blocks.push_back(new RuinsBlock(XMFLOAT3(x, height, y), XMFLOAT3(pitch, yaw, roll), blockLibrary->grab(random.nextInt(blockLibrary->size()))));//push back one of the pre-generated meshes, with the given position and rotation
 
-				CHECKPOINT
+				GENERATION_CHECKPOINT(token)
 			}
 		}
 	}
 
-	co_return NULL;
-}
-#undef MAX_TIME_IN_COUROUTINE
-#undef INITIAL_CHECKPOINT
-#undef CHECKPOINT
\ No newline at end of file
+	//draw the blocks sharing a mesh one after the other, so each mesh only gets bound once
+	std::stable_sort(blocks.begin(), blocks.end(), [](const RuinsBlock* a, const RuinsBlock* b) { return std::less<const RuinBlockMesh*>()(a->getMesh(), b->getMesh()); });
+}
\ No newline at end of file
@@ -1,8 +1,11 @@
 #include "Shader.h"
 
 #include "AppGlobals.h"
+#include "RenderBackend.h"
+#include "ShaderLibrary.h"
 
 Shader::Shader() : BaseShader(GLOBALS.Device, GLOBALS.Hwnd) {
+	matrixBuffer = NULL;//BaseShader's combined matrix buffer is replaced by viewProjectionBuffer and worldBuffer
 }
 
 Shader::~Shader(){
@@ -12,104 +15,55 @@ Shader::~Shader(){
 
 	if (matrixBuffer)
 		matrixBuffer->Release();
+	if (viewProjectionBuffer)
+		delete viewProjectionBuffer;
+	if (worldBuffer)
+		delete worldBuffer;
+	if (dynamicTessellationBuffer)
+		delete dynamicTessellationBuffer;
 
 	if (layout)
 		layout->Release();
 }
 
-///Reference: https://docs.microsoft.com/en-us/windows/uwp/gaming/load-a-game-asset
-void Shader::loadSkinVertexShader(WCHAR * filename) {
+void Shader::loadVertexShader(WCHAR* filename) {
 	if (vertexShader) {
 		printf("Error: vertex shader has already been loaded prior!\n");
 		return;
 	}
-	
-	/// Load shader -----------------------------------------------------------------------------------------------------------------------
-
-	std::ifstream input(filename, std::ios::binary);
-	std::vector<char> bytes((std::istreambuf_iterator<char>(input)), (std::istreambuf_iterator<char>()));
-
-	if (bytes.size() <= 0) {
-		std::wstring wfilename(filename);
-		printf("Error: vertex shader file %s does not exist...\n", std::string(wfilename.begin(), wfilename.end()).c_str());
-		return;
-	}
-
-	HRESULT result = GLOBALS.Device->CreateVertexShader(bytes.data(), bytes.size(), nullptr, &vertexShader);
-	if (result != S_OK) {
-		std::wstring wfilename(filename);
-		printf("Error: could not load compiled skinning vertex shader %s...\n", std::string(wfilename.begin(), wfilename.end()).c_str());
-		printError(result);
-		return;
-	}
-
-	/// Create input layout -----------------------------------------------------------------------------------------------------------------------
-
-	const D3D11_INPUT_ELEMENT_DESC layoutDesc[] = {
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float3 Position
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float2 Texcoord0
-		{ "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float3 Normal
-		{ "TANGENT",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float3 Tangent
-		{ "BLENDINDICES", 0, DXGI_FORMAT_R32G32B32A32_UINT,     0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Uint4 BlendIndices0
-		{ "BLENDINDICES", 1, DXGI_FORMAT_R32G32B32A32_UINT,     0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Uint4 BlendIndices1
-		{ "BLENDWEIGHT",  0, DXGI_FORMAT_R32G32B32A32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float4 BlendWeight0
-		{ "BLENDWEIGHT",  1, DXGI_FORMAT_R32G32B32A32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float4 BlendWeight1
-	};
-
-	result = GLOBALS.Device->CreateInputLayout(layoutDesc, ARRAYSIZE(layoutDesc), bytes.data(), bytes.size(), &layout);
-	if (result != S_OK) {
-		std::wstring wfilename(filename);
-		printf("Error: could not create input layout for skinning vertex shader %s...\n", std::string(wfilename.begin(), wfilename.end()).c_str());
-		printError(result);
-		return;
-	}
-
-	//Success! :D
+	vertexShader = GLOBALS.ShaderLibrary->getVertexShader(filename, ShaderLibrary::DEFAULT_LAYOUT, &layout);
 }
 
-void Shader::loadTangentVertexShader(WCHAR * filename) {
+void Shader::loadSkinVertexShader(WCHAR* filename) {
 	if (vertexShader) {
 		printf("Error: vertex shader has already been loaded prior!\n");
 		return;
 	}
+	vertexShader = GLOBALS.ShaderLibrary->getVertexShader(filename, ShaderLibrary::SKIN_LAYOUT, &layout);
+}
 
-	/// Load shader -----------------------------------------------------------------------------------------------------------------------
-
-	std::ifstream input(filename, std::ios::binary);
-	std::vector<char> bytes((std::istreambuf_iterator<char>(input)), (std::istreambuf_iterator<char>()));
-
-	if (bytes.size() <= 0) {
-		std::wstring wfilename(filename);
-		printf("Error: vertex shader file %s does not exist...\n", std::string(wfilename.begin(), wfilename.end()).c_str());
-		return;
-	}
-
-	HRESULT result = GLOBALS.Device->CreateVertexShader(bytes.data(), bytes.size(), nullptr, &vertexShader);
-	if (result != S_OK) {
-		std::wstring wfilename(filename);
-		printf("Error: could not load compiled tangent vertex shader %s...\n", std::string(wfilename.begin(), wfilename.end()).c_str());
-		printError(result);
+void Shader::loadTangentVertexShader(WCHAR* filename) {
+	if (vertexShader) {
+		printf("Error: vertex shader has already been loaded prior!\n");
 		return;
 	}
+	vertexShader = GLOBALS.ShaderLibrary->getVertexShader(filename, ShaderLibrary::TANGENT_LAYOUT, &layout);
+}
 
-	/// Create input layout -----------------------------------------------------------------------------------------------------------------------
+void Shader::loadHullShader(WCHAR* filename) {
+	hullShader = GLOBALS.ShaderLibrary->getHullShader(filename);
+}
 
-	const D3D11_INPUT_ELEMENT_DESC layoutDesc[] = {
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float3 Position
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float2 Texcoord0
-		{ "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float3 Normal
-		{ "TANGENT",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 } // Float3 Tangent
-	};
+void Shader::loadDomainShader(WCHAR* filename) {
+	domainShader = GLOBALS.ShaderLibrary->getDomainShader(filename);
+}
 
-	result = GLOBALS.Device->CreateInputLayout(layoutDesc, ARRAYSIZE(layoutDesc), bytes.data(), bytes.size(), &layout);
-	if (result != S_OK) {
-		std::wstring wfilename(filename);
-		printf("Error: could not create input layout for tangent vertex shader %s...\n", std::string(wfilename.begin(), wfilename.end()).c_str());
-		printError(result);
-		return;
-	}
+void Shader::loadGeometryShader(WCHAR* filename) {
+	geometryShader = GLOBALS.ShaderLibrary->getGeometryShader(filename);
+}
 
-	//Success! :D
+void Shader::loadPixelShader(WCHAR* filename) {
+	pixelShader = GLOBALS.ShaderLibrary->getPixelShader(filename);
 }
 
 void Shader::printError(HRESULT errorCode){
@@ -145,15 +99,9 @@ void Shader::initShader(WCHAR* vsFilename, WCHAR* psFilename, bool skin, bool co
 		loadVertexShader(vsFilename);
 	loadPixelShader(psFilename);
 
-	// Setup the description of the dynamic matrix constant buffer that is in the vertex shader.
-	D3D11_BUFFER_DESC matrixBufferDesc;
-	matrixBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	matrixBufferDesc.ByteWidth = sizeof(MatrixBufferType);
-	matrixBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	matrixBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	matrixBufferDesc.MiscFlags = 0;
-	matrixBufferDesc.StructureByteStride = 0;
-	renderer->CreateBuffer(&matrixBufferDesc, NULL, &matrixBuffer);
+	// Setup the matrix constant buffers that are in the vertex shader.
+	viewProjectionBuffer = new CachedConstantBuffer(renderer, sizeof(ViewProjectionBufferType));
+	worldBuffer = new CachedConstantBuffer(renderer, sizeof(WorldBufferType));
 
 	//If this is derived from Shader, will setup additional specific buffers
 	initBuffers();
@@ -166,7 +114,7 @@ void Shader::initHullDomain(WCHAR* hsFilename, WCHAR* dsFilename) {
 	loadDomainShader(dsFilename);
 
 	//setup dynamic tessellation buffer
-	SETUP_SHADER_BUFFER(DynamicTessellationBufferType, dynamicTessellationBuffer);
+	dynamicTessellationBuffer = new CachedConstantBuffer(renderer, sizeof(DynamicTessellationBufferType));
 }
 
 /// Loads geometry for this shader
@@ -175,51 +123,48 @@ void Shader::initGeometry(WCHAR* gsFilename) {
 }
 
 void Shader::setTexture(ID3D11ShaderResourceView * texture, int reg, ID3D11DeviceContext* deviceContext){
-	deviceContext->PSSetShaderResources(reg, 1, &texture);
+	GLOBALS.RenderBackend->setShaderResources(RenderBackend::PS, reg, 1, &texture);
 }
 
 void Shader::setShaderParameters(ID3D11DeviceContext* deviceContext, const XMMATRIX &worldMatrix, const XMMATRIX &viewMatrix, const XMMATRIX &projectionMatrix, XMFLOAT3 cameraPosition) {
 
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-
-	// Transpose the matrices to prepare them for the shader.
-	XMMATRIX tworld, tview, tproj;
-	tworld = XMMatrixTranspose(worldMatrix);
-	tview = XMMatrixTranspose(viewMatrix);
-	tproj = XMMatrixTranspose(projectionMatrix);
-	MatrixBufferType* dataPtr;
-	deviceContext->Map(matrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	dataPtr = (MatrixBufferType*)mappedResource.pData;
-	dataPtr->world = tworld;
-	dataPtr->view = tview;
-	dataPtr->projection = tproj;
-	deviceContext->Unmap(matrixBuffer, 0);
+	RenderBackend* backend = GLOBALS.RenderBackend;
+
+	// Transpose the matrices to prepare them for the shader; only the world matrix normally changes between draws.
+	ViewProjectionBufferType viewProjection;
+	viewProjection.view = XMMatrixTranspose(viewMatrix);
+	viewProjection.projection = XMMatrixTranspose(projectionMatrix);
+	viewProjectionBuffer->update(&viewProjection);
+	WorldBufferType world;
+	world.world = XMMatrixTranspose(worldMatrix);
+	worldBuffer->update(&world);
+	RenderBackend::Stage stage;
 	if (domainShader) {//if there is a domain shader, the matrices will be applied there.
-		deviceContext->DSSetConstantBuffers(0, 1, &matrixBuffer);
+		stage = RenderBackend::DS;
 	}
 	else if (geometryShader) {//instead if there is a geometry shader, the matrices will be applied there.
-		deviceContext->GSSetConstantBuffers(0, 1, &matrixBuffer);
+		stage = RenderBackend::GS;
 	}
 	else {//otherwise, vertex shader it is
-		deviceContext->VSSetConstantBuffers(0, 1, &matrixBuffer);
+		stage = RenderBackend::VS;
 	}
+	backend->setConstantBuffer(stage, 0, viewProjectionBuffer->getBuffer());
+	backend->setConstantBuffer(stage, 4, worldBuffer->getBuffer());
 
 	//Send dynamic tessellation buffer if needed
 	if (hullShader) {
-		DynamicTessellationBufferType* dynPtr;
-		deviceContext->Map(dynamicTessellationBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-		dynPtr = (DynamicTessellationBufferType*)mappedResource.pData;
-		dynPtr->worldMatrix = tworld;
-		dynPtr->cameraPosition = cameraPosition;
-		dynPtr->oneOverFarPlane = 1 / FAR_PLANE;
-		dynPtr->tessellationMax = GLOBALS.TessellationMax;
-		dynPtr->tessellationMin = GLOBALS.TessellationMin;
-		dynPtr->tessellationRange = GLOBALS.TessellationRange <= 0 ? FLT_MAX : 1.0f/GLOBALS.TessellationRange;
-		deviceContext->Unmap(dynamicTessellationBuffer, 0);
-		deviceContext->HSSetConstantBuffers(0, 1, &dynamicTessellationBuffer);
+		DynamicTessellationBufferType tessellation = {};
+		tessellation.worldMatrix = world.world;
+		tessellation.cameraPosition = cameraPosition;
+		tessellation.oneOverFarPlane = 1 / FAR_PLANE;
+		tessellation.tessellationMax = GLOBALS.TessellationMax;
+		tessellation.tessellationMin = GLOBALS.TessellationMin;
+		tessellation.tessellationRange = GLOBALS.TessellationRange <= 0 ? FLT_MAX : 1.0f/GLOBALS.TessellationRange;
+		dynamicTessellationBuffer->update(&tessellation);
+		backend->setConstantBuffer(RenderBackend::HS, 0, dynamicTessellationBuffer->getBuffer());
 	}
 
 	// Set sampler resource in the pixel shader
-	deviceContext->PSSetSamplers(0, 1, &sampleState);
+	backend->setSampler(RenderBackend::PS, 0, sampleState);
 
-}
+}
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "DXF.h"
 #include "ExtendedLight.h"
 #include "Material.h"
+#include "CachedConstantBuffer.h"
 
 #define SHADER_PATH "Debug/" // Use this for debugging in IDE
 //#define SHADER_PATH "" // Use this for production build
@@ -16,7 +17,7 @@
 #define SETUP_SHADER_COLOUR(vert, frag) initShader((WCHAR*)L"" SHADER_PATH #vert ".cso", (WCHAR*)L"" SHADER_PATH #frag ".cso", false, true)
 ///use SETUP_SHADER_TANGENT(default_vs, default_fs); for tangent access in shader
 #define SETUP_SHADER_TANGENT(vert, frag) initShader((WCHAR*)L"" SHADER_PATH #vert ".cso", (WCHAR*)L"" SHADER_PATH #frag ".cso", false, false, true)
-///use the following to also setup a hull and domain shader
+///use the following to also setup a hull and domain shader; the domain shader then gets the matrices instead of the vertex shader (view and projection in b0, world in b4)
 #define SETUP_TESSELATION(hull, domain) initHullDomain((WCHAR*)L"" SHADER_PATH #hull ".cso", (WCHAR*)L"" SHADER_PATH #domain ".cso")
 ///use the following to also setup a geometry shader
 #define SETUP_GEOMETRY(geom) initGeometry((WCHAR*)L"" SHADER_PATH #geom ".cso")
@@ -39,6 +40,17 @@ using namespace DirectX;
 
 class Shader : public BaseShader {
 protected:
+	//sent to the vertex shader (or domain/geometry if there is one) in register b0; the same for every draw of a pass, so only uploaded when the camera changes
+	struct ViewProjectionBufferType {
+		XMMATRIX view;
+		XMMATRIX projection;
+	};
+
+	//sent alongside the view and projection in register b4; this is the only per-draw matrix
+	struct WorldBufferType {
+		XMMATRIX world;
+	};
+
 	//sent to Hull Shader in register b0 if there is a hull
 	struct DynamicTessellationBufferType {
 		XMMATRIX worldMatrix;
@@ -73,12 +85,20 @@ protected:
 	///override this in deriving classes to setup additional buffers
 	inline virtual void initBuffers() = 0;
 
+	///these hide BaseShader's, so the shader objects come from GLOBALS.ShaderLibrary (and get shared with any other shader loading the same files)
+	void loadVertexShader(WCHAR* filename);
+	void loadHullShader(WCHAR* filename);
+	void loadDomainShader(WCHAR* filename);
+	void loadGeometryShader(WCHAR* filename);
+	void loadPixelShader(WCHAR* filename);
 	///similar to loadVertexShader(), loadColourVertexShader() and loadTextureVertexShader(), for skinned vertex shaders.
 	void loadSkinVertexShader(WCHAR* filename);
 	///same thing, for vertex shader with tangent input
 	void loadTangentVertexShader(WCHAR* filename);
 
 private:
-	ID3D11Buffer* dynamicTessellationBuffer;//this will only be setup if SETUP_TESSELATION() is called!
+	CachedConstantBuffer* viewProjectionBuffer = nullptr;
+	CachedConstantBuffer* worldBuffer = nullptr;
+	CachedConstantBuffer* dynamicTessellationBuffer = nullptr;//this will only be setup if SETUP_TESSELATION() is called!
 };
 
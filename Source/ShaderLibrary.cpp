@@ -0,0 +1,164 @@
+#include "ShaderLibrary.h"
+
+#include <fstream>
+#include <chrono>
+#include "Shader.h"
+
+///Hands out a new reference to object
+template<class T> static T* addRef(T* object) {
+	if (object)
+		object->AddRef();
+	return object;
+}
+
+static std::string narrow(const std::wstring& filename) {
+	return std::string(filename.begin(), filename.end());
+}
+
+///Reads the whole file in one go
+static bool readFile(const std::wstring& filename, std::vector<char>& bytes) {
+	std::ifstream input(filename.c_str(), std::ios::binary | std::ios::ate);
+	if (!input.is_open()) return false;
+	std::streamsize size = input.tellg();
+	if (size <= 0) return false;
+	bytes.resize(size_t(size));
+	input.seekg(0);
+	return bool(input.read(bytes.data(), size));
+}
+
+
+ShaderLibrary::ShaderLibrary(ID3D11Device* device) : device(device) {
+}
+
+ShaderLibrary::~ShaderLibrary() {
+	for (auto& file : entries) {
+		Entry& entry = file.second;
+		if (entry.vertexShader)
+			entry.vertexShader->Release();
+		if (entry.hullShader)
+			entry.hullShader->Release();
+		if (entry.domainShader)
+			entry.domainShader->Release();
+		if (entry.geometryShader)
+			entry.geometryShader->Release();
+		if (entry.pixelShader)
+			entry.pixelShader->Release();
+		for (ID3D11InputLayout* layout : entry.layouts) {
+			if (layout)
+				layout->Release();
+		}
+	}
+}
+
+void ShaderLibrary::preload(const std::vector<Request>& requests) {
+	auto start = std::chrono::steady_clock::now();
+
+	//add all the entries first, then send the loading off to the workers (one task per file)
+	std::vector<GenerationTask> tasks;
+	tasks.reserve(requests.size());
+	for (const Request& request : requests) {
+		if (entries.find(request.filename) != entries.end()) continue;
+		auto added = entries.emplace(request.filename, Entry()).first;
+		added->second.stage = request.stage;
+		tasks.push_back(loadOnWorker(&added->first, &added->second, request.layout));
+		tasks.back().Continue();
+	}
+
+	bool done = false;
+	while (!done) {
+		done = true;
+		for (GenerationTask& task : tasks) {
+			done = task.Continue() && done;
+		}
+		if (!done) std::this_thread::yield();
+	}
+
+	float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("Loaded %d shaders in %.1fms\n", int(tasks.size()), milliseconds);
+}
+
+GenerationTask ShaderLibrary::loadOnWorker(const std::wstring* filename, Entry* entry, Layout layout) {
+	co_await GenerationTask::resumeOnWorker();
+	load(*filename, *entry, layout);
+}
+
+void ShaderLibrary::load(const std::wstring& filename, Entry& entry, Layout layout) {
+	std::vector<char> bytes;
+	if (!readFile(filename, bytes)) {
+		printf("Error: shader file %s does not exist...\n", narrow(filename).c_str());
+		return;
+	}
+
+	HRESULT result = E_FAIL;
+	switch (entry.stage) {
+	case VERTEX_SHADER: result = device->CreateVertexShader(bytes.data(), bytes.size(), nullptr, &entry.vertexShader); break;
+	case HULL_SHADER: result = device->CreateHullShader(bytes.data(), bytes.size(), nullptr, &entry.hullShader); break;
+	case DOMAIN_SHADER: result = device->CreateDomainShader(bytes.data(), bytes.size(), nullptr, &entry.domainShader); break;
+	case GEOMETRY_SHADER: result = device->CreateGeometryShader(bytes.data(), bytes.size(), nullptr, &entry.geometryShader); break;
+	case PIXEL_SHADER: result = device->CreatePixelShader(bytes.data(), bytes.size(), nullptr, &entry.pixelShader); break;
+	}
+	if (result != S_OK) {
+		printf("Error: could not load compiled shader %s...\n", narrow(filename).c_str());
+		Shader::printError(result);
+		return;
+	}
+
+	if (entry.stage == VERTEX_SHADER) {
+		entry.bytecode = std::move(bytes);
+		createLayout(filename, entry, layout);
+	}
+}
+
+void ShaderLibrary::createLayout(const std::wstring& filename, Entry& entry, Layout layout) {
+	const D3D11_INPUT_ELEMENT_DESC layoutDesc[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float3 Position
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float2 Texcoord0
+		{ "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float3 Normal
+		{ "TANGENT",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float3 Tangent
+		{ "BLENDINDICES", 0, DXGI_FORMAT_R32G32B32A32_UINT,     0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Uint4 BlendIndices0
+		{ "BLENDINDICES", 1, DXGI_FORMAT_R32G32B32A32_UINT,     0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Uint4 BlendIndices1
+		{ "BLENDWEIGHT",  0, DXGI_FORMAT_R32G32B32A32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float4 BlendWeight0
+		{ "BLENDWEIGHT",  1, DXGI_FORMAT_R32G32B32A32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // Float4 BlendWeight1
+	};
+	const int elementCounts[LAYOUT_COUNT] = { 3, 4, 8 };//the default layout stops at the normal, the tangent one at the tangent
+
+	HRESULT result = device->CreateInputLayout(layoutDesc, elementCounts[layout], entry.bytecode.data(), entry.bytecode.size(), &entry.layouts[layout]);
+	if (result != S_OK) {
+		printf("Error: could not create input layout for vertex shader %s...\n", narrow(filename).c_str());
+		Shader::printError(result);
+	}
+}
+
+ShaderLibrary::Entry& ShaderLibrary::find(const std::wstring& filename, Stage stage, Layout layout) {
+	auto found = entries.find(filename);
+	if (found != entries.end()) return found->second;
+
+	Entry& entry = entries[filename];
+	entry.stage = stage;
+	load(filename, entry, layout);
+	return entry;
+}
+
+ID3D11VertexShader* ShaderLibrary::getVertexShader(const std::wstring& filename, Layout layout, ID3D11InputLayout** inputLayout) {
+	Entry& entry = find(filename, VERTEX_SHADER, layout);
+	if (entry.vertexShader && !entry.layouts[layout])//preloaded with another layout
+		createLayout(filename, entry, layout);
+	*inputLayout = addRef(entry.layouts[layout]);
+	return addRef(entry.vertexShader);
+}
+
+ID3D11HullShader* ShaderLibrary::getHullShader(const std::wstring& filename) {
+	return addRef(find(filename, HULL_SHADER, DEFAULT_LAYOUT).hullShader);
+}
+
+ID3D11DomainShader* ShaderLibrary::getDomainShader(const std::wstring& filename) {
+	return addRef(find(filename, DOMAIN_SHADER, DEFAULT_LAYOUT).domainShader);
+}
+
+ID3D11GeometryShader* ShaderLibrary::getGeometryShader(const std::wstring& filename) {
+	return addRef(find(filename, GEOMETRY_SHADER, DEFAULT_LAYOUT).geometryShader);
+}
+
+ID3D11PixelShader* ShaderLibrary::getPixelShader(const std::wstring& filename) {
+	return addRef(find(filename, PIXEL_SHADER, DEFAULT_LAYOUT).pixelShader);
+}
\ No newline at end of file
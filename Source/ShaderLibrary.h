@@ -0,0 +1,67 @@
+#pragma once
+
+/** Every compiled shader (.cso) the app uses, created once and shared: each Shader loading a file gets the same shader object (with a reference of its own to release), so building shaders again later,
+	eg the terrain's whenever the seed changes, only looks them up.
+	preload() takes the list of files used at startup and has the generation workers read them (each in a single read) and create their shader objects in parallel, rather than going through them one at a time.
+	Vertex shaders keep their bytecode around for creating input layouts, which are shared as well, one per vertex shader and layout.
+*/
+
+#include <d3d11.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "GenerationTask.h"
+
+///use the following to list the files for preload(), as such:
+///  shaderLibrary->preload({ PRELOAD_VERTEX(default_vs, TANGENT_LAYOUT), PRELOAD_PIXEL(terrain_fs) });
+#define PRELOAD_VERTEX(vert, layout) ShaderLibrary::Request{ L"" SHADER_PATH #vert ".cso", ShaderLibrary::VERTEX_SHADER, ShaderLibrary::layout }
+#define PRELOAD_PIXEL(frag) ShaderLibrary::Request{ L"" SHADER_PATH #frag ".cso", ShaderLibrary::PIXEL_SHADER, ShaderLibrary::DEFAULT_LAYOUT }
+
+class ShaderLibrary {
+
+public:
+	enum Stage { VERTEX_SHADER, HULL_SHADER, DOMAIN_SHADER, GEOMETRY_SHADER, PIXEL_SHADER };
+	enum Layout { DEFAULT_LAYOUT, TANGENT_LAYOUT, SKIN_LAYOUT, LAYOUT_COUNT };//see Shader's loadVertexShader(), loadTangentVertexShader() and loadSkinVertexShader()
+
+	struct Request {
+		std::wstring filename;
+		Stage stage;
+		Layout layout;//vertex shaders only
+	};
+
+	ShaderLibrary(ID3D11Device* device);
+	~ShaderLibrary();
+
+	///Loads all of these on the worker threads; returns once they're done
+	void preload(const std::vector<Request>& requests);
+
+	///Each of these loads the file if it hasn't been already, and returns a new reference to its shader object (null if it couldn't be loaded)
+	ID3D11VertexShader* getVertexShader(const std::wstring& filename, Layout layout, ID3D11InputLayout** inputLayout);
+	ID3D11HullShader* getHullShader(const std::wstring& filename);
+	ID3D11DomainShader* getDomainShader(const std::wstring& filename);
+	ID3D11GeometryShader* getGeometryShader(const std::wstring& filename);
+	ID3D11PixelShader* getPixelShader(const std::wstring& filename);
+
+private:
+	struct Entry {
+		Stage stage;
+		ID3D11VertexShader* vertexShader = nullptr;
+		ID3D11HullShader* hullShader = nullptr;
+		ID3D11DomainShader* domainShader = nullptr;
+		ID3D11GeometryShader* geometryShader = nullptr;
+		ID3D11PixelShader* pixelShader = nullptr;
+		std::vector<char> bytecode;//vertex shaders only
+		ID3D11InputLayout* layouts[LAYOUT_COUNT] = {};
+	};
+
+	///Finds the file's entry, loading it right away if it's not there yet
+	Entry& find(const std::wstring& filename, Stage stage, Layout layout);
+	///Reads the file and creates its shader object (and input layout, for vertex shaders); safe to call from a worker, as it only touches entry
+	void load(const std::wstring& filename, Entry& entry, Layout layout);
+	GenerationTask loadOnWorker(const std::wstring* filename, Entry* entry, Layout layout);
+	void createLayout(const std::wstring& filename, Entry& entry, Layout layout);
+
+	ID3D11Device* device;
+	std::unordered_map<std::wstring, Entry> entries;//(entries don't move once added, so workers can fill them in while others get added)
+
+};
\ No newline at end of file
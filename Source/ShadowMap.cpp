@@ -0,0 +1,78 @@
+#include "ShadowMap.h"
+
+#include "Shader.h"
+
+
+ShadowMap::ShadowMap(ID3D11Device* device, int resolution) : resolution(resolution) {
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = resolution;
+	textureDesc.Height = resolution;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	HRESULT result = device->CreateTexture2D(&textureDesc, NULL, &texture);
+	if (result != S_OK) {
+		printf("Error creating shadow map texture: ");
+		Shader::printError(result);
+		return;
+	}
+
+	result = device->CreateRenderTargetView(texture, NULL, &renderTargetView);
+	if (result != S_OK) {
+		printf("Error creating shadow map render target view: ");
+		Shader::printError(result);
+	}
+
+	result = device->CreateShaderResourceView(texture, NULL, &shaderResourceView);
+	if (result != S_OK) {
+		printf("Error creating shadow map shader resource view: ");
+		Shader::printError(result);
+	}
+
+	textureDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	textureDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	result = device->CreateTexture2D(&textureDesc, NULL, &depthTexture);
+	if (result != S_OK) {
+		printf("Error creating shadow map depth buffer: ");
+		Shader::printError(result);
+		return;
+	}
+
+	result = device->CreateDepthStencilView(depthTexture, NULL, &depthStencilView);
+	if (result != S_OK) {
+		printf("Error creating shadow map depth stencil view: ");
+		Shader::printError(result);
+	}
+
+	viewport = { 0, 0, float(resolution), float(resolution), 0, 1 };
+}
+
+ShadowMap::~ShadowMap() {
+	if (depthStencilView)
+		depthStencilView->Release();
+	if (depthTexture)
+		depthTexture->Release();
+	if (shaderResourceView)
+		shaderResourceView->Release();
+	if (renderTargetView)
+		renderTargetView->Release();
+	if (texture)
+		texture->Release();
+}
+
+void ShadowMap::begin(ID3D11DeviceContext* deviceContext) {
+	deviceContext->OMSetRenderTargets(1, &renderTargetView, depthStencilView);
+	deviceContext->RSSetViewports(1, &viewport);
+	float clear[4] = { 0, 0, 0, 0 };//0 reads as infinitely far from the light, so texels no caster lands on never shadow anything
+	deviceContext->ClearRenderTargetView(renderTargetView, clear);
+	deviceContext->ClearDepthStencilView(depthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0);
+}
+
+void ShadowMap::end(D3D* renderer) {
+	renderer->setBackBufferRenderTarget();
+	renderer->resetViewport();
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+/** A light's shadow map: the distance to the light (1 - dist/far, as written by depth_fs) in a single R32_FLOAT channel, plus its own depth buffer to render into it with.
+	Being single-channel, the map can be read with a comparison sampler; SampleCmpLevelZero then does the depth test on 4 texels at once and filters the results (hardware 2x2 PCF).
+*/
+
+#include "DXF.h"
+
+class ShadowMap {
+
+public:
+	ShadowMap(ID3D11Device* device, int resolution);
+	~ShadowMap();
+
+	///Binds the map and its depth buffer and clears both; render the shadow casters after this
+	void begin(ID3D11DeviceContext* deviceContext);
+	///Goes back to the back buffer
+	void end(D3D* renderer);
+
+	inline ID3D11ShaderResourceView* getShaderResourceView() { return shaderResourceView; }
+	inline int getResolution() { return resolution; }
+
+private:
+	int resolution;
+	ID3D11Texture2D* texture = nullptr;//R32_FLOAT
+	ID3D11RenderTargetView* renderTargetView = nullptr;
+	ID3D11ShaderResourceView* shaderResourceView = nullptr;
+	ID3D11Texture2D* depthTexture = nullptr;
+	ID3D11DepthStencilView* depthStencilView = nullptr;
+	D3D11_VIEWPORT viewport;
+
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "SquareMesh.h"
 
 #include "AppGlobals.h"
+#include "RenderBackend.h"
 
 SquareMesh::SquareMesh(){
 	initBuffers(GLOBALS.Device);
@@ -60,14 +61,5 @@ void SquareMesh::initBuffers(ID3D11Device* device){
 }
 
 void SquareMesh::sendData(ID3D11DeviceContext* deviceContext, D3D_PRIMITIVE_TOPOLOGY top){
-	unsigned int stride;
-	unsigned int offset;
-
-	// Set vertex buffer stride and offset.
-	stride = sizeof(VertexType);
-	offset = 0;
-
-	deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	deviceContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
-	deviceContext->IASetPrimitiveTopology(top);
+	GLOBALS.RenderBackend->setGeometry(vertexBuffer, sizeof(VertexType), indexBuffer, top);
 }
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "SubmissionCheck.h"
+
+#include "AppGlobals.h"
+#include "RenderBackend.h"
+#include "InfiniteTerrain.h"
+
+#define CONSTANT_BYTES_PER_DRAW_BUDGET 256 //the per-chunk light buffers only go up when they change, so most draws only upload their world matrix
+
+
+bool SubmissionCheck::run(InfiniteTerrain* terrain, bool lighting, bool shadowing, D3D* renderer, XMMATRIX& worldMatrix, XMMATRIX& viewMatrix, XMMATRIX& projectionMatrix, XMFLOAT3 cameraPosition) {
+	//what should come out of it: a draw for each chunk, and one for each of their ruin blocks
+	int chunks = int(terrain->chunks.size());
+	int blocks = 0;
+	for (TerrainMesh* chunk : terrain->chunks) {
+		if (chunk->getRuins()) blocks += int(chunk->getRuins()->blocks.size());
+	}
+
+	//submit it all again, through a backend that only records it
+	NullRenderBackend recorder;
+	RenderBackend* backend = GLOBALS.RenderBackend;
+	GpuTimer* gpuTimer = GLOBALS.GpuTimer;
+	GLOBALS.RenderBackend = &recorder;
+	GLOBALS.GpuTimer = nullptr;//nothing gets drawn, so nothing to time
+	recorder.beginFrame();
+	terrain->render(lighting, shadowing, renderer, worldMatrix, viewMatrix, projectionMatrix, cameraPosition);
+	std::vector<NullRenderBackend::Command> commands = recorder.getCommands();
+	recorder.beginFrame();//closes the frame, for its totals
+	GLOBALS.RenderBackend = backend;
+	GLOBALS.GpuTimer = gpuTimer;
+	backend->invalidateState();//the textures still went straight through the device context
+
+	int terrainDraws = 0;
+	int blockDraws = 0;
+	for (const NullRenderBackend::Command& command : commands) {
+		if (command.type != NullRenderBackend::DRAW_INDEXED) continue;
+		if (command.object == static_cast<BaseShader*>(terrain->shader)) ++terrainDraws;
+		else if (command.object == static_cast<BaseShader*>(terrain->blockShader)) ++blockDraws;
+	}
+	const RenderStats& stats = recorder.getLastFrame();
+
+	bool withinBudget = true;
+	if (terrainDraws != chunks) {
+		printf("Submission check: %d terrain draws for %d chunks.\n", terrainDraws, chunks);
+		withinBudget = false;
+	}
+	if (blockDraws != blocks) {
+		printf("Submission check: %d ruin draws for %d blocks.\n", blockDraws, blocks);
+		withinBudget = false;
+	}
+	if (stats.bufferUploads > 0) {
+		printf("Submission check: %d buffer uploads (%d bytes) while drawing; the geometry should only go up when it changes.\n", stats.bufferUploads, int(stats.bufferUploadBytes));
+		withinBudget = false;
+	}
+	if (stats.constantBufferBytes > size_t(stats.draws) * CONSTANT_BYTES_PER_DRAW_BUDGET) {
+		printf("Submission check: %d constant buffer bytes over %d draws, over the budget of %d per draw.\n", int(stats.constantBufferBytes), stats.draws, CONSTANT_BYTES_PER_DRAW_BUDGET);
+		withinBudget = false;
+	}
+	return withinBudget;
+}
+
+#undef CONSTANT_BYTES_PER_DRAW_BUDGET
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+/** Submits the terrain (chunks and ruins) a second time through a NullRenderBackend, so nothing reaches the gpu, and checks what got submitted against the per-frame budgets:
+	each chunk and each ruin block drawn exactly once, no vertex data uploaded while drawing, and no more constant buffer bytes than CONSTANT_BYTES_PER_DRAW_BUDGET per draw on average.
+	It's run from App::render after the geometry pass when VERIFY_SUBMISSION is defined, and prints out whatever went over budget.
+	The replay submits exactly what the frame just did, so the constant buffer caches end up holding the same contents as the gpu side.
+*/
+
+#include "DXF.h"
+
+class InfiniteTerrain;
+
+class SubmissionCheck {
+
+public:
+	///returns whether the submission stayed within budget
+	static bool run(InfiniteTerrain* terrain, bool lighting, bool shadowing, D3D* renderer, XMMATRIX& worldMatrix, XMMATRIX& viewMatrix, XMMATRIX& projectionMatrix, XMFLOAT3 cameraPosition);
+
+};
\ No newline at end of file
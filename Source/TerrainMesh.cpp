@@ -4,13 +4,19 @@
 #include <algorithm>
 #include <random>
 #include "PerlinNoise.h"
-#include <experimental/coroutine>
 #include "Utils.h"
+#include "Shader.h"
+#include "Profiler.h"
+#include "GenerationScheduler.h"
+#include "RenderBackend.h"
 
 #define REINIT_TIMEOUT 1.0f //minimum amount of time between each buffer reinit
+//#define VERIFY_NORMAL_GRID //when defined, the vectorized normal grid is checked against getNormal() after each update
+//#define VERIFY_REAL_HEIGHTS //when defined, computeRealHeights() is checked against computeRealHeight() after each update
+//#define VERIFY_VERTEX_KERNEL //when defined, fillVertexRow() is checked against fillVertexRowReference() after each update
 
 
-TerrainMesh::TerrainMesh(int seed, int x, int z, int size, RuinBlockLibrary* blockLibrary) : seed(seed + 24 * x + 9999 * z), baseX(x), baseZ(z), size(size), blockLibrary(blockLibrary){//the effective seed depends on the base coords
+TerrainMesh::TerrainMesh(int seed, int x, int z, int size, RuinBlockLibrary* blockLibrary) : seed(seed + 24 * x + 9999 * z), baseX(x), baseZ(z), size(size), blockLibrary(blockLibrary), lightBuffers(GLOBALS.Device){//the effective seed depends on the base coords
 
 	if (size < 2) return;
 
@@ -28,6 +34,22 @@ TerrainMesh::TerrainMesh(int seed, int x, int z, int size, RuinBlockLibrary* blo
 
 	initHeightmap();
 
+	//the blending weights towards the left and below neighbours only depend on the distance to the edge
+	float threshold = 0.2f * size;
+	blendWeights = new float[size];
+	while (blendCount < size && blendCount < threshold && blendCount + size - 1 < heightmap->getSize()) {
+		blendWeights[blendCount] = 1 - (float)blendCount / threshold;
+		++blendCount;
+	}
+
+	//x positions and u coordinates are the same for every row, so work them out once
+	vertexRowX = new float[size];
+	vertexRowU = new float[size];
+	for (int x = 0; x < size; ++x) {
+		vertexRowX[x] = float(x + baseX - size / 2);
+		vertexRowU[x] = (float)x / (size - 1);
+	}
+
 	initBuffers(GLOBALS.Device);
 }
 
@@ -42,8 +64,21 @@ TerrainMesh::~TerrainMesh(){
 		delete[] realHeights;
 		realHeights = nullptr;
 	}
-	vertexBuffer->Release();
-	indexBuffer->Release();
+	if (cellSlopes) {
+		for (int y = 0; y < size - 1; ++y)
+			delete[] cellSlopes[y];
+		delete[] cellSlopes;
+		cellSlopes = nullptr;
+	}
+	delete[] normals.x;
+	delete[] normals.y;
+	delete[] normals.z;
+	normals = NormalGrid();
+	delete[] vertexRowX;
+	delete[] vertexRowU;
+	delete[] blendWeights;
+	if (vertexBuffer) vertexBuffer->Release();
+	if (indexBuffer) indexBuffer->Release();
 	vertexBuffer = nullptr;
 	indexBuffer = nullptr;
 }
@@ -176,6 +211,73 @@ void mainImage( out vec4 fragColor, in vec2 fragCoord ){
 	*/
 }
 
+///Same results as calling computeRealHeight() on every vert, but a row at a time:
+/// the border rows and columns are straight copies from the neighbours, the rows and columns within 20% of the left/below edges blend in the neighbouring heightmaps
+/// using the precomputed weights, and everything else is just our own heightmap copied over.
+/// The blending expressions are computeRealHeight()'s with the zero terms dropped, keeping the same order of operations so the results are bit for bit the same.
+void TerrainMesh::computeRealHeights() {
+	PROFILE_SCOPE("Real heights");
+	const Heightmap* leftMap = leftNeighbour ? leftNeighbour->heightmap : nullptr;
+	const Heightmap* belowMap = belowNeighbour ? belowNeighbour->heightmap : nullptr;
+	const Heightmap* diagonalMap = diagonalNeighbour ? diagonalNeighbour->heightmap : nullptr;
+	int leftCount = leftMap ? blendCount : 0;//how many columns blend in the left neighbour
+	int belowCount = belowMap ? blendCount : 0;//how many rows blend in the below neighbour
+
+	for (int y = 0; y < size; ++y) {
+		float* out = realHeights[y + 1] + 1;//offset by 1 so that out[x] is the real height at (x, y)
+		const float* heights = heightmap->getRow(y);
+		const float* leftHeights = leftMap ? leftMap->getRow(y) + size - 1 : nullptr;//again offset so that leftHeights[x] lines up with heights[x]
+
+		if (y < belowCount) {
+			float belowContribution = blendWeights[y];
+			const float* belowHeights = belowMap->getRow(y + size - 1);
+			const float* diagonalHeights = diagonalMap ? diagonalMap->getRow(y + size - 1) + size - 1 : nullptr;
+			for (int x = 0; x < leftCount; ++x) {
+				float leftContribution = blendWeights[x];
+				float diagonalHeight = diagonalHeights ? diagonalHeights[x] : -1000;
+				out[x] = heights[x] * (1 - leftContribution) * (1 - belowContribution) + leftHeights[x] * leftContribution * (1 - belowContribution) + belowHeights[x] * belowContribution * (1 - leftContribution) + diagonalHeight * leftContribution * belowContribution;
+			}
+			for (int x = leftCount; x < size; ++x) {
+				out[x] = heights[x] * (1 - belowContribution) + belowHeights[x] * belowContribution;
+			}
+		} else {
+			for (int x = 0; x < leftCount; ++x) {
+				float leftContribution = blendWeights[x];
+				out[x] = heights[x] * (1 - leftContribution) + leftHeights[x] * leftContribution;
+			}
+			memcpy(out + leftCount, heights + leftCount, sizeof(float) * (size - leftCount));
+		}
+
+		//left and right edges come from the neighbours' own real heights (chunks overlap by one vert, hence size - 2 on the left)
+		realHeights[y + 1][0] = leftNeighbour ? leftNeighbour->realHeights[y + 1][size - 1] : INFINITY;
+		realHeights[y + 1][size + 1] = rightNeighbour ? rightNeighbour->realHeights[y + 1][2] : INFINITY;
+	}
+
+	//as do the bottom and top edges (same overlap on the bottom)
+	if (belowNeighbour) {
+		memcpy(realHeights[0] + 1, belowNeighbour->realHeights[size - 1] + 1, sizeof(float) * size);
+	} else {
+		for (int x = 1; x < size + 1; ++x) realHeights[0][x] = INFINITY;
+	}
+	realHeights[0][0] = realHeights[0][size + 1] = INFINITY;
+	if (topNeighbour) {
+		memcpy(realHeights[size + 1], topNeighbour->realHeights[2], sizeof(float) * (size + 2));
+	} else {
+		for (int x = 0; x < size + 2; ++x) realHeights[size + 1][x] = INFINITY;
+	}
+
+#ifdef VERIFY_REAL_HEIGHTS
+	for (int y = -1; y < size + 1; ++y) {
+		for (int x = -1; x < size + 1; ++x) {
+			float reference = computeRealHeight(x, y);
+			if (memcmp(&reference, &realHeights[y + 1][x + 1], sizeof(float)) != 0) {
+				printf("Real height mismatch at %d %d: %f instead of %f.\n", x, y, realHeights[y + 1][x + 1], reference);
+			}
+		}
+	}
+#endif
+}
+
 void TerrainMesh::initHeightmap() {
 	
 	if (heightmap) delete heightmap;
@@ -195,6 +297,27 @@ void TerrainMesh::initHeightmap() {
 		}
 	}
 
+	if (cellSlopes) {
+		for (int y = 0; y < size - 1; ++y)
+			delete[] cellSlopes[y];
+		delete[] cellSlopes;
+		cellSlopes = nullptr;
+	}
+	delete[] normals.x;
+	delete[] normals.y;
+	delete[] normals.z;
+	normals.x = new float[size * size];
+	normals.y = new float[size * size];
+	normals.z = new float[size * size];
+
+	cellSlopes = new float*[size - 1];
+	for (int y = 0; y < size - 1; ++y) {
+		cellSlopes[y] = new float[size - 1];
+		for (int x = 0; x < size - 1; ++x) {
+			cellSlopes[y][x] = 0;
+		}
+	}
+
 	heightmap->generate();
 
 }
@@ -215,8 +338,7 @@ void TerrainMesh::updateTerrain(const TerrainMesh* leftNeighbour, const TerrainM
 	this->topNeighbour = topNeighbour;
 	this->rightNeighbour = rightNeighbour;
 	
-	//update the heightmap (for async generation)
-	heightmap->update();
+	//the heightmaps themselves have been updated already (see updateHeightmap())
 	needUpdate |= heightmap->hasChanged();
 	if (leftNeighbour) needUpdate |= leftNeighbour->heightmap->hasChanged();
 	if (belowNeighbour) needUpdate |= belowNeighbour->heightmap->hasChanged();
@@ -224,34 +346,50 @@ void TerrainMesh::updateTerrain(const TerrainMesh* leftNeighbour, const TerrainM
 	if (topNeighbour && topNeighbour->heightmap) needUpdate |= topNeighbour->heightmap->hasChanged();
 	if (rightNeighbour && rightNeighbour->heightmap) needUpdate |= rightNeighbour->heightmap->hasChanged();
 
-	if (!needUpdate) {
+	//only lay the ruins down once all the heightmaps they sit on are done (with the frame budget, a heightmap can go a frame without changing while still generating)
+	bool generating = heightmap->isGenerating();
+	if (leftNeighbour) generating |= leftNeighbour->heightmap->isGenerating();
+	if (belowNeighbour) generating |= belowNeighbour->heightmap->isGenerating();
+	if (diagonalNeighbour) generating |= diagonalNeighbour->heightmap->isGenerating();
+
+	if (!needUpdate && !generating && inRange) {
 		if (!ruins) {
-			ruins = new RuinsMap(seed-1, size-1, [&](int x, int y) {//Slope function
-						//given coordinates on the heightmap, returns a slope value between 0..1.
-						return 1 - getNormal(x, y).y;
-					}, [&](int x, int y) {//Height function
-						return getRealHeight(x, y);
-					}, blockLibrary);
+			ruins = new RuinsMap(seed-1, size-1, TerrainField(cellSlopes), TerrainField(realHeights, 1), blockLibrary);
 			needUpdate = true;
 		}
 	}
 
 }
 
+void TerrainMesh::setInRange(bool value) {
+	if (value == inRange) return;
+	inRange = value;
+	if (inRange) {
+		heightmap->resume();//the ruins get laid down again by updateTerrain() once the heights are done
+	}
+	else {
+		heightmap->suspend();
+		if (ruins && ruins->isGenerating()) {
+			delete ruins;
+			ruins = nullptr;
+		}
+	}
+}
+
 void TerrainMesh::reinitBuffers(ID3D11Device* device, float dt) {
 	meshChanged = false;
 
 	if (needUpdate) {//only update buffers every few millis rather than every single frame to save on resources:
 		needsReinitLater = true;
 		timeSinceLastBufferUpdate -= dt;
-		if (timeSinceLastBufferUpdate <= 0) {
+		if (timeSinceLastBufferUpdate <= 0 && inRange && GenerationScheduler::Instance().hasTime()) {
 			initBuffers(device);
 			needsReinitLater = false;
 			meshChanged = true;
 			timeSinceLastBufferUpdate = REINIT_TIMEOUT;
 		}
 	}
-	else if (needsReinitLater) {
+	else if (needsReinitLater && inRange && GenerationScheduler::Instance().hasTime()) {
 
 		initBuffers(device);//do a final one to get the last update regardless of time passed
 		needsReinitLater = false;
@@ -260,46 +398,63 @@ void TerrainMesh::reinitBuffers(ID3D11Device* device, float dt) {
 
 	//also update the ruins to make sure they're entirely generated (or re-generated if needed)
 	if (ruins) {
-		if(ruins->update(needUpdate))
+		if(ruins->update(needUpdate, inRange))
 			meshChanged = true;
 	}
 }
 
 void TerrainMesh::initBuffers(ID3D11Device * device){
-	if(vertexBuffer)vertexBuffer->Release();
-	vertexBuffer = nullptr;
-	if(indexBuffer)indexBuffer->Release();
-	indexBuffer = nullptr;
+	PROFILE_SCOPE("TerrainMesh::initBuffers");
 
 	//compute the current real heights at all points
-	for (int y = -1; y < size + 1; ++y) {
-		for (int x = -1; x < size + 1; ++x) {
-			realHeights[y + 1][x + 1] = computeRealHeight(x, y);
-		}
-	}
-
+	computeRealHeights();
 
-	D3D11_SUBRESOURCE_DATA vertexData, indexData;
+	// generate normals for those heights
+	calculateNormals();
 
 	vertexCount = size*size;// size is the number of vertices on one axis
 	indexCount = (size-1)*(size-1)*6;// 6 indices per plane
 
-	VertexType_Tangent* vertices = new VertexType_Tangent[vertexCount];
-	unsigned long* indices = new unsigned long[indexCount];
+	//the vertex buffer is created once and then rewritten in place on each update, while the indices never change
+	if (!vertexBuffer) {
+		D3D11_BUFFER_DESC vertexBufferDesc = { sizeof(VertexType_Tangent) * vertexCount, D3D11_USAGE_DYNAMIC, D3D11_BIND_VERTEX_BUFFER, D3D11_CPU_ACCESS_WRITE, 0, 0 };
+		HRESULT result = device->CreateBuffer(&vertexBufferDesc, NULL, &vertexBuffer);
+		if (result != S_OK) {
+			printf("Error creating terrain vertex buffer: ");
+			Shader::printError(result);
+			vertexBuffer = nullptr;
+			return;
+		}
+	}
+	if (!indexBuffer) {
+		initIndexBuffer(device);
+	}
 
-	// Load the vertex array with data from the heightmap's data
+	// Load the vertex buffer with data from the heightmap's data, one row at a time
+	VertexType_Tangent* vertices = (VertexType_Tangent*)GLOBALS.RenderBackend->mapDiscard(vertexBuffer, sizeof(VertexType_Tangent) * vertexCount);
+	if (!vertices) return;
 	for (int y = 0; y < size; ++y) {
-		for (int x = 0; x < size; ++x) {
-			int index = y * size + x;
-			vertices[index].position = XMFLOAT3(x+baseX-size/2, getRealHeight(x, y), y+baseZ-size/2);
-			vertices[index].texture = XMFLOAT2((float)x / (size-1), (float)y / (size-1));
-			vertices[index].normal = XMFLOAT3(0, 1, 0);
-			vertices[index].tangent = XMFLOAT3(1, 0, 0);
+		fillVertexRow(vertices + y * size, y);
+	}
+	GLOBALS.RenderBackend->unmap(vertexBuffer);
+
+#ifdef VERIFY_VERTEX_KERNEL
+	{
+		//never read back from the mapped buffer (it's write-combined memory), compare two fresh rows instead
+		std::vector<VertexType_Tangent> row(size), reference(size);
+		for (int y = 0; y < size; ++y) {
+			fillVertexRow(row.data(), y);
+			fillVertexRowReference(reference.data(), y);
+			if (memcmp(row.data(), reference.data(), sizeof(VertexType_Tangent) * size) != 0) {
+				printf("Vertex kernel mismatch on row %d of chunk %d %d.\n", y, baseX, baseZ);
+			}
 		}
 	}
+#endif
+}
 
-	// generate normals for those vertices
-	calculateNormals(&vertices);
+void TerrainMesh::initIndexBuffer(ID3D11Device* device) {
+	unsigned long* indices = new unsigned long[indexCount];
 
 	// Load the index array with data.
 	int index = -1;
@@ -329,19 +484,81 @@ void TerrainMesh::initBuffers(ID3D11Device * device){
 		}
 	}
 
-	D3D11_BUFFER_DESC vertexBufferDesc = { sizeof(VertexType_Tangent) * vertexCount, D3D11_USAGE_DEFAULT, D3D11_BIND_VERTEX_BUFFER, 0, 0, 0 };
-	vertexData = { vertices, 0 , 0 };
-	device->CreateBuffer(&vertexBufferDesc, &vertexData, &vertexBuffer);
-
-	D3D11_BUFFER_DESC indexBufferDesc = { sizeof(unsigned long) * indexCount, D3D11_USAGE_DEFAULT, D3D11_BIND_INDEX_BUFFER, 0, 0, 0 };
-	indexData = { indices, 0, 0 };
-	device->CreateBuffer(&indexBufferDesc, &indexData, &indexBuffer);
+	D3D11_BUFFER_DESC indexBufferDesc = { sizeof(unsigned long) * indexCount, D3D11_USAGE_IMMUTABLE, D3D11_BIND_INDEX_BUFFER, 0, 0, 0 };
+	D3D11_SUBRESOURCE_DATA indexData = { indices, 0, 0 };
+	HRESULT result = device->CreateBuffer(&indexBufferDesc, &indexData, &indexBuffer);
+	if (result != S_OK) {
+		printf("Error creating terrain index buffer: ");
+		Shader::printError(result);
+		indexBuffer = nullptr;
+	}
 
-	// Release the arrays now that the vertex and index buffers have been created and loaded.
-	delete[] vertices;
-	vertices = 0;
+	// Release the array now that the index buffer has been created and loaded.
 	delete[] indices;
-	indices = 0;
+}
+
+///Writes out one row of vertices, 4 at a time.
+/// All the inputs are laid out as rows of floats (heights, normal grid, and the precomputed x/u rows), so each group of 4 verts is just a couple of 4x4 transposes:
+/// the first 16 bytes of each vertex are (x, height, z, u) and the next 16 are (v, normal), followed by the constant tangent.
+void TerrainMesh::fillVertexRow(VertexType_Tangent* vertices, int y) const {
+	const float* heights = realHeights[y + 1] + 1;
+	const float* normalX = normals.x + y * size;
+	const float* normalY = normals.y + y * size;
+	const float* normalZ = normals.z + y * size;
+	const XMVECTOR positionZ = XMVectorReplicate(float(y + baseZ - size / 2));
+	const XMVECTOR v = XMVectorReplicate((float)y / (size - 1));
+	const XMVECTOR tangent = XMVectorSet(1, 0, 0, 0);
+
+	int x = 0;
+	for (; x + 4 <= size; x += 4) {
+		XMVECTOR px = XMLoadFloat4((const XMFLOAT4*)(vertexRowX + x));
+		XMVECTOR py = XMLoadFloat4((const XMFLOAT4*)(heights + x));
+		XMVECTOR u = XMLoadFloat4((const XMFLOAT4*)(vertexRowU + x));
+		XMVECTOR nx = XMLoadFloat4((const XMFLOAT4*)(normalX + x));
+		XMVECTOR ny = XMLoadFloat4((const XMFLOAT4*)(normalY + x));
+		XMVECTOR nz = XMLoadFloat4((const XMFLOAT4*)(normalZ + x));
+
+		//(x0 y0 x1 y1), (z u0 z u1), then the same for verts 2 and 3
+		XMVECTOR xy01 = XMVectorMergeXY(px, py);
+		XMVECTOR zu01 = XMVectorMergeXY(positionZ, u);
+		XMVECTOR xy23 = XMVectorMergeZW(px, py);
+		XMVECTOR zu23 = XMVectorMergeZW(positionZ, u);
+		//(v nx0 v nx1), (ny0 nz0 ny1 nz1)...
+		XMVECTOR vn01 = XMVectorMergeXY(v, nx);
+		XMVECTOR yz01 = XMVectorMergeXY(ny, nz);
+		XMVECTOR vn23 = XMVectorMergeZW(v, nx);
+		XMVECTOR yz23 = XMVectorMergeZW(ny, nz);
+
+		XMStoreFloat4((XMFLOAT4*)&vertices[x].position, XMVectorPermute<0, 1, 4, 5>(xy01, zu01));
+		XMStoreFloat4((XMFLOAT4*)&vertices[x].texture.y, XMVectorPermute<0, 1, 4, 5>(vn01, yz01));
+		XMStoreFloat3(&vertices[x].tangent, tangent);
+		XMStoreFloat4((XMFLOAT4*)&vertices[x + 1].position, XMVectorPermute<2, 3, 6, 7>(xy01, zu01));
+		XMStoreFloat4((XMFLOAT4*)&vertices[x + 1].texture.y, XMVectorPermute<2, 3, 6, 7>(vn01, yz01));
+		XMStoreFloat3(&vertices[x + 1].tangent, tangent);
+		XMStoreFloat4((XMFLOAT4*)&vertices[x + 2].position, XMVectorPermute<0, 1, 4, 5>(xy23, zu23));
+		XMStoreFloat4((XMFLOAT4*)&vertices[x + 2].texture.y, XMVectorPermute<0, 1, 4, 5>(vn23, yz23));
+		XMStoreFloat3(&vertices[x + 2].tangent, tangent);
+		XMStoreFloat4((XMFLOAT4*)&vertices[x + 3].position, XMVectorPermute<2, 3, 6, 7>(xy23, zu23));
+		XMStoreFloat4((XMFLOAT4*)&vertices[x + 3].texture.y, XMVectorPermute<2, 3, 6, 7>(vn23, yz23));
+		XMStoreFloat3(&vertices[x + 3].tangent, tangent);
+	}
+
+	//leftover verts at the end of the row
+	for (; x < size; ++x) {
+		XMStoreFloat4((XMFLOAT4*)&vertices[x].position, XMVectorSet(vertexRowX[x], heights[x], XMVectorGetX(positionZ), vertexRowU[x]));
+		XMStoreFloat4((XMFLOAT4*)&vertices[x].texture.y, XMVectorSet(XMVectorGetX(v), normalX[x], normalY[x], normalZ[x]));
+		XMStoreFloat3(&vertices[x].tangent, tangent);
+	}
+}
+
+///Plain per-vertex version of fillVertexRow(), kept as a reference to check the kernel against
+void TerrainMesh::fillVertexRowReference(VertexType_Tangent* vertices, int y) const {
+	for (int x = 0; x < size; ++x) {
+		vertices[x].position = XMFLOAT3(x+baseX-size/2, getRealHeight(x, y), y+baseZ-size/2);
+		vertices[x].texture = XMFLOAT2((float)x / (size-1), (float)y / (size-1));
+		vertices[x].normal = getCachedNormal(x, y);
+		vertices[x].tangent = XMFLOAT3(1, 0, 0);
+	}
 }
 
 XMFLOAT3 TerrainMesh::getNormal(int x, int y) {
@@ -399,30 +616,99 @@ XMFLOAT3 TerrainMesh::getNormal(int x, int y) {
 #undef ADD_NORMAL
 }
 
-//From the initial tutorial example
-void TerrainMesh::calculateNormals(VertexType_Tangent** vertices) {
+//adds normalize(a, 1, b) to the running sum of normals, only in the lanes where valid is set
+static inline void addFaceNormal(XMVECTOR& sumX, XMVECTOR& sumY, XMVECTOR& sumZ, XMVECTOR a, XMVECTOR b, XMVECTOR valid) {
+	const XMVECTOR one = XMVectorReplicate(1.f);
+	XMVECTOR length = XMVectorSqrt(XMVectorAdd(XMVectorAdd(XMVectorMultiply(a, a), one), XMVectorMultiply(b, b)));//same order of operations as Utils::normalize
+	sumX = XMVectorAdd(sumX, XMVectorSelect(XMVectorZero(), XMVectorDivide(a, length), valid));
+	sumY = XMVectorAdd(sumY, XMVectorSelect(XMVectorZero(), XMVectorDivide(one, length), valid));
+	sumZ = XMVectorAdd(sumZ, XMVectorSelect(XMVectorZero(), XMVectorDivide(b, length), valid));
+}
+
+///Same maths as getNormal(), 4 verts at a time.
+/// With p = (x, h, y) and its neighbours one unit away, the cross products of the edges simplify down to (dLeft, 1, -dUp), (-dRight, 1, -dUp), (-dRight, 1, dDown) and (dLeft, 1, dDown),
+/// where dLeft = heightLeft - h etc, so the only work left is normalizing those, adding them up (skipping the ones with an INFINITY neighbour) and normalizing the sum.
+void TerrainMesh::computeNormalGrid() {
+	const XMVECTOR infinity = XMVectorReplicate(INFINITY);
 
-	//iterate over vertices to compute normals for each one
 	for (int y = 0; y < size; ++y) {
-		for (int x = 0; x < size; ++x) {
+		//offset each row by 1 so that row[x] is the height at (x, y)
+		const float* row = realHeights[y + 1] + 1;
+		const float* rowUp = realHeights[y + 2] + 1;
+		const float* rowDown = realHeights[y] + 1;
+
+		int x = 0;
+		for (; x + 4 <= size; x += 4) {
+			XMVECTOR h = XMLoadFloat4((const XMFLOAT4*)(row + x));
+			XMVECTOR left = XMLoadFloat4((const XMFLOAT4*)(row + x - 1));
+			XMVECTOR right = XMLoadFloat4((const XMFLOAT4*)(row + x + 1));
+			XMVECTOR up = XMLoadFloat4((const XMFLOAT4*)(rowUp + x));
+			XMVECTOR down = XMLoadFloat4((const XMFLOAT4*)(rowDown + x));
+
+			XMVECTOR validLeft = XMVectorNotEqual(left, infinity);
+			XMVECTOR validRight = XMVectorNotEqual(right, infinity);
+			XMVECTOR validUp = XMVectorNotEqual(up, infinity);
+			XMVECTOR validDown = XMVectorNotEqual(down, infinity);
+
+			XMVECTOR dLeft = XMVectorSubtract(left, h);
+			XMVECTOR dRight = XMVectorNegate(XMVectorSubtract(right, h));
+			XMVECTOR dUp = XMVectorNegate(XMVectorSubtract(up, h));
+			XMVECTOR dDown = XMVectorSubtract(down, h);
+
+			XMVECTOR sumX = XMVectorZero(), sumY = XMVectorZero(), sumZ = XMVectorZero();
+			addFaceNormal(sumX, sumY, sumZ, dLeft, dUp, XMVectorAndInt(validLeft, validUp));
+			addFaceNormal(sumX, sumY, sumZ, dRight, dUp, XMVectorAndInt(validRight, validUp));
+			addFaceNormal(sumX, sumY, sumZ, dRight, dDown, XMVectorAndInt(validRight, validDown));
+			addFaceNormal(sumX, sumY, sumZ, dLeft, dDown, XMVectorAndInt(validLeft, validDown));
+
+			//average out
+			XMVECTOR length = XMVectorSqrt(XMVectorAdd(XMVectorAdd(XMVectorMultiply(sumX, sumX), XMVectorMultiply(sumY, sumY)), XMVectorMultiply(sumZ, sumZ)));
 			int index = y * size + x;
-			
-			(*vertices)[index].normal = getNormal(x, y);
+			XMStoreFloat4((XMFLOAT4*)(normals.x + index), XMVectorDivide(sumX, length));
+			XMStoreFloat4((XMFLOAT4*)(normals.y + index), XMVectorDivide(sumY, length));
+			XMStoreFloat4((XMFLOAT4*)(normals.z + index), XMVectorDivide(sumZ, length));
+		}
 
+		//leftover verts at the end of the row
+		for (; x < size; ++x) {
+			XMFLOAT3 normal = getNormal(x, y);
+			int index = y * size + x;
+			normals.x[index] = normal.x;
+			normals.y[index] = normal.y;
+			normals.z[index] = normal.z;
 		}
 	}
+
+#ifdef VERIFY_NORMAL_GRID
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			XMFLOAT3 reference = getNormal(x, y);
+			XMFLOAT3 cached = getCachedNormal(x, y);
+			if (fabsf(reference.x - cached.x) > 0.0001f || fabsf(reference.y - cached.y) > 0.0001f || fabsf(reference.z - cached.z) > 0.0001f) {
+				printf("Normal grid mismatch at %d %d: (%f %f %f) instead of (%f %f %f).\n", x, y, cached.x, cached.y, cached.z, reference.x, reference.y, reference.z);
+			}
+		}
+	}
+#endif
 }
 
-void TerrainMesh::sendData(ID3D11DeviceContext * deviceContext, D3D_PRIMITIVE_TOPOLOGY top) const{
-	if(!vertexBuffer || !indexBuffer) return;
-	unsigned int stride;
-	unsigned int offset;
+void TerrainMesh::calculateNormals() {
+	PROFILE_SCOPE("Normals");
 
-	// Set vertex buffer stride and offset.
-	stride = sizeof(VertexType_Tangent);
-	offset = 0;
+	//compute the normals at each vertex
+	computeNormalGrid();
 
-	deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	deviceContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
-	deviceContext->IASetPrimitiveTopology(top);
+	//sum up the slopes (0..1) of the 4 corners of each quad once, so the ruins don't need to recompute any normals
+#define SLOPE(x, y) (1 - normals.y[(y) * size + (x)])
+	for (int y = 0; y < size - 1; ++y) {
+		for (int x = 0; x < size - 1; ++x) {
+			cellSlopes[y][x] = SLOPE(x, y) + SLOPE(x + 1, y) + SLOPE(x + 1, y + 1) + SLOPE(x, y + 1);
+		}
+	}
+#undef SLOPE
 }
+
+void TerrainMesh::sendData(ID3D11DeviceContext * deviceContext, D3D_PRIMITIVE_TOPOLOGY top) const{
+	if(!vertexBuffer || !indexBuffer) return;
+	GLOBALS.RenderBackend->setGeometry(vertexBuffer, sizeof(VertexType_Tangent), indexBuffer, top);
+}
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "Heightmap.h"
 #include "RuinsMap.h"
 #include "ExtendedLight.h"
+#include "LitShader.h"
 #include "FileSystem.h"
 #include "FileReader.h"
 #include "FileWriter.h"
@@ -12,6 +13,7 @@
 //#define SEND_DEBUG_RUINS_MAP//uncomment to send debug ruins map to terrain shader - note that terrain_fs needs an additional define to show the texture.
 
 class TerrainMesh : public BaseMesh {
+	friend class GenerationBenchmark;
 
 	///Vertex struct for geometry with position, texture, normals and tangents
 	struct VertexType_Tangent {
@@ -34,6 +36,8 @@ public:
 	//allow updating the buffers using data from surrounding neighbours
 	void updateTerrain(const TerrainMesh* leftNeighbour, const TerrainMesh* belowNeighbour, const TerrainMesh* diagonalNeighbour, const TerrainMesh* topNeighbour, const TerrainMesh* rightNeighbour, ID3D11Device* device, ID3D11DeviceContext* deviceContext, float dt);
 	void reinitBuffers(ID3D11Device* device, float dt);//call each frame, this will handle renewing the buffers.
+	inline void updateHeightmap() { heightmap->update(inRange); }//call each frame before updateTerrain() on any chunk, to carry on with the async heightmap generation
+	void setInRange(bool value);//chunks well out of range (see CANCEL_MARGIN in InfiniteTerrain) stay loaded, but cancel any generation work (freeing what it holds onto) until they're back in range
 
 	float getRealHeight(int x, int y) const;//uses the neighbouring heightmaps to get the actual height of the terrain mesh. x and y are between 0 - size.
 
@@ -48,6 +52,7 @@ public:
 
 	inline ExtendedLight* getLight() { return &light; }
 	inline ID3D11ShaderResourceView* getShadowmap() { return light.getShadowmap(); }
+	inline LitShader::LightBuffers* getLightBuffers() { return &lightBuffers; }
 
 	inline bool hasMeshChanged() { return meshChanged; }
 
@@ -57,12 +62,26 @@ public:
 
 	inline int getIndexCount() const { return indexCount; }//hide base member for added const.
 
+	///structure-of-arrays grid of the normals at each vertex (size x size, row-major), recomputed once each time the real heights change
+	struct NormalGrid {
+		float* x = nullptr;
+		float* y = nullptr;
+		float* z = nullptr;
+	};
+	inline const NormalGrid& getNormalGrid() const { return normals; }
+	inline XMFLOAT3 getCachedNormal(int x, int y) const { int i = y * size + x; return XMFLOAT3(normals.x[i], normals.y[i], normals.z[i]); }
+
 protected:
 	void initHeightmap();
 	void initBuffers(ID3D11Device* device) override;
-	void calculateNormals(VertexType_Tangent** vertices);
-	XMFLOAT3 getNormal(int x, int y);//returns the normal for a particular vert
-	float computeRealHeight(int x, int y);
+	void initIndexBuffer(ID3D11Device* device);
+	void calculateNormals();//fills in the normal grid and the cell slopes
+	void fillVertexRow(VertexType_Tangent* vertices, int y) const;//writes out row y of the mesh's vertices (SIMD kernel)
+	void fillVertexRowReference(VertexType_Tangent* vertices, int y) const;//scalar version of fillVertexRow(), for testing
+	XMFLOAT3 getNormal(int x, int y);//returns the normal for a particular vert (scalar reference version; use the normal grid instead)
+	void computeNormalGrid();//fills in the normal grid from the current real heights
+	float computeRealHeight(int x, int y);//per-vert reference version of computeRealHeights()
+	void computeRealHeights();//fills in the whole realHeights grid
 
 	int seed;
 	int baseX;
@@ -73,10 +92,17 @@ protected:
 
 	Heightmap* heightmap = nullptr;//this is just an indication of the real heights
 	RuinsMap* ruins = nullptr;//the ruins laid onto this terrain chunk
-	float** realHeights;//a 2d array representing the real heights of all verts in this chunk, with one additional row/column on either side. this includes heights post-inclusion of neighbouring heightmaps
+	float** realHeights = nullptr;//a 2d array representing the real heights of all verts in this chunk, with one additional row/column on either side. this includes heights post-inclusion of neighbouring heightmaps
+	NormalGrid normals;//see getNormalGrid()
+	float* vertexRowX = nullptr;//x position of the vertices along any row
+	float* vertexRowU = nullptr;//u coordinate of the vertices along any row
+	float* blendWeights = nullptr;//weight of the left/below neighbour for the first few columns/rows of the chunk (1 at the edge, down to 0 at 20% of the size)
+	int blendCount = 0;//how many columns/rows blend in the left/below neighbour
+	float** cellSlopes = nullptr;//(size-1)x(size-1) array of the summed-up slopes of the 4 corners of each quad, computed from the normal grid in initBuffers for the ruins to read
 	
 	//lighting
 	ExtendedLight light;//each chunk has its own light, to support shadowmapping as best as possible on an infinite map
+	LitShader::LightBuffers lightBuffers;//the light as last sent to the gpu; only re-uploaded when it changes
 
 	/// The heightmaps belonging to our neighbours, which we can use to interpolate at the edges of the terrain, and to compute normals throughout
 	const TerrainMesh* leftNeighbour = nullptr;// x-1 , z
@@ -91,6 +117,7 @@ protected:
 	bool needUpdate;
 
 	bool meshChanged = true;//true on frames when the mesh changed
+	bool inRange = true;//see setInRange()
 };
 
 #undef SEND_DEBUG_RUINS_MAP
\ No newline at end of file
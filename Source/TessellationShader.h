@@ -1,9 +0,0 @@
-#pragma once
-#include "LitShader.h"
-class TessellationShader : public LitShader{
-public:
-	TessellationShader();
-	~TessellationShader();
-
-};
-
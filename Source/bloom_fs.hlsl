@@ -1,24 +1,14 @@
-///Horizontal or vertical gaussian blur for bloom effect
-
-#define MAX_NEIGHBOURS 200 //must be / by 4
+///Bright pass for bloom: only keeps the brightest colours, while downsampling the scene to half size as the first level of the bloom chain
 
 
 // Texture and sampler registers
 Texture2D texture0 : register(t0);
 SamplerState Sampler0 : register(s0);
 
-cbuffer GaussianBlur : register(b0) {
-	float direction;//0: horizontal; 1: vertical
-	float neighbours;//how deep into weights we want to get (should not be greater than MAX_NEIGHBOURS)
-	float2 oneOverScreenSize;
-	float weights[MAX_NEIGHBOURS];//from greatest to smallest, the weights to apply to the neighbouring pixels (values after int(neighbours) won't be considered)
-								  //note: SUM(weights, 0, (int)neighbours) must be == to 0.5
-};
-
-cbuffer Bloom : register(b1) {
+cbuffer Bloom : register(b0) {
 	float threshold;//0..3 (minimum brightness for blurring)
 	float intensity;//0..5 (how intense the pixels we keep should be
-	float2 padding;
+	float2 texel;//size of one texel of the scene, in uv
 }
 
 struct FS_IN {
@@ -38,18 +28,11 @@ float4 bloom(float4 input) {
 }
 
 float4 main(FS_IN input) : SV_TARGET{
-	float4 colour = (0.0f).xxxx;
-
-	float2 texel = oneOverScreenSize;
-	texel *= float2(1 - direction, direction);//if direction is 0, texel.y = 0; otherwise texel.x = 0.
-
-	float totalWeight = 0;
-	for (int i = 0; i < int(neighbours); ++i) {
-		colour += bloom(texture0.Sample(Sampler0, input.tex + texel * i)) * weights[i];
-		colour += bloom(texture0.Sample(Sampler0, input.tex - texel * i)) * weights[i];
-		totalWeight += weights[i] * 2;
-	}
-	colour /= totalWeight;
-
-	return colour;
+	//same taps as the dual filter's downsample (see dualfilter_fs), each one filtered before averaging
+	float4 colour = bloom(texture0.Sample(Sampler0, input.tex)) * 4;
+	colour += bloom(texture0.Sample(Sampler0, input.tex - texel));
+	colour += bloom(texture0.Sample(Sampler0, input.tex + texel));
+	colour += bloom(texture0.Sample(Sampler0, input.tex + float2(texel.x, -texel.y)));
+	colour += bloom(texture0.Sample(Sampler0, input.tex - float2(texel.x, -texel.y)));
+	return colour / 8;
 }
\ No newline at end of file
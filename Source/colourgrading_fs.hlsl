@@ -4,19 +4,24 @@
 
 // Texture and sampler registers
 Texture2D texture0 : register(t0);
-Texture2D logLut : register(t1);
+Texture3D lut : register(t1);//tonemapped LUT, baked on the cpu (see LutBaker)
 Texture2D depthTexture : register(t2);
+Texture2D bloomTexture : register(t3);
 SamplerState Sampler0 : register(s0);
 SamplerState SamplerLut : register(s1);
 
 cbuffer ColourGrading : register(b0) {
 	float3 fogColour;
 	float strength;//0..1
-	float3 logLutParams;//x: 1/lut_width, y: 1/lut_height, z: lut_height-1
+	float2 lutScaleOffset;//maps 0..1 onto the centres of the LUT's first and last texels
+	float lutPad;
 	float vignette;//0: no vignette to 1: full vignette
 	float chromaticAberrationStrength;//0..1
 	float chromaticAberrationDistance;//0..1
-	float2 pad;
+	float2 depthParams;//_33 and _43 of the projection matrix
+	float2 rayScale;//1/_11 and 1/_22 of the projection matrix
+	float oneOverFogDistance;
+	float bloom;//1: add bloomTexture on top of the graded colours (fused post processing); 0: bloom gets combined in a pass of its own, if at all
 }
 
 struct FS_IN {
@@ -48,17 +53,6 @@ float3 gamma_to_linear(float3 input) {
 	return input * (input * (input * 0.305306011f + 0.682171111f) + 0.012522878f);
 }
 
-///LUT grading (from Unity's Post Processing Stack)
-float3 lut2d(Texture2D tex, SamplerState samp, float3 uvw, float3 scaleOffset) {
-	uvw.z *= scaleOffset.z;
-	uvw.y *= -1;// <-- okay no screw this, i spent a day trying to figure out why this whole thing wasnt working and that fixed it
-	float shift = floor(uvw.z);
-	uvw.xy = uvw.xy * scaleOffset.z * scaleOffset.xy + scaleOffset.xy * 0.5;
-	uvw.x += shift * scaleOffset.y;
-	uvw.xyz = lerp(tex.Sample(samp, uvw.xy).rgb, tex.Sample(samp, uvw.xy + float2(scaleOffset.y, 0)).rgb, uvw.z - shift);
-	return uvw;
-}
-
 
 float4 main(FS_IN input) : SV_TARGET{
 	// Sample the pixel color from the texture using the sampler at this texture coordinate location.
@@ -73,8 +67,11 @@ float4 main(FS_IN input) : SV_TARGET{
 	float blue = texture0.Sample(Sampler0, input.tex - ca).b;
 	color = lerp(color, float3(red, color.g, blue), chromaticAberrationStrength);
 
-	// Quadratic fog
-	float depth = 1.0f-depthTexture.Sample(Sampler0, input.tex).r;//0 at NEAR, 1 at FAR
+	// Quadratic fog, from the distance to the camera rebuilt from the depth buffer
+	float bufferDepth = depthTexture.Load(int3(input.position.xy, 0)).r;
+	float viewDepth = depthParams.y / (bufferDepth - depthParams.x);
+	float3 viewRay = float3((input.tex.x * 2 - 1) * rayScale.x, (1 - input.tex.y * 2) * rayScale.y, 1);
+	float depth = bufferDepth >= 1 ? 1 : saturate(viewDepth * length(viewRay) * oneOverFogDistance);//0 at the camera, 1 at the far plane and on the background
 	color = lerp(color, fogColour, depth * depth);
 
 	// Vignette
@@ -84,10 +81,14 @@ float4 main(FS_IN input) : SV_TARGET{
 	//To gamma space
 	color = max(saturate(color), (0.005f).xxx);//removes artifacts in very dark colours in lut
 	color = linear_to_gamma(color);
-	float3 colorGraded = lut2d(logLut, SamplerLut, color, logLutParams);
+	float3 colorGraded = lut.Sample(SamplerLut, color * lutScaleOffset.x + lutScaleOffset.y).rgb;
 	//Back to linear
 	colorGraded = gamma_to_linear(colorGraded);
 	color = lerp(color, colorGraded, strength);//Vary how strong we want the effect
 
+	// Bloom, saving the combination pass
+	if (bloom > 0)
+		color += bloomTexture.Sample(Sampler0, input.tex).rgb;
+
 	return float4(color.rgb, 1);
 }
\ No newline at end of file
@@ -3,11 +3,14 @@
 #define NUM_LIGHTS 8
 
 cbuffer MatrixBuffer : register(b0) {
-	matrix worldMatrix;
 	matrix viewMatrix;
 	matrix projectionMatrix;
 }
 
+cbuffer WorldBuffer : register(b4) {//per draw; view and projection only change once per pass
+	matrix worldMatrix;
+}
+
 cbuffer CameraBuffer : register(b1) {
 	float3 cameraPosition;
 	float far;//the far plane's distance from camera
@@ -41,11 +44,13 @@ VS_OUT main(VS_IN input){
 	VS_OUT output;
 
 	// Calculate the position of the vertex against the world, view, and projection matrices.
+	// precise, and the same maths as depth_vs, so the depth pre-pass lands on the exact same depths.
 	float4 pos = float4(input.position.xyz, 1.0f);
-	float4 worldPosition = mul(pos, worldMatrix);
+	precise float4 worldPosition = mul(pos, worldMatrix);
 	output.worldPosition = worldPosition.xyz;
-	output.position = mul(worldPosition, viewMatrix);
-	output.position = mul(output.position, projectionMatrix);
+	precise float4 viewPosition = mul(worldPosition, viewMatrix);
+	precise float4 clipPosition = mul(viewPosition, projectionMatrix);
+	output.position = clipPosition;
 
 	// Store the texture coordinates for the fragment shader.
 	output.tex = input.tex;
@@ -1,11 +1,14 @@
 //depth vertex shader: passes position to fragment shader
 
 cbuffer MatrixBuffer : register(b0) {
-	matrix worldMatrix;
 	matrix viewMatrix;
 	matrix projectionMatrix;
 }
 
+cbuffer WorldBuffer : register(b4) {//per draw; view and projection only change once per pass
+	matrix worldMatrix;
+}
+
 cbuffer CameraBuffer : register(b1) {
 	float3 cameraPosition;
 	float far;//the far plane's distance from camera
@@ -25,11 +28,13 @@ VS_OUT main(VS_IN input) {
 	VS_OUT output;
 
 	// Calculate the position of the vertex against the world, view, and projection matrices.
+	// precise, and the same maths as default_vs, so the lit pass lands on the exact same depths as the pre-pass.
 	float4 pos = float4(input.position.xyz, 1.0f);
-	float4 worldPosition = mul(pos, worldMatrix);
+	precise float4 worldPosition = mul(pos, worldMatrix);
 	output.worldPosition = worldPosition;
-	output.position = mul(worldPosition, viewMatrix);
-	output.position = mul(output.position, projectionMatrix);
+	precise float4 viewPosition = mul(worldPosition, viewMatrix);
+	precise float4 clipPosition = mul(viewPosition, projectionMatrix);
+	output.position = clipPosition;
 
 	//Pass camera position and 1/far to frag
 	output.cameraPosition = float4(cameraPosition.xyz, 1.0f/far);
@@ -0,0 +1,45 @@
+///Dual filter blur (Bjorge 2015), one level of the bloom chain at a time: downsampling to half size, or upsampling back to double size.
+///Every tap sits between texels so the bilinear sampler averages them for free, giving a wide blur out of 5 (down) or 8 (up) samples.
+
+
+// Texture and sampler registers
+Texture2D texture0 : register(t0);
+SamplerState Sampler0 : register(s0);
+
+cbuffer DualFilter : register(b0) {
+	float2 offset;//in uv: one texel of the source when downsampling, half a texel of the source when upsampling
+	float upsample;//0: downsample; 1: upsample
+	float padding;
+}
+
+struct FS_IN {
+	float4 position : SV_POSITION;
+	float2 tex : TEXCOORD0;
+};
+
+
+
+float4 main(FS_IN input) : SV_TARGET{
+	float2 uv = input.tex;
+
+	if (upsample < 0.5f) {
+		//centre + 4 diagonals, each averaging a 2x2 block of the source
+		float4 colour = texture0.Sample(Sampler0, uv) * 4;
+		colour += texture0.Sample(Sampler0, uv - offset);
+		colour += texture0.Sample(Sampler0, uv + offset);
+		colour += texture0.Sample(Sampler0, uv + float2(offset.x, -offset.y));
+		colour += texture0.Sample(Sampler0, uv - float2(offset.x, -offset.y));
+		return colour / 8;
+	}
+
+	//tent: 4 taps one texel away along the axes + 4 diagonal taps half a texel away, weighted twice
+	float4 colour = texture0.Sample(Sampler0, uv + float2(-offset.x * 2, 0));
+	colour += texture0.Sample(Sampler0, uv + float2(offset.x * 2, 0));
+	colour += texture0.Sample(Sampler0, uv + float2(0, -offset.y * 2));
+	colour += texture0.Sample(Sampler0, uv + float2(0, offset.y * 2));
+	colour += texture0.Sample(Sampler0, uv + float2(-offset.x, offset.y)) * 2;
+	colour += texture0.Sample(Sampler0, uv + float2(offset.x, offset.y)) * 2;
+	colour += texture0.Sample(Sampler0, uv + float2(offset.x, -offset.y)) * 2;
+	colour += texture0.Sample(Sampler0, uv + float2(-offset.x, -offset.y)) * 2;
+	return colour / 12;
+}
\ No newline at end of file
@@ -1,11 +1,15 @@
 
 cbuffer MatrixBuffer : register(b0)
 {
-	matrix worldMatrix;
 	matrix viewMatrix;
 	matrix projectionMatrix;
 };
 
+cbuffer WorldBuffer : register(b4)//per draw; view and projection only change once per pass
+{
+	matrix worldMatrix;
+};
+
 struct VS_IN{
 	float4 position : POSITION;
 	float2 tex : TEXCOORD0;
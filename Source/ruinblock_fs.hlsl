@@ -14,6 +14,38 @@
 #define DIFFUSE_AND_NORMAL_MAP 2
 #define NORMAL_MAP 3
 
+//permutation options: variants (eg ruinblock_fs_1dir_shadows.hlsl) define some of these before including this file, and get everything they fix compiled out;
+//whatever is left undefined gets decided at runtime from the constant buffers
+#define RUNTIME_OPTION -1
+#ifndef NUM_ACTIVE_LIGHTS
+#define NUM_ACTIVE_LIGHTS NUM_LIGHTS //how many of the lights to go through
+#endif
+#ifndef LIGHT_TYPE
+#define LIGHT_TYPE RUNTIME_OPTION //the type of every active light
+#endif
+#ifndef SHADOWS
+#define SHADOWS RUNTIME_OPTION //0 or 1, whether every active light reads its shadowmap
+#endif
+#ifndef NORMAL_MAPPING
+#define NORMAL_MAPPING RUNTIME_OPTION //0 or 1, whether to read the normal map
+#endif
+
+#if LIGHT_TYPE == RUNTIME_OPTION
+#define LIGHT_TYPE_OF(light) lightPosition[light].w
+#else
+#define LIGHT_TYPE_OF(light) LIGHT_TYPE
+#endif
+#if SHADOWS == RUNTIME_OPTION
+#define SHADOWS_FROM(light) (attenuation[light].w == 1)
+#else
+#define SHADOWS_FROM(light) SHADOWS
+#endif
+#if NORMAL_MAPPING == RUNTIME_OPTION
+#define NORMAL_MAPPED (mode == NORMAL_MAP || mode == DIFFUSE_AND_NORMAL_MAP)
+#else
+#define NORMAL_MAPPED NORMAL_MAPPING
+#endif
+
 //caustics effect
 #define CAUSTICSANIMSPEED 0.8f
 #define CAUSTICS_UVMARGIN 0.01f
@@ -24,6 +56,7 @@ Texture2D texDiffuse : register(t0);//albedo texture
 Texture2D texNormalMap : register(t1);//normal map
 Texture2D shadowMap[NUM_LIGHTS] : register(t2);//one shadowmap per light
 SamplerState sampler0 : register(s0);
+SamplerComparisonState shadowSampler : register(s2);//compares against the shadowmaps
 
 Texture2D texEffect : register(t13);//caustics texture
 
@@ -38,6 +71,17 @@ cbuffer LightBuffer : register(b0) {
 	float shadowmapBias;
 	float showShadowmapErrors;//if 1, shows red where shadowmaps dont extend far enough
 	float oneOverShadowmapSize;
+	float shadowmapTaps;//4, 8, 12 or 16
+	float3 padding;
+};
+
+//Shadow filtering kernel, in shadowmap texels: a rotated grid of 4 taps, then points spread over the same disk, 4 at a time (see shadowmapTaps).
+//Each tap is a 2x2 PCF lookup, so the first 4 cover the same 4x4 texels the old 16 point samples did.
+static const float2 shadowKernel[16] = {
+	float2(-0.5f, -1.5f), float2(1.5f, -0.5f), float2(0.5f, 1.5f), float2(-1.5f, 0.5f),
+	float2(0.01f, 0.02f), float2(-0.72f, 1.42f), float2(-1.4f, -0.7f), float2(1.36f, 0.7f),
+	float2(0.7f, -1.36f), float2(0.03f, -0.84f), float2(-0.83f, -0.03f), float2(-0.08f, 0.9f),
+	float2(0.86f, 0.04f), float2(0.6f, 0.72f), float2(0.77f, -0.64f), float2(-0.69f, -0.78f)
 };
 
 cbuffer MaterialBuffer : register(b1) {
@@ -134,7 +178,7 @@ float4 main(FS_IN input) : SV_TARGET{
 	//default tangent space normal
 	float3 tangentSpaceNormal = float3(0.5f, 0.5f, 1);//the per-fragment normal in tangent space rather than per-vertex in world space
 
-	if (mode == DIFFUSE_AND_NORMAL_MAP || mode == NORMAL_MAP) {
+	if (NORMAL_MAPPED) {
 		//get tangent space normal from normal map
 		tangentSpaceNormal = texNormalMap.Sample(sampler0, input.tex).rgb;
 	}
@@ -144,8 +188,8 @@ float4 main(FS_IN input) : SV_TARGET{
 
 	float4 lightColour = ambient;
 	float4 specular = float4(0, 0, 0, 0);
-	for (int light = 0; light < NUM_LIGHTS; ++light) {
-		if (lightPosition[light].w == INACTIVE_LIGHT) {//w component of light's position corresponds to light type
+	for (int light = 0; light < NUM_ACTIVE_LIGHTS; ++light) {
+		if (LIGHT_TYPE_OF(light) == INACTIVE_LIGHT) {//w component of light's position corresponds to light type
 													   //inactive light, so nothing to add here
 		} else {//compute lighting for this light:
 
@@ -157,7 +201,7 @@ float4 main(FS_IN input) : SV_TARGET{
 											 //check relevant shadowmap to see if we should light this fragment from this light
 			float shadow = 1;//shadow multiplier is set to 1 in case shadowmap read is impossible or out of range
 
-			if (attenuation[light].w == 1) {//read shadowmap
+			if (SHADOWS_FROM(light)) {//read shadowmap
 											//Compute projected uvs
 				float2 pTexCoord = input.lightViewPos[light].xy / input.lightViewPos[light].w;
 				pTexCoord *= float2(0.5f, -0.5f);
@@ -171,17 +215,20 @@ float4 main(FS_IN input) : SV_TARGET{
 					//add bias
 					lightDepthValue += shadowmapBias;
 
-					//Very simple soft shadow computation (16 samples instead of 1 to minimize jagged edges)
+					//Soft shadows: each tap compares 4 texels to lightDepthValue in hardware and returns the filtered fraction that passed (ie that is lit)
 					shadow = 0;
-					for (float y = -1.5f; y <= 1.5f; y += 1.0f) {
-						for (float x = -1.5f; x <= 1.5f; x += 1.0f) {
-							//Sample shadowmap (16 samples per light)
-							float depthValue = shadowMap[light].Sample(sampler0, pTexCoord + float2(x, y) * oneOverShadowmapSize).r;
-							if (lightDepthValue > depthValue) {
-								//add a bit of light (if all 16 samples result in passes on this condition, pixel will be totally lit)
-								shadow += 0.0625f;// 1/16
-							}
+					for (int tap = 0; tap < 4; ++tap) {
+						shadow += shadowMap[light].SampleCmpLevelZero(shadowSampler, pTexCoord + shadowKernel[tap] * oneOverShadowmapSize, lightDepthValue);
+					}
+					if (shadowmapTaps > 4 && shadow > 0 && shadow < 4) {//only fragments on a shadow's edge need the rest of the kernel
+						int taps = int(shadowmapTaps);
+						for (int tap = 4; tap < taps; ++tap) {
+							shadow += shadowMap[light].SampleCmpLevelZero(shadowSampler, pTexCoord + shadowKernel[tap] * oneOverShadowmapSize, lightDepthValue);
 						}
+						shadow /= shadowmapTaps;
+					}
+					else {
+						shadow *= 0.25f;
 					}
 
 				} else if (showShadowmapErrors == 1) {//uvs outside 0..1
@@ -192,7 +239,7 @@ float4 main(FS_IN input) : SV_TARGET{
 			}
 
 			if (/*shouldLight*/shadow > 0) {
-				if (lightPosition[light].w == POINT_LIGHT) {
+				if (LIGHT_TYPE_OF(light) == POINT_LIGHT) {
 					//point light
 					lightVector /= dist;//normalize
 					float attFactor = 1.0f / (attenuation[light].x + attenuation[light].y * dist + attenuation[light].z * dist * dist);
@@ -200,14 +247,14 @@ float4 main(FS_IN input) : SV_TARGET{
 					lightColour += shadow * calculateLighting(lightVector, input.normal, input.binormal, input.tangent, tangentSpaceNormal, diffuse[light].rgb * attFactor);
 					//specular component
 					specular += shadow * blinnPhong(lightVector, input.normal, input.binormal, input.tangent, tangentSpaceNormal, input.viewVector, specularColour, specularPower).rgbr * diffuse[light] * attFactor;
-				} else if (lightPosition[light].w == DIRECTIONAL_LIGHT) {
+				} else if (LIGHT_TYPE_OF(light) == DIRECTIONAL_LIGHT) {
 					//directional light
 					float3 dir = -normalize(lightDirection[light].xyz);
 					//diffuse lighting
 					lightColour += shadow * calculateLighting(dir, input.normal, input.binormal, input.tangent, tangentSpaceNormal, diffuse[light].rgb);
 					//specular component
 					specular += shadow * blinnPhong(dir, input.normal, input.binormal, input.tangent, tangentSpaceNormal, input.viewVector, specularColour, specularPower).rgbr * diffuse[light];
-				} else if (lightPosition[light].w == SPOTLIGHT) {
+				} else if (LIGHT_TYPE_OF(light) == SPOTLIGHT) {
 					//spotlight
 					lightVector /= dist;//normalize
 					float attFactor = 1.0f / (attenuation[light].x + attenuation[light].y * dist + attenuation[light].z * dist * dist);
@@ -0,0 +1,8 @@
+//ruinblock_fs for one directional light, without shadows, with normal mapping (see the permutation options at the top of ruinblock_fs)
+
+#define NUM_ACTIVE_LIGHTS 1
+#define LIGHT_TYPE DIRECTIONAL_LIGHT
+#define SHADOWS 0
+#define NORMAL_MAPPING 1
+
+#include "ruinblock_fs.hlsl"
\ No newline at end of file
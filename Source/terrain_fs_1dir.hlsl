@@ -0,0 +1,8 @@
+//terrain_fs for one directional light, without shadows, without normal mapping (see the permutation options at the top of terrain_fs)
+
+#define NUM_ACTIVE_LIGHTS 1
+#define LIGHT_TYPE DIRECTIONAL_LIGHT
+#define SHADOWS 0
+#define NORMAL_MAPPING 0
+
+#include "terrain_fs.hlsl"
\ No newline at end of file
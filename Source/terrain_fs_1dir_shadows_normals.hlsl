@@ -0,0 +1,8 @@
+//terrain_fs for one directional light, with shadows, with normal mapping (see the permutation options at the top of terrain_fs)
+
+#define NUM_ACTIVE_LIGHTS 1
+#define LIGHT_TYPE DIRECTIONAL_LIGHT
+#define SHADOWS 1
+#define NORMAL_MAPPING 1
+
+#include "terrain_fs.hlsl"
\ No newline at end of file